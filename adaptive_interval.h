@@ -0,0 +1,75 @@
+#ifndef ADAPTIVE_INTERVAL_H
+#define ADAPTIVE_INTERVAL_H
+
+#include <stdint.h>
+
+// ==================== ADAPTIVE SEND INTERVAL ====================
+//
+// Picks the next send interval once per cycle from two signals:
+//
+//   congestion  EWMA of the delivery failure rate (permille). At or above
+//               ADAPT_CONGESTED_PERMILLE the interval doubles, up to maxMs,
+//               so a crowded channel sheds load instead of colliding more.
+//   activity    whether the readings moved noticeably since the previous
+//               cycle. Halves the interval, down to minMs.
+//
+// Congestion wins over activity. On a clean link with steady readings the
+// interval drifts back to baseMs by a quarter of the gap per cycle.
+//
+// The constexpr constructor makes instances constant-initialized, so one
+// placed in RTC_DATA_ATTR memory keeps its state across deep sleep.
+
+#define ADAPT_CONGESTED_PERMILLE 200
+#define ADAPT_CLEAN_PERMILLE 50
+
+class AdaptiveInterval {
+public:
+  constexpr AdaptiveInterval(uint32_t baseMs, uint32_t minMs, uint32_t maxMs)
+      : base_(baseMs), min_(minMs), max_(maxMs), interval_(baseMs), failRate_(0) {}
+
+  /**
+   * @brief Account for one send cycle and compute the next interval
+   * @param delivered Frames acknowledged since the previous call
+   * @param failed Delivery failures since the previous call
+   * @param changed Readings moved noticeably since the previous call
+   * @return The new interval (ms)
+   */
+  uint32_t next(uint32_t delivered, uint32_t failed, bool changed) {
+    uint32_t total = delivered + failed;
+    if (total > 0) {
+      int32_t sample = (int32_t)(failed * 1000 / total);
+      failRate_ += (sample - failRate_) / 4;
+    }
+
+    if (failRate_ >= ADAPT_CONGESTED_PERMILLE) {
+      interval_ = interval_ > max_ / 2 ? max_ : interval_ * 2;
+    } else if (changed) {
+      interval_ = interval_ / 2 < min_ ? min_ : interval_ / 2;
+    } else if (failRate_ <= ADAPT_CLEAN_PERMILLE) {
+      int32_t gap = (int32_t)(base_ - interval_);
+      interval_ = (gap / 4 == 0) ? base_ : (uint32_t)((int32_t)interval_ + gap / 4);
+    }
+    return interval_;
+  }
+
+  /**
+   * @brief Move the base interval (remote config); restarts the adaptation from it
+   */
+  void setBase(uint32_t baseMs) {
+    if (baseMs == base_) return;
+    base_ = baseMs;
+    interval_ = baseMs < min_ ? min_ : (baseMs > max_ ? max_ : baseMs);
+  }
+
+  uint32_t interval() const { return interval_; }
+  int32_t failRate() const { return failRate_; }
+
+private:
+  uint32_t base_;
+  uint32_t min_;
+  uint32_t max_;
+  uint32_t interval_;
+  int32_t failRate_;  // Permille
+};
+
+#endif  // ADAPTIVE_INTERVAL_H
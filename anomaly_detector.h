@@ -0,0 +1,91 @@
+#ifndef ANOMALY_DETECTOR_H
+#define ANOMALY_DETECTOR_H
+
+#include <stdint.h>
+#include <math.h>
+#include "sensor_frame.h"
+
+// ==================== ANOMALY DETECTION ====================
+//
+// Streaming check of every reading, cheap enough for the sampling context.
+// A channel is in alarm when its reading leaves its [low, high] band, or
+// when it is more than `jump` away from the channel's exponentially weighted
+// moving average. The absolute limits catch dangerous levels. The baseline
+// catches sudden changes that are still within those limits, such as a gas
+// spike or a heart rate swing.
+//
+// check() raises a channel when it goes into alarm, and raises it again
+// every holdoff while it stays there; a channel that returns to normal is
+// re-armed, so a fresh excursion raises at once. A sustained event keeps reporting but
+// cannot flood the air. A channel's "no reading" value (heart rate or SpO2
+// without a finger, see SampleLayout) is skipped, and its baseline restarts
+// when readings return.
+
+typedef struct anomaly_rule {
+  float low;   // Alarm below this (-INFINITY: off)
+  float high;  // Alarm above this (INFINITY: off)
+  float jump;  // Alarm this far from the baseline (INFINITY: off)
+} anomaly_rule;
+
+class AnomalyDetector {
+public:
+  /**
+   * @param rules One rule per channel, in sample_fixed field order
+   * @param alpha Weight of each new reading in the baseline (0..1)
+   */
+  AnomalyDetector(const anomaly_rule (&rules)[FRAME_FIELD_COUNT], float alpha, uint32_t holdoffMs)
+      : alpha_(alpha), holdoffMs_(holdoffMs) {
+    for (int i = 0; i < FRAME_FIELD_COUNT; i++) rules_[i] = rules[i];
+  }
+
+  /**
+   * @brief Check one reading and fold it into the baselines
+   * @return Channels raised by this reading (bit i = sample_fixed field i), 0 if none
+   */
+  uint8_t check(const sensor_data &s, uint32_t nowMs) {
+    float value[FRAME_FIELD_COUNT];
+    SampleLayout::values(s, value);
+    uint8_t raisedNow = 0;
+    for (int i = 0; i < FRAME_FIELD_COUNT; i++) {
+      uint8_t bit = (uint8_t)(1u << i);
+      float v = value[i];
+      if (SampleLayout::missing(i, v)) {
+        seeded_ &= ~bit;
+        raised_ &= ~bit;
+        continue;
+      }
+
+      const anomaly_rule &r = rules_[i];
+      bool alarm = v < r.low || v > r.high;
+      if (seeded_ & bit) {
+        alarm = alarm || fabsf(v - baseline_[i]) > r.jump;
+        baseline_[i] += alpha_ * (v - baseline_[i]);
+      } else {
+        baseline_[i] = v;
+        seeded_ |= bit;
+      }
+
+      if (alarm && (!(raised_ & bit) || nowMs - raisedMs_[i] >= holdoffMs_)) {
+        raisedNow |= bit;
+        raised_ |= bit;
+        raisedMs_[i] = nowMs;
+      } else if (!alarm) {
+        raised_ &= ~bit;  // Back to normal: the next excursion raises at once
+      }
+    }
+    return raisedNow;
+  }
+
+  float baseline(int field) const { return baseline_[field]; }
+
+private:
+  anomaly_rule rules_[FRAME_FIELD_COUNT];
+  float alpha_;
+  uint32_t holdoffMs_;
+  float baseline_[FRAME_FIELD_COUNT] = {};
+  uint32_t raisedMs_[FRAME_FIELD_COUNT] = {};
+  uint8_t seeded_ = 0;  // Channels with a baseline
+  uint8_t raised_ = 0;  // Channels raised at least once (raisedMs_ is valid)
+};
+
+#endif  // ANOMALY_DETECTOR_H
@@ -0,0 +1,143 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ==================== BENCHMARK COUNTERS ====================
+//
+// Accumulators behind BENCHMARK_MODE: per-stage CPU cycles (count, total,
+// min, max), a log2 histogram of send-to-callback latency, and the frames
+// and bytes handed to the radio. The caller supplies every timestamp, so the
+// class has no hardware dependencies.
+//
+// ESP-NOW reports delivery in send order, so onSent() queues the send time
+// and each onAck() settles the oldest one (the same argument as the send
+// window). onAcksLost() forgets them when callbacks went missing.
+//
+// Each stage is written by one context only; a report read from another one
+// may mix two updates, which is fine for statistics. The constexpr
+// constructor lets an instance live in RTC_DATA_ATTR memory and keep
+// accumulating across deep sleep cycles.
+
+#define BENCH_LATENCY_BUCKETS 16  // Bucket i: latency < 2^i * 16 us (last: the rest)
+#define BENCH_LATENCY_SHIFT 4
+#define BENCH_INFLIGHT 8
+
+enum bench_stage : uint8_t {
+  BENCH_READ,    // readSensors()
+  BENCH_ENCODE,  // Packing a frame
+  BENCH_SEND,    // esp_now_send() call
+  BENCH_ACK,     // Delivery report processing
+  BENCH_STAGE_COUNT,
+};
+
+typedef struct bench_timing {
+  uint32_t count;
+  uint64_t totalCycles;
+  uint32_t minCycles;
+  uint32_t maxCycles;
+} bench_timing;
+
+class Benchmark {
+public:
+  constexpr Benchmark()
+      : stages_{}, latency_{}, sentUs_{}, inflightHead_(0), inflightCount_(0),
+        frames_(0), bytes_(0), acked_(0), failed_(0), windowStartUs_(0),
+        windowFrames_(0), windowBytes_(0) {}
+
+  void addCycles(bench_stage stage, uint32_t cycles) {
+    bench_timing &t = stages_[stage];
+    if (t.count == 0 || cycles < t.minCycles) t.minCycles = cycles;
+    if (cycles > t.maxCycles) t.maxCycles = cycles;
+    t.totalCycles += cycles;
+    t.count++;
+  }
+
+  /**
+   * @brief A frame was accepted by esp_now_send()
+   */
+  void onSent(size_t len, int64_t nowUs) {
+    frames_++;
+    bytes_ += len;
+    windowFrames_++;
+    windowBytes_ += len;
+    if (inflightCount_ >= BENCH_INFLIGHT) {
+      popSent();  // More in flight than tracked: the oldest can no longer be matched
+    }
+    sentUs_[(inflightHead_ + inflightCount_) % BENCH_INFLIGHT] = nowUs;
+    inflightCount_++;
+  }
+
+  /**
+   * @brief A delivery report arrived (timestamped in the callback)
+   */
+  void onAck(bool success, int64_t callbackUs) {
+    if (success) acked_++; else failed_++;
+    if (inflightCount_ == 0) return;
+    int64_t latencyUs = callbackUs - popSent();
+    if (latencyUs < 0) latencyUs = 0;
+    latency_[latencyBucket((uint64_t)latencyUs)]++;
+  }
+
+  void onAcksLost() { inflightCount_ = 0; }
+
+  /**
+   * @brief Frames and bytes since the previous call, and the period they cover
+   */
+  void takeWindow(int64_t nowUs, uint32_t &frames, uint32_t &bytes, int64_t &periodUs) {
+    frames = windowFrames_;
+    bytes = windowBytes_;
+    periodUs = windowStartUs_ > 0 ? nowUs - windowStartUs_ : 0;
+    windowFrames_ = 0;
+    windowBytes_ = 0;
+    windowStartUs_ = nowUs;
+  }
+
+  static size_t latencyBucket(uint64_t us) {
+    size_t bucket = 0;
+    us >>= BENCH_LATENCY_SHIFT;
+    while (us > 0 && bucket < BENCH_LATENCY_BUCKETS - 1) {
+      us >>= 1;
+      bucket++;
+    }
+    return bucket;
+  }
+
+  /**
+   * @brief Upper bound of a latency bucket in us (0 for the open-ended last one)
+   */
+  static uint32_t bucketLimitUs(size_t bucket) {
+    return bucket < BENCH_LATENCY_BUCKETS - 1 ? (1UL << (bucket + BENCH_LATENCY_SHIFT)) : 0;
+  }
+
+  const bench_timing &stage(bench_stage s) const { return stages_[s]; }
+  uint32_t latencyCount(size_t bucket) const { return latency_[bucket]; }
+  uint32_t frames() const { return frames_; }
+  uint64_t bytes() const { return bytes_; }
+  uint32_t acked() const { return acked_; }
+  uint32_t failed() const { return failed_; }
+
+private:
+  int64_t popSent() {
+    int64_t t = sentUs_[inflightHead_];
+    inflightHead_ = (inflightHead_ + 1) % BENCH_INFLIGHT;
+    inflightCount_--;
+    return t;
+  }
+
+  bench_timing stages_[BENCH_STAGE_COUNT];
+  uint32_t latency_[BENCH_LATENCY_BUCKETS];
+  int64_t sentUs_[BENCH_INFLIGHT];
+  uint8_t inflightHead_;
+  uint8_t inflightCount_;
+  uint32_t frames_;
+  uint64_t bytes_;
+  uint32_t acked_;
+  uint32_t failed_;
+  int64_t windowStartUs_;
+  uint32_t windowFrames_;
+  uint32_t windowBytes_;
+};
+
+#endif  // BENCHMARK_H
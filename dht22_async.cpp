@@ -0,0 +1,119 @@
+#include "dht22_async.h"
+
+bool Dht22Async::begin() {
+  pinMode(pin_, INPUT_PULLUP);
+
+  esp_timer_create_args_t args = {};
+  args.callback = &Dht22Async::onStartPulseDone;
+  args.arg = this;
+  args.dispatch_method = ESP_TIMER_TASK;
+  args.name = "dht22";
+  return esp_timer_create(&args, &startTimer_) == ESP_OK;
+}
+
+/**
+ * @brief GPIO ISR: timestamp each falling edge of the sensor's reply
+ */
+void IRAM_ATTR Dht22Async::onEdge(void *arg) {
+  Dht22Async *self = static_cast<Dht22Async *>(arg);
+  uint8_t n = self->edgeCount_;
+  if (n < DHT22_FRAME_EDGES) {
+    self->edges_[n] = (uint32_t)esp_timer_get_time();
+    self->edgeCount_ = n + 1;
+  }
+}
+
+/**
+ * @brief esp_timer callback: end the start pulse and hand the line to the sensor
+ *
+ * The edge interrupt is armed before the pin is released, so the sensor's
+ * first response edge (20-40 us later) cannot be missed.
+ */
+void Dht22Async::onStartPulseDone(void *arg) {
+  Dht22Async *self = static_cast<Dht22Async *>(arg);
+  self->edgeCount_ = 0;
+  attachInterruptArg(self->pin_, &Dht22Async::onEdge, self, FALLING);
+  self->captureStartUs_ = (uint32_t)esp_timer_get_time();
+  pinMode(self->pin_, INPUT_PULLUP);
+  self->state_ = CAPTURE;
+}
+
+void Dht22Async::poll() {
+  if (startTimer_ == nullptr) return;
+
+  switch (state_) {
+    case IDLE:
+      if (started_ && millis() - lastStartMs_ < DHT22_MIN_INTERVAL_MS) return;
+      started_ = true;
+      lastStartMs_ = millis();
+      state_ = START_PULSE;
+      pinMode(pin_, OUTPUT);
+      digitalWrite(pin_, LOW);
+      if (esp_timer_start_once(startTimer_, DHT22_START_PULSE_US) != ESP_OK) {
+        pinMode(pin_, INPUT_PULLUP);
+        state_ = IDLE;
+        errorCount_++;
+      }
+      break;
+
+    case START_PULSE:
+      break;  // Waiting for onStartPulseDone()
+
+    case CAPTURE:
+      if (edgeCount_ < DHT22_FRAME_EDGES &&
+          (uint32_t)esp_timer_get_time() - captureStartUs_ < DHT22_CAPTURE_TIMEOUT_US) {
+        return;
+      }
+      detachInterrupt(pin_);
+      if (!decode()) errorCount_++;
+      state_ = IDLE;
+      break;
+  }
+}
+
+/**
+ * @brief Turn captured falling-edge timestamps into a checked reading
+ *
+ * Uses the last 41 edges so a frame whose response edge was lost still
+ * decodes: each bit is the time between the starts of consecutive bits.
+ */
+bool Dht22Async::decode() {
+  uint8_t n = edgeCount_;
+  if (n < DHT22_FRAME_EDGES - 1) return false;
+
+  uint8_t data[5] = {0, 0, 0, 0, 0};
+  uint8_t first = n - (DHT22_FRAME_EDGES - 1);
+  for (uint8_t bit = 0; bit < 40; bit++) {
+    uint32_t width = edges_[first + bit + 1] - edges_[first + bit];
+    data[bit / 8] <<= 1;
+    if (width > DHT22_BIT_THRESHOLD_US) data[bit / 8] |= 1;
+  }
+
+  if ((uint8_t)(data[0] + data[1] + data[2] + data[3]) != data[4]) return false;
+
+  humidity_ = ((data[0] << 8) | data[1]) * 0.1f;
+  temperature_ = (((data[2] & 0x7F) << 8) | data[3]) * 0.1f;
+  if (data[2] & 0x80) temperature_ = -temperature_;
+  sampleTime_ = millis();
+  valid_ = true;
+  return true;
+}
+
+bool Dht22Async::read(float &temperature, float &humidity) const {
+  if (!valid_ || millis() - sampleTime_ > DHT22_STALE_MS) return false;
+  temperature = temperature_;
+  humidity = humidity_;
+  return true;
+}
+
+bool Dht22Async::waitForSample(unsigned long timeoutMs) {
+  unsigned long start = millis();
+  unsigned long before = sampleTime_;
+  bool hadSample = valid_;
+  while (millis() - start < timeoutMs) {
+    poll();
+    if (valid_ && (!hadSample || sampleTime_ != before)) return true;
+    delay(1);
+  }
+  return false;
+}
@@ -0,0 +1,83 @@
+#ifndef DHT22_ASYNC_H
+#define DHT22_ASYNC_H
+
+#include <Arduino.h>
+#include <esp_timer.h>
+
+// ==================== NON-BLOCKING DHT22 DRIVER ====================
+//
+// Replaces the bit-banged, interrupts-off read of the DHT library with a
+// small state machine:
+//
+//   IDLE ──poll()──▶ START_PULSE ──esp_timer──▶ CAPTURE ──poll()──▶ IDLE
+//
+// The 1.1 ms start pulse is timed by a one-shot esp_timer and the 40 data
+// bits are captured by a falling-edge GPIO interrupt that only timestamps
+// edges. poll() decodes the captured bit widths once the frame is complete,
+// so the caller never blocks and interrupts stay enabled throughout.
+
+#define DHT22_MIN_INTERVAL_MS 2000  // Sensor refuses to convert faster than this
+#define DHT22_START_PULSE_US 1100
+#define DHT22_CAPTURE_TIMEOUT_US 10000
+#define DHT22_STALE_MS 10000        // Latest sample is rejected after this age
+#define DHT22_FRAME_EDGES 42        // Response edge + 40 bit starts + end edge
+#define DHT22_BIT_THRESHOLD_US 100  // Falling-to-falling: ~78 us = 0, ~120 us = 1
+
+class Dht22Async {
+public:
+  explicit Dht22Async(uint8_t pin) : pin_(pin) {}
+
+  /**
+   * @brief Configure the pin and timer; the first conversion starts on poll()
+   */
+  bool begin();
+
+  /**
+   * @brief Advance the state machine; call frequently from the sampling loop
+   */
+  void poll();
+
+  /**
+   * @brief Latest good reading
+   * @return false if no valid sample is available or it is older than DHT22_STALE_MS
+   */
+  bool read(float &temperature, float &humidity) const;
+
+  /**
+   * @brief Poll until a fresh sample arrives (used on wake, bounded by timeoutMs)
+   */
+  bool waitForSample(unsigned long timeoutMs);
+
+  /**
+   * @brief A conversion is in progress (start pulse or edge capture)
+   */
+  bool busy() const { return state_ != IDLE; }
+
+  unsigned long sampleTime() const { return sampleTime_; }
+  uint32_t errorCount() const { return errorCount_; }
+
+private:
+  enum State : uint8_t { IDLE, START_PULSE, CAPTURE };
+
+  static void IRAM_ATTR onEdge(void *arg);
+  static void onStartPulseDone(void *arg);
+  bool decode();
+
+  uint8_t pin_;
+  esp_timer_handle_t startTimer_ = nullptr;
+
+  volatile State state_ = IDLE;
+  volatile uint8_t edgeCount_ = 0;
+  volatile uint32_t edges_[DHT22_FRAME_EDGES];
+  uint32_t captureStartUs_ = 0;
+  unsigned long lastStartMs_ = 0;
+  bool started_ = false;
+
+  float temperature_ = NAN;
+  float humidity_ = NAN;
+  unsigned long sampleTime_ = 0;
+  bool valid_ = false;
+  uint32_t errorCount_ = 0;
+};
+
+#endif  // DHT22_ASYNC_H
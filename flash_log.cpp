@@ -0,0 +1,204 @@
+#include "flash_log.h"
+
+#define RECORD_ERASED 0xFF
+#define RECORD_STORED 0xFE
+#define RECORD_SENT 0x00
+
+static uint8_t crc8(const uint8_t *data, size_t len) {
+  uint8_t crc = 0;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= data[i];
+    for (int b = 0; b < 8; b++) {
+      crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+static bool recordValid(const uint8_t *rec) {
+  return rec[0] == RECORD_STORED && rec[1] == crc8(rec + 2, FLASH_LOG_RECORD_SIZE - 2);
+}
+
+void FlashLog::advance(log_pos &p) const {
+  if (++p.slot >= FLASH_LOG_SLOTS_PER_SECTOR) {
+    p.slot = 1;
+    p.sector = (p.sector + 1) % sectors_;
+  }
+}
+
+bool FlashLog::readRecord(const log_pos &p, uint8_t *rec) const {
+  return esp_partition_read(part_, offsetOf(p), rec, FLASH_LOG_RECORD_SIZE) == ESP_OK;
+}
+
+bool FlashLog::startSector(uint32_t sector, uint32_t seq) {
+  uint32_t base = sector * FLASH_LOG_SECTOR_SIZE;
+  if (esp_partition_erase_range(part_, base, FLASH_LOG_SECTOR_SIZE) != ESP_OK) return false;
+
+  uint8_t header[FLASH_LOG_RECORD_SIZE];
+  memset(header, 0xFF, sizeof(header));
+  framePut32(header, FLASH_LOG_MAGIC);
+  framePut32(header + 4, seq);
+  if (esp_partition_write(part_, base, header, sizeof(header)) != ESP_OK) return false;
+
+  writeSeq_ = seq;
+  write_.sector = sector;
+  write_.slot = 1;
+  return true;
+}
+
+/**
+ * @brief Open the next sector once the current one is full
+ *
+ * Done eagerly after the last slot is written so the write pointer always
+ * names an erased slot.
+ */
+bool FlashLog::rollover() {
+  uint32_t next = (write_.sector + 1) % sectors_;
+
+  // Log full: the oldest sector is about to be erased, drop what's left of it
+  if (count_ > 0 && read_.sector == next) {
+    size_t lost = FLASH_LOG_SLOTS_PER_SECTOR - read_.slot;
+    if (lost > count_) lost = count_;
+    count_ -= lost;
+    dropped_ += lost;
+    read_.sector = (next + 1) % sectors_;
+    read_.slot = 1;
+  }
+  if (!startSector(next, writeSeq_ + 1)) return false;
+  if (count_ == 0) read_ = write_;
+  return true;
+}
+
+/**
+ * @brief Locate the newest and oldest initialized sectors from their headers
+ * @return false if no sector carries a valid header
+ */
+bool FlashLog::findSectors(uint32_t &newest, uint32_t &oldest, uint32_t &newestSeq) const {
+  bool found = false;
+  uint32_t oldestSeq = 0;
+  for (uint32_t s = 0; s < sectors_; s++) {
+    uint8_t header[8];
+    if (esp_partition_read(part_, s * FLASH_LOG_SECTOR_SIZE, header, sizeof(header)) != ESP_OK) continue;
+    if (frameGet32(header) != FLASH_LOG_MAGIC) continue;
+    uint32_t seq = frameGet32(header + 4);
+    if (!found || (int32_t)(seq - newestSeq) > 0) { newest = s; newestSeq = seq; }
+    if (!found || (int32_t)(seq - oldestSeq) < 0) { oldest = s; oldestSeq = seq; }
+    found = true;
+  }
+  return found;
+}
+
+bool FlashLog::begin(const char *label) {
+  part_ = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+  if (part_ == nullptr) return false;
+  sectors_ = part_->size / FLASH_LOG_SECTOR_SIZE;
+  if (sectors_ < 2) {
+    part_ = nullptr;
+    return false;
+  }
+
+  count_ = 0;
+  uint32_t newest = 0, oldest = 0, newestSeq = 0;
+  if (!findSectors(newest, oldest, newestSeq)) {
+    if (!startSector(0, 1)) return false;
+    read_ = write_;
+    return true;
+  }
+
+  // Write pointer: first erased slot of the newest sector
+  writeSeq_ = newestSeq;
+  write_ = {newest, 1};
+  uint8_t rec[FLASH_LOG_RECORD_SIZE];
+  while (write_.slot < FLASH_LOG_SLOTS_PER_SECTOR) {
+    if (!readRecord(write_, rec) || rec[0] == RECORD_ERASED) break;
+    write_.slot++;
+  }
+
+  // Rebooted right after filling the newest sector: open the next one now
+  if (write_.slot >= FLASH_LOG_SLOTS_PER_SECTOR) {
+    if (!startSector((newest + 1) % sectors_, newestSeq + 1)) return false;
+    findSectors(newest, oldest, newestSeq);
+  }
+
+  // Count unsent records from the oldest sector up to the write pointer,
+  // a chunk of records per flash read to keep the boot scan short
+  uint8_t chunk[FLASH_LOG_RECORD_SIZE * 16];
+  for (uint32_t s = oldest;; s = (s + 1) % sectors_) {
+    uint32_t end = (s == write_.sector) ? write_.slot : FLASH_LOG_SLOTS_PER_SECTOR;
+    for (uint32_t slot = 1; slot < end; slot += 16) {
+      uint32_t n = end - slot < 16 ? end - slot : 16;
+      if (esp_partition_read(part_, offsetOf({s, slot}), chunk, n * FLASH_LOG_RECORD_SIZE) != ESP_OK) continue;
+      for (uint32_t i = 0; i < n; i++) {
+        if (recordValid(chunk + i * FLASH_LOG_RECORD_SIZE)) count_++;
+      }
+    }
+    if (s == write_.sector) break;
+  }
+  read_ = {oldest, 1};
+  skipInvalid();
+  return true;
+}
+
+/**
+ * @brief Move the read pointer over sent or torn records
+ */
+void FlashLog::skipInvalid() {
+  uint8_t rec[FLASH_LOG_RECORD_SIZE];
+  while (count_ > 0 && !atWrite(read_)) {
+    if (readRecord(read_, rec) && recordValid(rec)) return;
+    advance(read_);
+  }
+  if (count_ == 0) read_ = write_;
+}
+
+bool FlashLog::append(const sensor_data &sample) {
+  if (part_ == nullptr) return false;
+
+  if (count_ == 0) read_ = write_;
+
+  uint8_t rec[FLASH_LOG_RECORD_SIZE];
+  rec[0] = RECORD_STORED;
+  framePut32(rec + 2, (uint32_t)sample.timestamp);
+  encodeSampleRecord(rec + 6, sample, (uint32_t)sample.timestamp);
+  rec[1] = crc8(rec + 2, FLASH_LOG_RECORD_SIZE - 2);
+
+  if (esp_partition_write(part_, offsetOf(write_), rec, sizeof(rec)) != ESP_OK) return false;
+  write_.slot++;
+  count_++;
+
+  if (write_.slot >= FLASH_LOG_SLOTS_PER_SECTOR) {
+    return rollover();
+  }
+  return true;
+}
+
+size_t FlashLog::peek(sensor_data *out, size_t max) {
+  if (part_ == nullptr) return 0;
+
+  size_t n = 0;
+  log_pos p = read_;
+  uint8_t rec[FLASH_LOG_RECORD_SIZE];
+  while (n < max && n < count_) {
+    if (!readRecord(p, rec) || !recordValid(rec)) break;  // Contiguous run only
+    decodeSampleRecord(rec + 6, frameGet32(rec + 2), out[n++]);
+    advance(p);
+  }
+  return n;
+}
+
+void FlashLog::consume(size_t n) {
+  if (part_ == nullptr) return;
+
+  const uint8_t sent = RECORD_SENT;
+  while (n > 0 && count_ > 0) {
+    esp_partition_write(part_, offsetOf(read_), &sent, 1);
+    advance(read_);
+    count_--;
+    n--;
+  }
+  if (count_ == 0) {
+    read_ = write_;
+  } else {
+    skipInvalid();
+  }
+}
@@ -0,0 +1,84 @@
+#ifndef FLASH_LOG_H
+#define FLASH_LOG_H
+
+#include <Arduino.h>
+#include <esp_partition.h>
+#include "sensor_frame.h"
+
+// ==================== FLASH STORE-AND-FORWARD LOG ====================
+//
+// Append-only ring of fixed 16-byte sample records in a raw data partition
+// (see partitions.csv). Sectors are written strictly in ring order and only
+// erased when the write pointer wraps onto them, so wear is spread evenly
+// across the whole partition. Each sector starts with a header carrying an
+// increasing sequence number, which lets begin() find the newest and oldest
+// sectors after a reboot. RAM use is just the read/write pointers.
+//
+// Record layout:
+//   [0]      state: 0xFF erased, 0xFE stored, 0x00 sent
+//   [1]      CRC-8 over bytes 2..15 (detects writes torn by power loss)
+//   [2..5]   absolute timestamp (ms)
+//   [6..15]  sample record (sensor_frame.h) relative to that timestamp
+//
+// Marking a record sent only clears bits, so no erase is needed to drain.
+
+#define FLASH_LOG_RECORD_SIZE 16
+#define FLASH_LOG_SECTOR_SIZE 4096
+#define FLASH_LOG_SLOTS_PER_SECTOR (FLASH_LOG_SECTOR_SIZE / FLASH_LOG_RECORD_SIZE)  // Slot 0 = header
+#define FLASH_LOG_MAGIC 0x464C4F47  // "FLOG"
+
+class FlashLog {
+public:
+  /**
+   * @brief Mount the log on the named data partition, recovering its pointers
+   * @return false if the partition is missing or unusable
+   */
+  bool begin(const char *label);
+
+  /**
+   * @brief Store one sample; overwrites the oldest sector when the log is full
+   */
+  bool append(const sensor_data &sample);
+
+  /**
+   * @brief Copy up to max of the oldest unsent samples without removing them
+   * @return Number of samples copied
+   */
+  size_t peek(sensor_data *out, size_t max);
+
+  /**
+   * @brief Mark the n oldest samples as sent (after peek())
+   */
+  void consume(size_t n);
+
+  size_t count() const { return count_; }
+  uint32_t dropped() const { return dropped_; }
+  bool ready() const { return part_ != nullptr; }
+
+private:
+  typedef struct log_pos {
+    uint32_t sector;
+    uint32_t slot;
+  } log_pos;
+
+  uint32_t offsetOf(const log_pos &p) const {
+    return p.sector * FLASH_LOG_SECTOR_SIZE + p.slot * FLASH_LOG_RECORD_SIZE;
+  }
+  void advance(log_pos &p) const;
+  bool atWrite(const log_pos &p) const { return p.sector == write_.sector && p.slot == write_.slot; }
+  bool readRecord(const log_pos &p, uint8_t *rec) const;
+  bool startSector(uint32_t sector, uint32_t seq);
+  bool rollover();
+  bool findSectors(uint32_t &newest, uint32_t &oldest, uint32_t &newestSeq) const;
+  void skipInvalid();
+
+  const esp_partition_t *part_ = nullptr;
+  uint32_t sectors_ = 0;
+  uint32_t writeSeq_ = 0;
+  log_pos write_ = {0, 1};
+  log_pos read_ = {0, 1};
+  size_t count_ = 0;
+  uint32_t dropped_ = 0;
+};
+
+#endif  // FLASH_LOG_H
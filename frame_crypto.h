@@ -0,0 +1,273 @@
+#ifndef FRAME_CRYPTO_H
+#define FRAME_CRYPTO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <mbedtls/gcm.h>
+#include <mbedtls/md.h>
+#include "sensor_frame.h"
+
+// ==================== FRAME ENCRYPTION ====================
+//
+// Two ways to keep readings off the air in cleartext, both keyed from one
+// 16-byte fleet key shared by the senders and their gateways:
+//
+//   ESP-NOW CCMP   Sender and gateway register each other as encrypted
+//                  peers, with an LMK derived from the fleet key and the
+//                  sender MAC. The Wi-Fi MAC encrypts in hardware at no
+//                  throughput cost, but ESP-NOW caps the encrypted peers per
+//                  device (ESP_NOW_MAX_ENCRYPT_PEER_NUM, 17 at most), which a
+//                  gateway serving more senders runs out of.
+//
+//   FRAME_SEALED   The frame body is encrypted with AES-128-GCM under a key
+//                  derived the same way. mbedtls runs the block cipher on the
+//                  ESP32 AES engine. Works for any number of senders, for
+//                  21 bytes per frame.
+//
+// A FRAME_SEALED keeps the 13-byte header in clear (the gateway needs the
+// MAC to pick the key) and wraps the original frame:
+//
+//   [0]      inner frame type
+//   [1..4]   nonce counter
+//   [5..]    inner frame body, encrypted
+//   [n-16..] GCM tag over the header, inner type, counter and body
+//
+// The IV is the counter followed by eight zero bytes. Keys are per sender,
+// so a sender must never reuse a counter under its key. A gateway accepts
+// each counter from a sender once, within a window of the last
+// FRAME_REPLAY_WINDOW counters (frameAcceptCounter()). That also drops
+// retransmitted copies, and still accepts frames that an alarm overtook in
+// the send queue.
+//
+// Control frames stay in cleartext but are authenticated: a FRAME_BEACON by
+// a tag under the gateway's "bcn" key, bound to the nonce of the
+// FRAME_DISCOVER it answers (an old beacon cannot be replayed into a
+// pairing). Configs, offers and the sender's replies carry a tag under that
+// sender's "ctrl" key, broadcast chunks one under the fleet-wide "chunk" key.
+// A sender only applies settings whose tag it has checked itself.
+//
+// All of these keys derive from the one fleet key, which every sender and
+// gateway holds. They keep out devices that lack it, nothing more: anyone
+// who reads the fleet key out of one board's flash can compute every other
+// key, and so forge readings, configs and pairings for the whole fleet.
+// Enable flash encryption to make that harder. Firmware images are the
+// exception: they are signed with ECDSA by a release key that never leaves
+// the build host, and devices hold only its public half (ota_image.h).
+
+#define FRAME_KEY_SIZE 16
+#define FRAME_SEAL_TAG_SIZE 16
+#define FRAME_SEAL_PREFIX_SIZE 5  // Inner type + counter
+#define FRAME_SEAL_OVERHEAD (FRAME_SEAL_PREFIX_SIZE + FRAME_SEAL_TAG_SIZE)
+#define FRAME_REPLAY_WINDOW 32  // Bits in the replay bitmap
+
+/**
+ * @brief Derives a per-sender key: HMAC-SHA256(fleet key, label || MAC), truncated
+ * @param label "lmk" for the ESP-NOW peer key, "seal" for FRAME_SEALED
+ * @return false if mbedtls failed
+ */
+inline bool frameDeriveKey(const uint8_t fleetKey[FRAME_KEY_SIZE], const char *label,
+                           const uint8_t mac[6], uint8_t out[FRAME_KEY_SIZE]) {
+  uint8_t input[16 + 6];
+  size_t labelLen = strlen(label);
+  if (labelLen > 16) return false;
+  memcpy(input, label, labelLen);
+  memcpy(input + labelLen, mac, 6);
+
+  uint8_t digest[32];
+  const mbedtls_md_info_t *sha256 = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
+  if (mbedtls_md_hmac(sha256, fleetKey, FRAME_KEY_SIZE, input, labelLen + 6, digest) != 0) {
+    return false;
+  }
+  memcpy(out, digest, FRAME_KEY_SIZE);
+  return true;
+}
+
+inline void frameSealIv(uint32_t counter, uint8_t iv[12]) {
+  memset(iv, 0, 12);
+  framePut32(iv, counter);
+}
+
+/**
+ * @brief Wraps an encoded frame into a FRAME_SEALED
+ * @param frame Plain frame (any type), at most len - FRAME_SEAL_OVERHEAD bytes
+ * @param out Output buffer, may not overlap frame
+ * @return Sealed frame length, or 0 if it does not fit or encryption failed
+ */
+inline size_t sealFrame(const uint8_t key[FRAME_KEY_SIZE], uint32_t counter,
+                        const uint8_t *frame, size_t frameLen, uint8_t *out, size_t len) {
+  if (frameLen < FRAME_HEADER_SIZE || frameLen + FRAME_SEAL_OVERHEAD > len) return 0;
+  size_t bodyLen = frameLen - FRAME_HEADER_SIZE;
+
+  memcpy(out, frame, FRAME_HEADER_SIZE);
+  out[0] = (uint8_t)((frame[0] & 0xF0) | FRAME_SEALED);
+  out[FRAME_HEADER_SIZE] = frame[0] & 0x0F;
+  framePut32(out + FRAME_HEADER_SIZE + 1, counter);
+
+  uint8_t iv[12];
+  frameSealIv(counter, iv);
+  uint8_t *body = out + FRAME_HEADER_SIZE + FRAME_SEAL_PREFIX_SIZE;
+
+  mbedtls_gcm_context gcm;
+  mbedtls_gcm_init(&gcm);
+  int err = mbedtls_gcm_setkey(&gcm, MBEDTLS_CIPHER_ID_AES, key, FRAME_KEY_SIZE * 8);
+  if (err == 0) {
+    err = mbedtls_gcm_crypt_and_tag(&gcm, MBEDTLS_GCM_ENCRYPT, bodyLen, iv, sizeof(iv),
+                                    out, FRAME_HEADER_SIZE + FRAME_SEAL_PREFIX_SIZE,
+                                    frame + FRAME_HEADER_SIZE, body,
+                                    FRAME_SEAL_TAG_SIZE, body + bodyLen);
+  }
+  mbedtls_gcm_free(&gcm);
+  return err == 0 ? frameLen + FRAME_SEAL_OVERHEAD : 0;
+}
+
+/**
+ * @brief Authenticates and decrypts a FRAME_SEALED back into the inner frame
+ * @param out Output buffer of at least len - FRAME_SEAL_OVERHEAD bytes, may not overlap buf
+ * @param counter Set to the frame's nonce counter (check it against replays)
+ * @return Inner frame length, or 0 if the frame is malformed or fails authentication
+ */
+inline size_t openFrame(const uint8_t key[FRAME_KEY_SIZE], const uint8_t *buf, size_t len,
+                        uint8_t *out, size_t outLen, uint32_t &counter) {
+  frame_header hdr;
+  if (!decodeFrameHeader(buf, len, hdr) || hdr.type != FRAME_SEALED) return 0;
+  if (len < FRAME_HEADER_SIZE + FRAME_SEAL_OVERHEAD) return 0;
+  size_t bodyLen = len - FRAME_HEADER_SIZE - FRAME_SEAL_OVERHEAD;
+  if (FRAME_HEADER_SIZE + bodyLen > outLen) return 0;
+
+  counter = frameGet32(buf + FRAME_HEADER_SIZE + 1);
+  uint8_t iv[12];
+  frameSealIv(counter, iv);
+  const uint8_t *body = buf + FRAME_HEADER_SIZE + FRAME_SEAL_PREFIX_SIZE;
+
+  mbedtls_gcm_context gcm;
+  mbedtls_gcm_init(&gcm);
+  int err = mbedtls_gcm_setkey(&gcm, MBEDTLS_CIPHER_ID_AES, key, FRAME_KEY_SIZE * 8);
+  if (err == 0) {
+    err = mbedtls_gcm_auth_decrypt(&gcm, bodyLen, iv, sizeof(iv),
+                                   buf, FRAME_HEADER_SIZE + FRAME_SEAL_PREFIX_SIZE,
+                                   body + bodyLen, FRAME_SEAL_TAG_SIZE,
+                                   body, out + FRAME_HEADER_SIZE);
+  }
+  mbedtls_gcm_free(&gcm);
+  if (err != 0) return 0;
+
+  memcpy(out, buf, FRAME_HEADER_SIZE);
+  out[0] = (uint8_t)((buf[0] & 0xF0) | (buf[FRAME_HEADER_SIZE] & 0x0F));
+  return FRAME_HEADER_SIZE + bodyLen;
+}
+
+/**
+ * @brief Replay check for the nonce counter of an authenticated FRAME_SEALED
+ * @param highest Highest counter accepted so far from this sender
+ * @param seen Bit i set: counter highest - i was accepted (0 before the first frame)
+ * @return true if the counter is new; highest and seen are updated
+ */
+inline bool frameAcceptCounter(uint32_t counter, uint32_t &highest, uint32_t &seen) {
+  if (seen == 0 || (int32_t)(counter - highest) > 0) {
+    uint32_t shift = seen == 0 ? FRAME_REPLAY_WINDOW : counter - highest;
+    seen = (shift >= FRAME_REPLAY_WINDOW ? 0 : seen << shift) | 1u;
+    highest = counter;
+    return true;
+  }
+  uint32_t age = highest - counter;
+  if (age >= FRAME_REPLAY_WINDOW || (seen & (1u << age))) return false;
+  seen |= 1u << age;
+  return true;
+}
+
+/**
+ * @brief Fleet-wide key, the same on every sender
+ * @param label "chunk" for FRAME_OTA_CHUNK tags
+ */
+inline bool frameDeriveFleetKey(const uint8_t fleetKey[FRAME_KEY_SIZE], const char *label,
+                                uint8_t out[FRAME_KEY_SIZE]) {
+  static const uint8_t everyNode[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+  return frameDeriveKey(fleetKey, label, everyNode, out);
+}
+
+/**
+ * @brief Constant-time comparison, for tags
+ */
+inline bool frameTagEqual(const uint8_t *a, const uint8_t *b, size_t len) {
+  uint8_t diff = 0;
+  for (size_t i = 0; i < len; i++) diff |= a[i] ^ b[i];
+  return diff == 0;
+}
+
+/**
+ * @brief HMAC-SHA256 of a beacon and the FRAME_DISCOVER it answers, truncated
+ */
+inline bool frameBeaconTag(const uint8_t key[FRAME_KEY_SIZE], const uint8_t *buf, size_t frameLen,
+                           const uint8_t sender[6], uint32_t nonce, uint8_t tag[FRAME_BEACON_TAG_SIZE]) {
+  uint8_t challenge[10];
+  memcpy(challenge, sender, 6);
+  framePut32(challenge + 6, nonce);
+  uint8_t digest[32];
+  mbedtls_md_context_t md;
+  mbedtls_md_init(&md);
+  bool ok = mbedtls_md_setup(&md, mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), 1) == 0 &&
+            mbedtls_md_hmac_starts(&md, key, FRAME_KEY_SIZE) == 0 &&
+            mbedtls_md_hmac_update(&md, buf, frameLen) == 0 &&
+            mbedtls_md_hmac_update(&md, challenge, sizeof(challenge)) == 0 &&
+            mbedtls_md_hmac_finish(&md, digest) == 0;
+  mbedtls_md_free(&md);
+  if (ok) memcpy(tag, digest, FRAME_BEACON_TAG_SIZE);
+  return ok;
+}
+
+/**
+ * @brief Appends the tag to a FRAME_BEACON from encodeBeaconFrame()
+ * @param key The gateway's beacon key ("bcn", derived with its own MAC)
+ * @param sender, nonce MAC and header nonce of the FRAME_DISCOVER being answered
+ * @return Signed frame length, or 0 if it does not fit or mbedtls failed
+ */
+inline size_t signBeaconFrame(const uint8_t key[FRAME_KEY_SIZE], uint8_t *buf, size_t frameLen, size_t len,
+                              const uint8_t sender[6], uint32_t nonce) {
+  if (frameLen == 0 || frameLen + FRAME_BEACON_TAG_SIZE > len) return 0;
+  if (!frameBeaconTag(key, buf, frameLen, sender, nonce, buf + frameLen)) return 0;
+  return frameLen + FRAME_BEACON_TAG_SIZE;
+}
+
+/**
+ * @brief Checks that a FRAME_BEACON answers this sender's FRAME_DISCOVER
+ * @param key The beacon key of the gateway it came from
+ */
+inline bool verifyBeaconFrame(const uint8_t key[FRAME_KEY_SIZE], const uint8_t *buf, size_t len,
+                              const uint8_t sender[6], uint32_t nonce) {
+  if (len < FRAME_BEACON_SIZE) return false;
+  uint8_t tag[FRAME_BEACON_TAG_SIZE];
+  size_t frameLen = FRAME_BEACON_SIZE - FRAME_BEACON_TAG_SIZE;
+  return frameBeaconTag(key, buf, frameLen, sender, nonce, tag) &&
+         frameTagEqual(tag, buf + frameLen, FRAME_BEACON_TAG_SIZE);
+}
+
+/**
+ * @brief Appends the tag to a control frame from one of the encoders in sensor_frame.h
+ * @param key The sender's control key ("ctrl", derived with its MAC), or the
+ *            fleet chunk key for a FRAME_OTA_CHUNK
+ * @param len Buffer capacity
+ * @return Signed frame length, or 0 if it does not fit or mbedtls failed
+ */
+inline size_t signControlFrame(const uint8_t key[FRAME_KEY_SIZE], uint8_t *buf, size_t frameLen, size_t len) {
+  if (frameLen == 0 || frameLen + FRAME_CONTROL_TAG_SIZE > len) return 0;
+  uint8_t digest[32];
+  const mbedtls_md_info_t *sha256 = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
+  if (mbedtls_md_hmac(sha256, key, FRAME_KEY_SIZE, buf, frameLen, digest) != 0) return 0;
+  memcpy(buf + frameLen, digest, FRAME_CONTROL_TAG_SIZE);
+  return frameLen + FRAME_CONTROL_TAG_SIZE;
+}
+
+/**
+ * @brief Checks the tag of a received control frame
+ */
+inline bool verifyControlFrame(const uint8_t key[FRAME_KEY_SIZE], const uint8_t *buf, size_t len) {
+  if (len < FRAME_HEADER_SIZE + FRAME_CONTROL_TAG_SIZE) return false;
+  size_t frameLen = len - FRAME_CONTROL_TAG_SIZE;
+  uint8_t digest[32];
+  const mbedtls_md_info_t *sha256 = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
+  if (mbedtls_md_hmac(sha256, key, FRAME_KEY_SIZE, buf, frameLen, digest) != 0) return false;
+  return frameTagEqual(digest, buf + frameLen, FRAME_CONTROL_TAG_SIZE);
+}
+
+#endif  // FRAME_CRYPTO_H
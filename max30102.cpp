@@ -0,0 +1,240 @@
+#include "max30102.h"
+
+#define REG_INT_STATUS_1 0x00
+#define REG_INT_STATUS_2 0x01
+#define REG_INT_ENABLE_1 0x02
+#define REG_INT_ENABLE_2 0x03
+#define REG_FIFO_WR_PTR 0x04
+#define REG_OVF_COUNTER 0x05
+#define REG_FIFO_RD_PTR 0x06
+#define REG_FIFO_DATA 0x07
+#define REG_FIFO_CONFIG 0x08
+#define REG_MODE_CONFIG 0x09
+#define REG_SPO2_CONFIG 0x0A
+#define REG_LED1_PA 0x0C  // Red
+#define REG_LED2_PA 0x0D  // IR
+#define REG_PART_ID 0xFF
+
+#define INT_A_FULL 0x80
+#define MODE_SHDN 0x80
+#define MODE_RESET 0x40
+#define MODE_SPO2 0x03
+
+#define SAMPLE_BYTES 6        // 3 bytes red + 3 bytes IR
+#define LED_CURRENT 0x24      // ~7 mA
+#define DRAIN_FALLBACK_MS 500 // Drain even without an interrupt (missed edge)
+
+bool Max30102::writeReg(uint8_t reg, uint8_t value) {
+  wire_->beginTransmission(MAX30102_I2C_ADDR);
+  wire_->write(reg);
+  wire_->write(value);
+  return wire_->endTransmission() == 0;
+}
+
+bool Max30102::readRegs(uint8_t reg, uint8_t *buf, size_t len) {
+  wire_->beginTransmission(MAX30102_I2C_ADDR);
+  wire_->write(reg);
+  if (wire_->endTransmission(false) != 0) return false;
+  if (wire_->requestFrom((uint8_t)MAX30102_I2C_ADDR, (uint8_t)len) != len) return false;
+  for (size_t i = 0; i < len; i++) {
+    buf[i] = (uint8_t)wire_->read();
+  }
+  return true;
+}
+
+bool Max30102::begin(TwoWire &wire, uint8_t intPin) {
+  wire_ = &wire;
+  intPin_ = intPin;
+  running_ = false;
+
+  uint8_t partId = 0;
+  if (!readRegs(REG_PART_ID, &partId, 1) || partId != MAX30102_PART_ID) return false;
+
+  // Reset clears the FIFO and all settings; the bit self-clears within ~1 ms
+  writeReg(REG_MODE_CONFIG, MODE_RESET);
+  uint8_t mode = MODE_RESET;
+  for (int i = 0; i < 10 && (mode & MODE_RESET); i++) {
+    delay(1);
+    readRegs(REG_MODE_CONFIG, &mode, 1);
+  }
+
+  bool ok =
+      // 4-sample averaging, FIFO rollover, interrupt with 15 slots free (17 samples)
+      writeReg(REG_FIFO_CONFIG, (0x2 << 5) | 0x10 | 0x0F) &&
+      // 4096 nA range, 400 sps, 411 us pulses (18-bit)
+      writeReg(REG_SPO2_CONFIG, (0x1 << 5) | (0x3 << 2) | 0x3) &&
+      writeReg(REG_LED1_PA, LED_CURRENT) &&
+      writeReg(REG_LED2_PA, LED_CURRENT) &&
+      writeReg(REG_INT_ENABLE_1, INT_A_FULL) &&
+      writeReg(REG_INT_ENABLE_2, 0) &&
+      writeReg(REG_FIFO_WR_PTR, 0) &&
+      writeReg(REG_OVF_COUNTER, 0) &&
+      writeReg(REG_FIFO_RD_PTR, 0) &&
+      writeReg(REG_MODE_CONFIG, MODE_SPO2);
+  if (!ok) return false;
+
+  // Reading the status registers releases INT
+  uint8_t status[2];
+  readRegs(REG_INT_STATUS_1, status, sizeof(status));
+
+  resetBeat();
+  dcRed_ = 0;
+  dcIr_ = 0;
+  pending_ = false;
+  lastDrainMs_ = millis();
+
+  pinMode(intPin_, INPUT_PULLUP);
+  attachInterruptArg(digitalPinToInterrupt(intPin_), &Max30102::onInterrupt, this, FALLING);
+  running_ = true;
+  return true;
+}
+
+void Max30102::shutdown() {
+  if (!running_) return;
+  detachInterrupt(digitalPinToInterrupt(intPin_));
+  writeReg(REG_MODE_CONFIG, MODE_SHDN);
+  running_ = false;
+}
+
+/**
+ * @brief INT falling edge (FIFO almost full): defer the I2C work to poll()
+ */
+void IRAM_ATTR Max30102::onInterrupt(void *arg) {
+  static_cast<Max30102 *>(arg)->pending_ = true;
+}
+
+void Max30102::poll() {
+  if (!running_) return;
+  // INT stays low until the status is read, so a low level also catches an
+  // edge lost while the chip was in light sleep
+  if (!pending_ && digitalRead(intPin_) != LOW && millis() - lastDrainMs_ < DRAIN_FALLBACK_MS) return;
+  pending_ = false;
+  lastDrainMs_ = millis();
+
+  uint8_t status;
+  readRegs(REG_INT_STATUS_1, &status, 1);
+  drainFifo();
+}
+
+/**
+ * @brief Read every unread FIFO sample in bursts and feed the pipeline
+ */
+void Max30102::drainFifo() {
+  uint8_t ptrs[3];  // WR_PTR, OVF_COUNTER, RD_PTR
+  if (!readRegs(REG_FIFO_WR_PTR, ptrs, sizeof(ptrs))) return;
+
+  size_t available = (ptrs[0] - ptrs[2]) & (MAX30102_FIFO_DEPTH - 1);
+  if (ptrs[1] != 0) {
+    overflows_ += ptrs[1];
+    available = MAX30102_FIFO_DEPTH;  // Wrapped: the FIFO is completely full
+  }
+
+  uint8_t burst[MAX30102_BURST_SAMPLES * SAMPLE_BYTES];
+  while (available > 0) {
+    size_t n = available < MAX30102_BURST_SAMPLES ? available : MAX30102_BURST_SAMPLES;
+    if (!readRegs(REG_FIFO_DATA, burst, n * SAMPLE_BYTES)) return;
+    for (size_t i = 0; i < n; i++) {
+      const uint8_t *p = burst + i * SAMPLE_BYTES;
+      int32_t red = (((int32_t)p[0] << 16) | ((int32_t)p[1] << 8) | p[2]) & 0x3FFFF;
+      int32_t ir = (((int32_t)p[3] << 16) | ((int32_t)p[4] << 8) | p[5]) & 0x3FFFF;
+      processSample(red, ir);
+    }
+    available -= n;
+  }
+}
+
+void Max30102::resetBeat() {
+  for (int i = 0; i < MAX30102_AVG_TAPS; i++) avgTaps_[i] = 0;
+  avgSum_ = 0;
+  avgIdx_ = 0;
+  prev_ = 0;
+  rising_ = false;
+  threshold_ = 0;
+  sinceBeat_ = 0;
+  haveBeat_ = false;
+  absRed_ = absIr_ = sumDcRed_ = sumDcIr_ = 0;
+  intervalCount_ = 0;
+  intervalIdx_ = 0;
+}
+
+/**
+ * @brief One 100 Hz sample through DC removal, smoothing and beat detection
+ */
+void Max30102::processSample(int32_t red, int32_t ir) {
+  samples_++;
+
+  // DC trackers, time constant 64 samples; seeded from the first sample
+  if (dcIr_ == 0) {
+    dcRed_ = red << 7;
+    dcIr_ = ir << 7;
+  }
+  dcRed_ += ((red << 7) - dcRed_) >> 6;
+  dcIr_ += ((ir << 7) - dcIr_) >> 6;
+  int32_t dcRed = dcRed_ >> 7;
+  int32_t dcIr = dcIr_ >> 7;
+
+  bool finger = dcIr >= MAX30102_FINGER_DC;
+  if (!finger) {
+    if (finger_) resetBeat();
+    finger_ = false;
+    return;
+  }
+  finger_ = true;
+
+  int32_t acRed = red - dcRed;
+  int32_t acIr = ir - dcIr;
+  absRed_ += acRed < 0 ? -acRed : acRed;
+  absIr_ += acIr < 0 ? -acIr : acIr;
+  sumDcRed_ += dcRed;
+  sumDcIr_ += dcIr;
+
+  // Blood volume rises absorption, so the pulse is a dip in IR: invert it
+  avgSum_ += -acIr - avgTaps_[avgIdx_];
+  avgTaps_[avgIdx_] = -acIr;
+  avgIdx_ = (avgIdx_ + 1) % MAX30102_AVG_TAPS;
+  int32_t pulse = avgSum_ / MAX30102_AVG_TAPS;
+
+  sinceBeat_++;
+  threshold_ -= threshold_ >> 8;  // Decays so a lost rhythm is picked up again
+
+  bool peak = rising_ && pulse < prev_;
+  rising_ = pulse > prev_;
+  int32_t height = prev_;
+  prev_ = pulse;
+  if (!peak || height <= threshold_ || sinceBeat_ < MAX30102_MIN_BEAT_SAMPLES) return;
+
+  threshold_ = height * 3 / 4;
+  uint32_t interval = sinceBeat_;
+  sinceBeat_ = 0;
+
+  // The first beat after a reset only starts the interval clock
+  if (haveBeat_ && interval <= MAX30102_MAX_BEAT_SAMPLES) {
+    intervals_[intervalIdx_] = (uint16_t)interval;
+    intervalIdx_ = (intervalIdx_ + 1) % MAX30102_BEAT_HISTORY;
+    if (intervalCount_ < MAX30102_BEAT_HISTORY) intervalCount_++;
+
+    uint32_t sum = 0;
+    for (uint8_t i = 0; i < intervalCount_; i++) sum += intervals_[i];
+    bpm10_ = (uint16_t)(60UL * MAX30102_SAMPLE_RATE_HZ * 10 * intervalCount_ / sum);
+
+    // Ratio of ratios over this beat, Q10: (ACred / DCred) / (ACir / DCir)
+    if (absIr_ > 0 && sumDcRed_ > 0) {
+      int64_t r = (absRed_ * sumDcIr_ * 1024) / (absIr_ * sumDcRed_);
+      int32_t spo2 = 1100 - (int32_t)((250 * r) >> 10);
+      if (spo2 > 1000) spo2 = 1000;
+      if (spo2 < 0) spo2 = 0;
+      spo210_ = spo210_ == 0 ? (uint16_t)spo2 : (uint16_t)(spo210_ + (spo2 - spo210_) / 4);
+    }
+    lastBeatMs_ = millis();
+  }
+  haveBeat_ = true;
+  absRed_ = absIr_ = sumDcRed_ = sumDcIr_ = 0;
+}
+
+bool Max30102::read(float &heartRate, float &spo2) const {
+  if (!running_ || !finger_ || intervalCount_ == 0) return false;
+  if (millis() - lastBeatMs_ > MAX30102_STALE_MS) return false;
+  heartRate = bpm10_ / 10.0f;
+  spo2 = spo210_ / 10.0f;
+  return true;
+}
@@ -0,0 +1,110 @@
+#ifndef MAX30102_H
+#define MAX30102_H
+
+#include <Arduino.h>
+#include <Wire.h>
+
+// ==================== MAX30102 PULSE OXIMETER DRIVER ====================
+//
+// Runs the sensor in SpO2 mode (red + IR) at 100 samples/s out of its
+// 32-sample on-chip FIFO. The FIFO-almost-full interrupt fires every 17
+// samples (170 ms); the ISR only raises a flag, and poll() then drains the
+// whole FIFO with I2C burst reads, so the CPU touches the sensor about six
+// times a second instead of a hundred.
+//
+// Every sample runs through an integer pipeline:
+//
+//   DC tracker (IIR, Q7) -> AC = raw - DC -> 8-tap moving average
+//     -> peak detector with adaptive threshold and 300 ms refractory period
+//
+// Heart rate is the mean of the last MAX30102_BEAT_HISTORY beat intervals.
+// SpO2 uses the ratio of ratios (red AC/DC over IR AC/DC, mean absolute AC
+// per beat) with the usual linear fit SpO2 = 110 - 25 R.
+
+#define MAX30102_I2C_ADDR 0x57
+#define MAX30102_PART_ID 0x15
+#define MAX30102_SAMPLE_RATE_HZ 100    // After on-chip averaging (400 sps / 4)
+#define MAX30102_FIFO_DEPTH 32
+#define MAX30102_BURST_SAMPLES 16      // 96 bytes, fits the Wire buffer
+#define MAX30102_FINGER_DC 50000       // IR DC below this: nothing on the sensor
+#define MAX30102_MIN_BEAT_SAMPLES 30   // 200 bpm
+#define MAX30102_MAX_BEAT_SAMPLES 200  // 30 bpm
+#define MAX30102_AVG_TAPS 8          // Moving average ahead of the peak detector
+#define MAX30102_BEAT_HISTORY 4
+#define MAX30102_STALE_MS 3000         // No beat for this long: readings invalid
+
+class Max30102 {
+public:
+  /**
+   * @brief Reset and configure the sensor and attach the FIFO interrupt
+   * @param intPin GPIO wired to the open-drain INT output
+   * @return false if no MAX30102 answers on the bus
+   */
+  bool begin(TwoWire &wire, uint8_t intPin);
+
+  /**
+   * @brief Drain the FIFO if the interrupt fired; cheap to call often
+   */
+  void poll();
+
+  /**
+   * @brief Latest heart rate (bpm) and SpO2 (%)
+   * @return false without a finger on the sensor or a recent beat
+   */
+  bool read(float &heartRate, float &spo2) const;
+
+  /**
+   * @brief Power the sensor down (LEDs off, ~1 uA) until begin() is called again
+   */
+  void shutdown();
+
+  bool running() const { return running_; }
+  bool fingerPresent() const { return finger_; }
+  uint32_t sampleCount() const { return samples_; }
+  uint32_t overflowCount() const { return overflows_; }
+
+private:
+  static void IRAM_ATTR onInterrupt(void *arg);
+  bool writeReg(uint8_t reg, uint8_t value);
+  bool readRegs(uint8_t reg, uint8_t *buf, size_t len);
+  void drainFifo();
+  void processSample(int32_t red, int32_t ir);
+  void resetBeat();
+
+  TwoWire *wire_ = nullptr;
+  uint8_t intPin_ = 0;
+  bool running_ = false;
+  volatile bool pending_ = false;
+  unsigned long lastDrainMs_ = 0;
+
+  // Signal pipeline (Q7 DC estimates, raw-unit AC)
+  int32_t dcRed_ = 0;
+  int32_t dcIr_ = 0;
+  int32_t avgTaps_[MAX30102_AVG_TAPS] = {};
+  int32_t avgSum_ = 0;
+  uint8_t avgIdx_ = 0;
+  int32_t prev_ = 0;
+  bool rising_ = false;
+  int32_t threshold_ = 0;
+  uint32_t sinceBeat_ = 0;
+  bool haveBeat_ = false;
+  bool finger_ = false;
+
+  // Per-beat accumulators for the ratio of ratios
+  int64_t absRed_ = 0;
+  int64_t absIr_ = 0;
+  int64_t sumDcRed_ = 0;
+  int64_t sumDcIr_ = 0;
+
+  uint16_t intervals_[MAX30102_BEAT_HISTORY];
+  uint8_t intervalCount_ = 0;
+  uint8_t intervalIdx_ = 0;
+  uint16_t bpm10_ = 0;   // 0.1 bpm
+  uint16_t spo210_ = 0;  // 0.1 %
+  unsigned long lastBeatMs_ = 0;
+
+  uint32_t samples_ = 0;
+  uint32_t overflows_ = 0;
+};
+
+#endif  // MAX30102_H
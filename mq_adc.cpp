@@ -0,0 +1,128 @@
+#include "mq_adc.h"
+#include <esp_adc/adc_cali_scheme.h>
+
+bool MqAdc::begin(uint8_t pin) {
+  adc_unit_t unit;
+  if (adc_continuous_io_to_channel(pin, &unit, &channel_) != ESP_OK || unit != ADC_UNIT_1) {
+    return false;  // ADC2 cannot run alongside Wi-Fi
+  }
+
+  adc_continuous_handle_cfg_t handleCfg = {};
+  handleCfg.max_store_buf_size = MQ_ADC_POOL_BYTES;
+  handleCfg.conv_frame_size = MQ_ADC_FRAME_BYTES;
+  if (adc_continuous_new_handle(&handleCfg, &handle_) != ESP_OK) {
+    handle_ = nullptr;
+    return false;
+  }
+
+  adc_digi_pattern_config_t pattern = {};
+  pattern.atten = ADC_ATTEN_DB_12;  // Full range: 0-3.3V
+  pattern.channel = channel_;
+  pattern.unit = ADC_UNIT_1;
+  pattern.bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+
+  adc_continuous_config_t digCfg = {};
+  digCfg.sample_freq_hz = MQ_ADC_SAMPLE_FREQ_HZ;
+  digCfg.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+  digCfg.format = ADC_DIGI_OUTPUT_FORMAT_TYPE1;
+  digCfg.pattern_num = 1;
+  digCfg.adc_pattern = &pattern;
+
+  adc_continuous_evt_cbs_t cbs = {};
+  cbs.on_conv_done = &MqAdc::onConvDone;
+
+  if (adc_continuous_config(handle_, &digCfg) != ESP_OK ||
+      adc_continuous_register_event_callbacks(handle_, &cbs, this) != ESP_OK ||
+      adc_continuous_start(handle_) != ESP_OK) {
+    adc_continuous_deinit(handle_);
+    handle_ = nullptr;
+    return false;
+  }
+
+  // eFuse calibration (Vref / two-point); readings stay raw-only without it
+  adc_cali_line_fitting_config_t caliCfg = {};
+  caliCfg.unit_id = ADC_UNIT_1;
+  caliCfg.atten = ADC_ATTEN_DB_12;
+  caliCfg.bitwidth = ADC_BITWIDTH_12;
+  if (adc_cali_create_scheme_line_fitting(&caliCfg, &cali_) != ESP_OK) {
+    cali_ = nullptr;
+  }
+
+  return true;
+}
+
+/**
+ * @brief Fold one DMA frame's statistics into an accumulator (ISR context)
+ */
+void IRAM_ATTR MqAdc::fold(accumulator &acc, uint32_t count, uint32_t sum, uint16_t lo, uint16_t hi) {
+  acc.count += count;
+  acc.sum += sum;
+  if (lo < acc.min) acc.min = lo;
+  if (hi > acc.max) acc.max = hi;
+}
+
+/**
+ * @brief DMA conversion-done ISR: fold one frame into both running windows
+ */
+bool IRAM_ATTR MqAdc::onConvDone(adc_continuous_handle_t handle,
+                                 const adc_continuous_evt_data_t *edata, void *userData) {
+  MqAdc *self = static_cast<MqAdc *>(userData);
+  const adc_digi_output_data_t *p = (const adc_digi_output_data_t *)edata->conv_frame_buffer;
+  const adc_digi_output_data_t *end = p + edata->size / SOC_ADC_DIGI_RESULT_BYTES;
+
+  uint32_t count = 0, sum = 0;
+  uint16_t lo = 0xFFFF, hi = 0;
+  for (; p < end; p++) {
+    if (p->type1.channel != self->channel_) continue;
+    uint16_t raw = p->type1.data;
+    sum += raw;
+    count++;
+    if (raw < lo) lo = raw;
+    if (raw > hi) hi = raw;
+  }
+
+  portENTER_CRITICAL_ISR(&self->lock_);
+  fold(self->report_, count, sum, lo, hi);
+  fold(self->watch_, count, sum, lo, hi);
+  portEXIT_CRITICAL_ISR(&self->lock_);
+
+  return false;  // No higher-priority task woken
+}
+
+bool MqAdc::takeWindow(mq_window &window) {
+  if (handle_ == nullptr) return false;
+
+  portENTER_CRITICAL(&lock_);
+  accumulator acc = report_;
+  report_ = {0, 0, 0xFFFF, 0};
+  watch_ = {0, 0, 0xFFFF, 0};  // The reading just taken covers it
+  portEXIT_CRITICAL(&lock_);
+
+  return summarize(acc, window);
+}
+
+bool MqAdc::takeWatchWindow(mq_window &window) {
+  if (handle_ == nullptr) return false;
+
+  portENTER_CRITICAL(&lock_);
+  accumulator acc = watch_;
+  watch_ = {0, 0, 0xFFFF, 0};
+  portEXIT_CRITICAL(&lock_);
+
+  return summarize(acc, window);
+}
+
+bool MqAdc::summarize(const accumulator &acc, mq_window &window) {
+  if (acc.count == 0) return false;
+
+  window.count = acc.count;
+  window.meanRaw = (uint16_t)((acc.sum + acc.count / 2) / acc.count);
+  window.minRaw = acc.min;
+  window.maxRaw = acc.max;
+  window.meanMv = -1;
+  int mv;
+  if (cali_ != nullptr && adc_cali_raw_to_voltage(cali_, window.meanRaw, &mv) == ESP_OK) {
+    window.meanMv = mv;
+  }
+  return true;
+}
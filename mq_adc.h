@@ -0,0 +1,76 @@
+#ifndef MQ_ADC_H
+#define MQ_ADC_H
+
+#include <Arduino.h>
+#include <esp_adc/adc_continuous.h>
+#include <esp_adc/adc_cali.h>
+
+// ==================== CONTINUOUS MQ ADC ====================
+//
+// Oversamples the MQ gas sensor with the ADC DMA (continuous-read) driver.
+// The conversion-done ISR folds every DMA frame straight into running
+// sum/min/max accumulators, so no task ever polls or copies raw samples;
+// takeWindow() swaps the accumulators out once per reporting window and
+// converts the mean to millivolts with the eFuse calibration. A second set
+// of accumulators runs alongside for checks between reports:
+// takeWatchWindow() swaps out only those, so a spike shows at full height in
+// the next check while the report window still covers the whole interval.
+
+#define MQ_ADC_SAMPLE_FREQ_HZ 20000  // Lowest rate the ESP32 ADC DMA supports
+#define MQ_ADC_FRAME_BYTES 256       // Bytes per DMA conversion frame
+#define MQ_ADC_POOL_BYTES 1024
+
+typedef struct mq_window {
+  uint32_t count;    // Conversions folded into this window
+  uint16_t meanRaw;
+  uint16_t minRaw;
+  uint16_t maxRaw;
+  int meanMv;        // Calibrated mean, -1 if no calibration scheme available
+} mq_window;
+
+class MqAdc {
+public:
+  /**
+   * @brief Start background conversions on an ADC1 pin
+   * @return false if the pin/driver could not be configured
+   */
+  bool begin(uint8_t pin);
+
+  /**
+   * @brief Returns the statistics gathered since the last call and resets them
+   * @return false if no conversions completed in this window
+   */
+  bool takeWindow(mq_window &window);
+
+  /**
+   * @brief Returns the statistics gathered since the last takeWatchWindow() or
+   *        takeWindow() and resets them, leaving the report window in place
+   * @return false if no conversions completed in this window yet
+   */
+  bool takeWatchWindow(mq_window &window);
+
+  bool running() const { return handle_ != nullptr; }
+
+private:
+  typedef struct accumulator {
+    uint32_t count;
+    uint64_t sum;
+    uint16_t min;
+    uint16_t max;
+  } accumulator;
+
+  static bool IRAM_ATTR onConvDone(adc_continuous_handle_t handle,
+                                   const adc_continuous_evt_data_t *edata, void *userData);
+  static void IRAM_ATTR fold(accumulator &acc, uint32_t count, uint32_t sum, uint16_t lo, uint16_t hi);
+  bool summarize(const accumulator &acc, mq_window &window);
+
+  adc_continuous_handle_t handle_ = nullptr;
+  adc_cali_handle_t cali_ = nullptr;
+  adc_channel_t channel_ = ADC_CHANNEL_0;
+
+  portMUX_TYPE lock_ = portMUX_INITIALIZER_UNLOCKED;
+  accumulator report_ = {0, 0, 0xFFFF, 0};
+  accumulator watch_ = {0, 0, 0xFFFF, 0};  // Window of the checks between reports
+};
+
+#endif  // MQ_ADC_H
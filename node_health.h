@@ -0,0 +1,79 @@
+#ifndef NODE_HEALTH_H
+#define NODE_HEALTH_H
+
+#include <stdint.h>
+#include <atomic>
+#include "sensor_frame.h"
+
+// ==================== NODE HEALTH ====================
+//
+// Runtime figures behind the health trailer (see sensor_frame.h). The radio
+// context publishes the send window state and the receiver's RSSI, the main
+// loop (or sensor task) its pass times, and the encoder takes a snapshot for
+// each trailer. In PIPELINE_MODE those are tasks on both cores, so every
+// field is a relaxed atomic: each value is read whole, and a snapshot that
+// straddles an update is fine for telemetry.
+//
+// Delivery totals are passed in rather than kept here, so the sender's
+// counters stay the single source. The ack rate is taken against a baseline
+// the caller owns, which lets it live in RTC memory across deep sleep.
+
+typedef struct health_baseline {
+  uint32_t acked;
+  uint32_t failed;
+} health_baseline;
+
+class NodeHealth {
+public:
+  void publishWindow(uint32_t queueDepth, uint32_t retransmits, uint32_t dropped) {
+    queueDepth_.store(queueDepth, std::memory_order_relaxed);
+    retransmits_.store(retransmits, std::memory_order_relaxed);
+    dropped_.store(dropped, std::memory_order_relaxed);
+  }
+
+  void publishRssi(int8_t rssi) { rssi_.store(rssi, std::memory_order_relaxed); }
+  void setWakeMs(uint32_t ms) { wakeMs_.store(ms, std::memory_order_relaxed); }
+  uint32_t wakeMs() const { return wakeMs_.load(std::memory_order_relaxed); }
+
+  /**
+   * @brief Record one main loop pass; the longest since the last snapshot is reported
+   */
+  void onLoopPass(uint32_t us) {
+    uint32_t longest = loopMaxUs_.load(std::memory_order_relaxed);
+    while (us > longest &&
+           !loopMaxUs_.compare_exchange_weak(longest, us, std::memory_order_relaxed)) {
+    }
+  }
+
+  /**
+   * @brief Fill a health record and start the next reporting period
+   * @param base Totals at the previous snapshot; updated to the current ones
+   */
+  void snapshot(health_record &h, uint32_t acked, uint32_t failed, uint32_t freeHeap,
+                health_baseline &base) {
+    uint32_t sent = (acked - base.acked) + (failed - base.failed);
+    h.acked = acked;
+    h.failed = failed;
+    h.retransmits = retransmits_.load(std::memory_order_relaxed);
+    h.dropped = dropped_.load(std::memory_order_relaxed);
+    h.ackRate = sent > 0 ? (uint8_t)((acked - base.acked) * 100ULL / sent) : FRAME_HEALTH_NO_RATE;
+    uint32_t depth = queueDepth_.load(std::memory_order_relaxed);
+    h.queueDepth = depth > 0xFF ? 0xFF : (uint8_t)depth;
+    h.rssi = (int8_t)rssi_.load(std::memory_order_relaxed);
+    h.freeHeap = freeHeap;
+    h.loopMaxUs = loopMaxUs_.exchange(0, std::memory_order_relaxed);
+    h.wakeMs = wakeMs_.load(std::memory_order_relaxed);
+    base.acked = acked;
+    base.failed = failed;
+  }
+
+private:
+  std::atomic<uint32_t> queueDepth_{0};
+  std::atomic<uint32_t> retransmits_{0};
+  std::atomic<uint32_t> dropped_{0};
+  std::atomic<int32_t> rssi_{0};
+  std::atomic<uint32_t> loopMaxUs_{0};
+  std::atomic<uint32_t> wakeMs_{0};
+};
+
+#endif  // NODE_HEALTH_H
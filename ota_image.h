@@ -0,0 +1,197 @@
+#ifndef OTA_IMAGE_H
+#define OTA_IMAGE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <esp_partition.h>
+#include <mbedtls/pk.h>
+#include <mbedtls/sha256.h>
+#include "frame_crypto.h"
+
+// ==================== OTA IMAGE TRANSFER ====================
+//
+// A firmware image travels as FRAME_OTA_CHUNKs of OTA_CHUNK_SIZE bytes,
+// numbered from 0, in any order and any number of times. OtaImage writes
+// each chunk straight to its place in an app partition and keeps one bit
+// per chunk. The image is never held in RAM. 32 chunks fill one 4 KB flash
+// sector, so the bitmap is one word per sector:
+//
+//   - A sector is erased just before its first chunk is written. An empty
+//     word means the sector has no data worth keeping, so it is safe to
+//     erase again.
+//   - A chunk that is already marked is ignored. Writing identical data
+//     again would be harmless as well (flash writes only clear bits), which
+//     makes a transfer resumable: restore the words saved before a reboot
+//     and carry on.
+//   - A FRAME_OTA_STATUS reports the incomplete sectors as one bit each, so
+//     the gateway resends only what some node still lacks.
+//
+// The sender receives into its next OTA partition. The gateway keeps the
+// image uploaded over its UART in its own next OTA partition and streams
+// it from there.
+//
+// A release is signed offline: SHA-256 over the image id and size (both
+// uint32, little-endian) followed by the image, signed with the ECDSA
+// P-256 release key. The offer carries the hash and the signature. A sender
+// checks the signature against the public key it was built with before it
+// touches flash or NVS, and compares the hash of the image it received
+// before it boots it. Only the public key is on the devices, so the fleet
+// key cannot be used to forge an image.
+
+#define OTA_CHUNK_SIZE FRAME_OTA_CHUNK_SIZE
+#define OTA_SECTOR_SIZE 4096
+#define OTA_CHUNKS_PER_SECTOR (OTA_SECTOR_SIZE / OTA_CHUNK_SIZE)  // One bitmap word per sector
+#define OTA_MAX_IMAGE_SIZE 0x140000  // app0/app1 in partitions.csv
+#define OTA_MAX_SECTORS (OTA_MAX_IMAGE_SIZE / OTA_SECTOR_SIZE)
+#define OTA_SECTOR_MAP_SIZE ((OTA_MAX_SECTORS + 7) / 8)  // Incomplete-sector bitmap, bytes
+#define OTA_DIGEST_SIZE 32  // SHA-256
+
+static_assert(OTA_CHUNKS_PER_SECTOR == 32, "Sector bitmap words hold 32 chunks");
+static_assert(FRAME_OTA_STATUS_SIZE(OTA_SECTOR_MAP_SIZE) + FRAME_SEAL_OVERHEAD <= FRAME_MAX_SIZE,
+              "Status must fit a sealed frame");
+
+class OtaImage {
+public:
+  /**
+   * @brief Start (or resume) an image of size bytes in part
+   * @param received Bitmap words saved by an earlier transfer of the same image, or nullptr
+   * @return false if the image does not fit the partition
+   */
+  bool begin(const esp_partition_t *part, uint32_t size, const uint32_t *received = nullptr) {
+    part_ = nullptr;
+    if (part == nullptr || size == 0 || size > part->size || size > OTA_MAX_IMAGE_SIZE) return false;
+    part_ = part;
+    size_ = size;
+    chunks_ = (size + OTA_CHUNK_SIZE - 1) / OTA_CHUNK_SIZE;
+    stored_ = 0;
+    memset(received_, 0, sizeof(received_));
+    if (received != nullptr) {
+      for (uint32_t s = 0; s < sectors(); s++) {
+        received_[s] = received[s] & sectorMask(s);
+        stored_ += __builtin_popcount(received_[s]);
+      }
+    }
+    return true;
+  }
+
+  /**
+   * @brief Store one chunk at its place in the partition
+   * @return false if the chunk is out of range, has the wrong length or flash failed
+   */
+  bool write(uint32_t chunk, const uint8_t *data, size_t len) {
+    if (part_ == nullptr || chunk >= chunks_ || len != chunkLength(chunk)) return false;
+    if (has(chunk)) return true;  // Repeat from a later round
+
+    uint32_t sector = chunk / OTA_CHUNKS_PER_SECTOR;
+    if (received_[sector] == 0 &&
+        esp_partition_erase_range(part_, sector * OTA_SECTOR_SIZE, OTA_SECTOR_SIZE) != ESP_OK) {
+      return false;
+    }
+    if (esp_partition_write(part_, chunk * OTA_CHUNK_SIZE, data, len) != ESP_OK) return false;
+    received_[sector] |= 1u << (chunk % OTA_CHUNKS_PER_SECTOR);
+    stored_++;
+    return true;
+  }
+
+  /**
+   * @brief Copy a stored chunk out of the partition (gateway side)
+   * @return Chunk length, or 0 if it is not stored
+   */
+  size_t read(uint32_t chunk, uint8_t *out) const {
+    if (part_ == nullptr || !has(chunk)) return 0;
+    size_t len = chunkLength(chunk);
+    return esp_partition_read(part_, chunk * OTA_CHUNK_SIZE, out, len) == ESP_OK ? len : 0;
+  }
+
+  bool has(uint32_t chunk) const {
+    return chunk < chunks_ &&
+           (received_[chunk / OTA_CHUNKS_PER_SECTOR] >> (chunk % OTA_CHUNKS_PER_SECTOR)) & 1u;
+  }
+
+  size_t chunkLength(uint32_t chunk) const {
+    uint32_t offset = chunk * OTA_CHUNK_SIZE;
+    return size_ - offset < OTA_CHUNK_SIZE ? size_ - offset : OTA_CHUNK_SIZE;
+  }
+
+  bool sectorComplete(uint32_t sector) const { return received_[sector] == sectorMask(sector); }
+
+  /**
+   * @brief Bitmap of the sectors still missing chunks (bit s = sector s)
+   * @return Bytes written, (sectors + 7) / 8
+   */
+  size_t incompleteSectors(uint8_t *map, size_t len) const {
+    size_t n = (sectors() + 7) / 8;
+    if (n > len) n = len;
+    memset(map, 0, n);
+    for (uint32_t s = 0; s < sectors() && s / 8 < n; s++) {
+      if (!sectorComplete(s)) map[s / 8] |= (uint8_t)(1u << (s % 8));
+    }
+    return n;
+  }
+
+  /**
+   * @brief SHA-256 over the image id, the size and the image as stored in flash
+   * @return false if flash or mbedtls failed
+   */
+  bool hash(uint32_t imageId, uint8_t out[OTA_DIGEST_SIZE]) const {
+    if (part_ == nullptr) return false;
+    uint8_t buf[256];
+    framePut32(buf, imageId);
+    framePut32(buf + 4, size_);
+    mbedtls_sha256_context sha;
+    mbedtls_sha256_init(&sha);
+    bool ok = mbedtls_sha256_starts(&sha, 0) == 0 && mbedtls_sha256_update(&sha, buf, 8) == 0;
+
+    for (uint32_t offset = 0; ok && offset < size_; offset += sizeof(buf)) {
+      size_t len = size_ - offset < sizeof(buf) ? size_ - offset : sizeof(buf);
+      ok = esp_partition_read(part_, offset, buf, len) == ESP_OK &&
+           mbedtls_sha256_update(&sha, buf, len) == 0;
+    }
+    ok = ok && mbedtls_sha256_finish(&sha, out) == 0;
+    mbedtls_sha256_free(&sha);
+    return ok;
+  }
+
+  const esp_partition_t *partition() const { return part_; }
+  const uint32_t *receivedWords() const { return received_; }
+  uint32_t size() const { return size_; }
+  uint32_t chunks() const { return chunks_; }
+  uint32_t stored() const { return stored_; }
+  uint32_t sectors() const { return (chunks_ + OTA_CHUNKS_PER_SECTOR - 1) / OTA_CHUNKS_PER_SECTOR; }
+  bool complete() const { return part_ != nullptr && stored_ == chunks_; }
+
+private:
+  uint32_t sectorMask(uint32_t sector) const {
+    uint32_t first = sector * OTA_CHUNKS_PER_SECTOR;
+    uint32_t count = chunks_ - first < OTA_CHUNKS_PER_SECTOR ? chunks_ - first : OTA_CHUNKS_PER_SECTOR;
+    return count == 32 ? 0xFFFFFFFFu : (1u << count) - 1;
+  }
+
+  const esp_partition_t *part_ = nullptr;
+  uint32_t size_ = 0;
+  uint32_t chunks_ = 0;
+  uint32_t stored_ = 0;
+  uint32_t received_[OTA_MAX_SECTORS] = {};
+};
+
+/**
+ * @brief Checks a release signature from a FRAME_OTA_OFFER
+ * @param publicKeyPem The release public key, PEM ("-----BEGIN PUBLIC KEY-----...")
+ * @param hash Image hash from the offer (OtaImage::hash())
+ * @param sig DER ECDSA signature, sigLen bytes
+ * @return true only for a valid signature by an EC key
+ */
+inline bool otaVerifySignature(const char *publicKeyPem, const uint8_t hash[OTA_DIGEST_SIZE],
+                               const uint8_t *sig, size_t sigLen) {
+  mbedtls_pk_context pk;
+  mbedtls_pk_init(&pk);
+  // The PEM parser wants the terminating NUL in the length
+  bool ok = mbedtls_pk_parse_public_key(&pk, (const unsigned char *)publicKeyPem, strlen(publicKeyPem) + 1) == 0 &&
+            mbedtls_pk_can_do(&pk, MBEDTLS_PK_ECKEY) &&
+            mbedtls_pk_verify(&pk, MBEDTLS_MD_SHA256, hash, OTA_DIGEST_SIZE, sig, sigLen) == 0;
+  mbedtls_pk_free(&pk);
+  return ok;
+}
+
+#endif  // OTA_IMAGE_H
@@ -0,0 +1,148 @@
+#ifndef PEER_TABLE_H
+#define PEER_TABLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// ==================== PEER TABLE ====================
+//
+// Receivers the sender may unicast to, rated by recent delivery results and
+// by the RSSI of anything heard from them. Each entry keeps an exponentially
+// weighted ack rate in permille; its score is
+//
+//   ack rate (0..1000) + PEER_RSSI_WEIGHT * (rssi + 100)   (RSSI once heard)
+//
+// select() sticks with the active peer until another one beats it by
+// PEER_SWITCH_MARGIN (no flapping between two similar gateways), and every
+// probe interval sends one frame via the next standby peer in turn so a
+// gateway that recovered, or one that was never tried, gets re-rated. Probes
+// carry real frames: a failed one is simply retransmitted by the send window.
+//
+// Not thread-safe: owned by the context that drives the radio.
+
+#define PEER_RATE_MAX 1000
+#define PEER_EWMA_SHIFT 3       // Weight of each new delivery result: 1/8
+#define PEER_RSSI_WEIGHT 2      // Score per dB of RSSI
+#define PEER_SWITCH_MARGIN 150
+
+template <size_t N>
+class PeerTable {
+public:
+  /**
+   * @brief Add a receiver (no-op if already present)
+   * @return Its index, or -1 if the table is full
+   */
+  int add(const uint8_t mac[6]) {
+    int idx = find(mac);
+    if (idx >= 0 || count_ >= N) return idx;
+    entry &e = peers_[count_];
+    memcpy(e.mac, mac, 6);
+    e.rate = PEER_RATE_MAX;  // Optimistic until proven otherwise
+    e.rssi = 0;
+    e.hasRssi = false;
+    e.sent = 0;
+    e.acked = 0;
+    return (int)count_++;
+  }
+
+  /**
+   * @return Index of the peer with this MAC, or -1
+   */
+  int find(const uint8_t mac[6]) const {
+    for (size_t i = 0; i < count_; i++) {
+      if (memcmp(peers_[i].mac, mac, 6) == 0) return (int)i;
+    }
+    return -1;
+  }
+
+  /**
+   * @brief Fold one delivery report into the peer's ack rate
+   */
+  void onDelivery(size_t i, bool success) {
+    entry &e = peers_[i];
+    int32_t target = success ? PEER_RATE_MAX : 0;
+    e.rate = (int16_t)(e.rate + ((target - e.rate) >> PEER_EWMA_SHIFT));
+    e.sent++;
+    if (success) e.acked++;
+  }
+
+  /**
+   * @brief Record the signal strength of a frame received from the peer
+   */
+  void onRssi(size_t i, int8_t rssi) {
+    entry &e = peers_[i];
+    // Light smoothing; the first reading is taken as is
+    e.rssi = e.hasRssi ? (int8_t)((e.rssi * 3 + rssi) / 4) : rssi;
+    e.hasRssi = true;
+  }
+
+  int32_t score(size_t i) const {
+    const entry &e = peers_[i];
+    return e.rate + (e.hasRssi ? PEER_RSSI_WEIGHT * (e.rssi + 100) : 0);
+  }
+
+  /**
+   * @brief Pick the receiver for the next frame
+   * @return Peer index (0 while the table is empty)
+   */
+  size_t select(uint32_t nowMs, uint32_t probeIntervalMs) {
+    if (count_ < 2) return 0;
+
+    // Fail over once another peer is clearly better
+    size_t best = bestExcept(active_);
+    if (score(best) >= score(active_) + PEER_SWITCH_MARGIN) {
+      active_ = best;
+      switches_++;
+    }
+
+    if (nowMs - lastProbeMs_ >= probeIntervalMs) {
+      lastProbeMs_ = nowMs;
+      probe_ = (probe_ + 1) % count_;
+      if (probe_ == active_) probe_ = (probe_ + 1) % count_;
+      return probe_;
+    }
+    return active_;
+  }
+
+  void setActive(size_t i) {
+    if (i < count_) active_ = i;
+  }
+
+  size_t active() const { return active_; }
+  size_t size() const { return count_; }
+  const uint8_t *mac(size_t i) const { return peers_[i].mac; }
+  int16_t rate(size_t i) const { return peers_[i].rate; }
+  int8_t rssi(size_t i) const { return peers_[i].hasRssi ? peers_[i].rssi : 0; }  // 0: not heard
+  uint32_t sent(size_t i) const { return peers_[i].sent; }
+  uint32_t acked(size_t i) const { return peers_[i].acked; }
+  uint32_t switches() const { return switches_; }
+
+private:
+  struct entry {
+    uint8_t mac[6];
+    int16_t rate;  // Ack rate EWMA, permille
+    int8_t rssi;
+    bool hasRssi;
+    uint32_t sent;
+    uint32_t acked;
+  };
+
+  // Highest-scoring peer other than skip (lowest index wins ties)
+  size_t bestExcept(size_t skip) const {
+    size_t best = skip == 0 ? 1 : 0;
+    for (size_t i = best + 1; i < count_; i++) {
+      if (i != skip && score(i) > score(best)) best = i;
+    }
+    return best;
+  }
+
+  entry peers_[N];
+  size_t count_ = 0;
+  size_t active_ = 0;
+  size_t probe_ = 0;
+  uint32_t lastProbeMs_ = 0;
+  uint32_t switches_ = 0;
+};
+
+#endif  // PEER_TABLE_H
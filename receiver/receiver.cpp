@@ -0,0 +1,1208 @@
+#include <esp_now.h>
+#include <WiFi.h>
+#include <esp_wifi.h>
+#include <esp_mac.h>
+#include <esp_ota_ops.h>
+#include <Preferences.h>
+#include <atomic>
+#include "../sensor_frame.h"
+#include "../frame_crypto.h"
+#include "../ota_image.h"
+#include "../ring_buffer.h"
+#include "../seqlock.h"
+#include "../logging.h"
+
+// ==================== CONFIGURATION ====================
+
+// Must match the senders' WIFI_CHANNEL (or let them find it by scanning)
+#define WIFI_CHANNEL 1
+
+// Decoded samples go out as CSV lines on the UART, one line per sample, with
+// one reading column per SampleLayout channel (sensor_frame.h):
+//   mac,seq,timestamp,temperature,humidity,mq_value,heartRate,spo2,rssi
+// Lines are collected in FORWARD_BUFFER_SIZE bytes and written in one go when
+// the buffer fills or FORWARD_FLUSH_MS passes, instead of a printf per packet.
+// A FRAME_SUMMARY becomes one line with count,mean,min,max,stddev for each of
+// temperature, humidity, mq_value, heartRate and spo2:
+//   summary,mac,seq,start,windowMs,<5 x count,mean,min,max,stddev>,rssi
+// Frames with a health trailer add one line for the sender's link:
+//   health,mac,acked,failed,retransmits,dropped,ackRate,queued,nodeRssi,
+//   freeHeap,loopMaxUs,wakeMs,rssi
+// A FRAME_ALARM flushes the buffer right away and becomes:
+//   alarm,mac,alarmSeq,mask,timestamp,temperature,humidity,mq_value,heartRate,spo2,rssi
+// where mask bit 0..4 flags temperature .. spo2. Replies to remote control
+// (REMOTE_CONTROL below) become:
+//   config,mac,version,result      result 0 applied, 1 already applied, 2 rejected
+//   ota,mac,imageId,state,stored,rssi   state 0 idle, 1 receiving, 2 done, 3 failed
+//   upload,<chunk|begin|start|stop>,ok|error   answers to the ota commands
+// Log lines never start with a MAC, "summary,", "health,", "alarm,",
+// "config,", "ota," or "upload,", so a host bridge (e.g. one publishing to
+// MQTT) can tell them apart.
+#define FORWARD_BAUD 921600
+#define FORWARD_BUFFER_SIZE 4096
+#define FORWARD_FLUSH_MS 50
+
+// Frames received but not yet decoded (each slot holds a full ESP-NOW payload)
+#define RX_RING_SIZE 64
+
+// Senders tracked for sequence gap accounting and slot assignment
+#define MAX_NODES 256
+
+// TDMA slot assignment: every new sender gets the next of SLOT_COUNT slots
+// (FRAME_SLOT) and a refresh every SLOT_REFRESH_MS to correct clock drift.
+// REPORT_INTERVAL_MS must match the senders' SEND_INTERVAL and TDMA_SLOTS
+// (until "config * interval=" sets both).
+#define ASSIGN_SLOTS 1
+#define SLOT_COUNT 16
+#define REPORT_INTERVAL_MS 12000
+#define SLOT_REFRESH_MS 600000
+
+// Encryption, matching the senders' ENCRYPTION_MODE and keys: 0 off,
+// 1 ESP-NOW CCMP (each sender that sends FRAME_DISCOVER is registered as an
+// encrypted peer, up to ESP_NOW_MAX_ENCRYPT_PEER_NUM), 2 sealed frames only
+// (cleartext data frames are dropped). Sealed frames are accepted in any mode.
+// FLEET_SIZE is the number of senders this gateway serves; mode 1 refuses to
+// build for more than ESP-NOW can register.
+#define ENCRYPTION_MODE 2
+#define FLEET_SIZE 32
+#define FLEET_PMK "pmk-change-me-16"
+#define FLEET_KEY "key-change-me-16"
+// Public half of the release key that signs images, the same as the senders'.
+// The gateway checks the signature given to "ota start" before offering.
+#define OTA_PUBLIC_KEY \
+  "-----BEGIN PUBLIC KEY-----\n" \
+  "MFkwEwYHKoZIzj0CAQYIKoZIzj0DAQcDQgAEbYk+u4w16Ne6tN95HVpQihWidtDN\n" \
+  "ofhs93BYMaQV6Ngxz5NATbye+qeGb2wWfdPuvgzSHnHgyszGkKJCbWguFw==\n" \
+  "-----END PUBLIC KEY-----\n"
+// Sealed counters accepted from a sender are saved in NVS every
+// SEAL_FLOOR_STEP counters, so a gateway reboot only reopens replay of that
+// sender's last SEAL_FLOOR_STEP frames instead of all of them
+#define SEAL_FLOOR_STEP 1024
+
+// Print gateway statistics every 60 seconds
+#define STATS_INTERVAL_MS 60000
+
+// Remote control of senders built with REMOTE_CONTROL, by commands on the UART:
+//   config <mac|*> [interval=<ms>] [channel=<n>] [gateway=<mac>]
+//   ota begin <size> <imageId>   start uploading an image into the spare app partition
+//   ota chunk <index> <hex>      one OTA_CHUNK_SIZE piece of it (shorter for the last)
+//   ota start <signature hex>    offer the uploaded image to the senders, with its
+//                                release signature (README)
+//   ota stop                     stop offering it
+// A config is signed for its sender and repeated when it reports, at most
+// every CONFIG_RETRY_MS, until acknowledged. "*" means every sender heard so
+// far. An update is offered to senders as they report, and again every
+// OTA_FAILED_RETRY_MS to one that failed it. Its chunks are broadcast in
+// rounds of the sectors some sender still lacks, one every
+// OTA_CHUNK_INTERVAL_MS; pace the upload by the "upload," answers.
+#define REMOTE_CONTROL 1
+#define COMMAND_LINE_MAX 320
+#define CONFIG_RETRY_MS 1000
+#define OTA_OFFER_RETRY_MS 1000
+#define OTA_FAILED_RETRY_MS 60000
+#define OTA_CHUNK_INTERVAL_MS 8
+#define CONTROL_POLL_MS 10
+#define CONFIG_RING_SIZE 8
+#define OTA_REQUEST_RING_SIZE 16
+
+// The decode task runs on the core the Wi-Fi stack does not use
+#define DECODE_TASK_CORE 1
+#define DECODE_TASK_PRIORITY 3
+#define DECODE_TASK_STACK 6144
+#define CONTROL_TASK_CORE 1
+#define CONTROL_TASK_PRIORITY 2
+#define CONTROL_TASK_STACK 6144
+
+#if ENCRYPTION_MODE == 1 && FLEET_SIZE > ESP_NOW_MAX_ENCRYPT_PEER_NUM
+#error "FLEET_SIZE exceeds ESP-NOW's encrypted peer limit: use ENCRYPTION_MODE 2"
+#endif
+
+// ==================== GLOBAL VARIABLES ====================
+
+// One received frame, copied in by the receive callback without parsing
+typedef struct rx_frame {
+  uint8_t mac[6];
+  int8_t rssi;
+  uint8_t len;
+  uint8_t data[FRAME_MAX_SIZE];
+} rx_frame;
+
+RingBuffer<rx_frame, RX_RING_SIZE> rxRing;
+std::atomic<uint32_t> rxRingOverflows{0};
+TaskHandle_t decodeTaskHandle = nullptr;
+
+typedef struct node_entry {
+  uint8_t mac[6];
+  bool used;
+  uint8_t slot;
+  uint16_t lastSeq;
+  uint32_t frames;
+  uint32_t samples;
+  uint32_t lost;            // Frames missing from the sequence
+  uint32_t sealCounter;     // Highest nonce counter accepted (FRAME_SEALED)
+  uint32_t sealSeen;        // Replay bitmap below it, 0 before the first sealed frame
+  uint32_t sealSaved;       // sealCounter as last saved to NVS
+  bool sealLoaded;          // sealSaved restored since boot
+  uint16_t lastAlarmSeq;
+  uint32_t alarms;
+  unsigned long slotSentMs;
+  bool slotSent;
+  uint8_t config[FRAME_CONFIG_ITEMS_MAX];  // Items not acknowledged yet
+  uint8_t configLen;
+  uint32_t configVersion;
+  unsigned long configSentMs;
+  bool configSent;
+  uint32_t otaImage;        // From the last FRAME_OTA_STATUS
+  uint8_t otaState;
+  uint16_t otaStored;
+  unsigned long otaOfferMs;
+  bool otaOffered;
+} node_entry;
+
+node_entry nodes[MAX_NODES];  // Open addressing on a hash of the MAC
+size_t nodeCount = 0;
+uint8_t nextSlot = 0;
+
+uint8_t gatewayMac[6];
+uint8_t beaconKey[FRAME_KEY_SIZE];  // Tags beacons ("bcn", derived with gatewayMac)
+const uint8_t broadcastAddress[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+uint16_t controlSeq = 0;
+unsigned long epochMs = 0;  // Start of the gateway's reporting intervals
+unsigned long reportIntervalMs = REPORT_INTERVAL_MS;
+
+#if REMOTE_CONTROL
+// A config command, passed from the control task to the decode task (which owns the node table)
+typedef struct config_request {
+  uint8_t mac[6];
+  bool all;
+  uint32_t version;
+  uint8_t len;
+  uint8_t items[FRAME_CONFIG_ITEMS_MAX];
+} config_request;
+
+RingBuffer<config_request, CONFIG_RING_SIZE> configRing;
+
+// Sectors a sender still lacks, passed from the decode task to the control task
+typedef struct ota_request {
+  uint8_t len;
+  uint8_t sectors[OTA_SECTOR_MAP_SIZE];
+} ota_request;
+
+RingBuffer<ota_request, OTA_REQUEST_RING_SIZE> otaRequestRing;
+
+// The image on offer, published by the control task
+typedef struct ota_campaign {
+  bool active;
+  uint32_t imageId;
+  uint32_t size;
+  uint8_t hash[OTA_DIGEST_SIZE];
+  uint8_t sig[FRAME_OTA_SIG_MAX];
+  uint8_t sigLen;
+} ota_campaign;
+
+Seqlock<ota_campaign> campaign;
+TaskHandle_t controlTaskHandle = nullptr;
+uint8_t chunkKey[FRAME_KEY_SIZE];
+
+// Control task state
+Preferences gatewayPrefs;
+uint32_t configVersion = 0;  // Last version handed out, kept in NVS so it keeps increasing
+OtaImage otaUpload;
+uint32_t otaUploadId = 0;
+uint8_t otaSending[OTA_SECTOR_MAP_SIZE];    // Sectors of this round
+uint8_t otaRequested[OTA_SECTOR_MAP_SIZE];  // Sectors for the next round
+uint32_t otaCursor = 0;                     // Next chunk of this round
+uint16_t otaSeq = 0;
+#endif
+
+char forwardBuffer[FORWARD_BUFFER_SIZE];
+size_t forwardLen = 0;
+unsigned long lastFlushMs = 0;
+
+// Decode task statistics
+uint32_t framesDecoded = 0;
+uint32_t framesMalformed = 0;
+uint32_t samplesForwarded = 0;
+uint32_t healthForwarded = 0;
+uint32_t summariesForwarded = 0;
+uint32_t alarmsForwarded = 0;
+uint32_t bytesForwarded = 0;
+uint32_t nodesDropped = 0;
+uint32_t framesRejected = 0;  // Failed authentication, replayed, or cleartext in mode 2
+
+Preferences sealPrefs;  // Decode task only
+
+// ==================== ESP-NOW FUNCTIONS ====================
+
+/**
+ * @brief Callback function when data is received via ESP-NOW
+ *
+ * Runs in the Wi-Fi task: copies the frame into the next ring slot and wakes
+ * the decode task. No parsing, no logging, no allocation.
+ */
+void OnDataRecv(const esp_now_recv_info_t *info, const uint8_t *data, int len) {
+  if (len <= 0 || len > FRAME_MAX_SIZE) return;
+
+  rx_frame *frame = rxRing.claim();
+  if (frame == nullptr) {
+    rxRingOverflows.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  memcpy(frame->mac, info->src_addr, 6);
+  frame->rssi = (int8_t)info->rx_ctrl->rssi;
+  frame->len = (uint8_t)len;
+  memcpy(frame->data, data, len);
+  rxRing.commit();
+
+  xTaskNotifyGive(decodeTaskHandle);
+}
+
+/**
+ * @brief Unicast a control frame to a sender that is not a registered peer
+ *
+ * The ESP-NOW peer list is far smaller than the node count, so the sender is
+ * added just for this one frame.
+ */
+bool sendToNode(const uint8_t mac[6], const uint8_t *frame, size_t len) {
+  esp_now_peer_info_t peerInfo;
+  memset(&peerInfo, 0, sizeof(peerInfo));
+  memcpy(peerInfo.peer_addr, mac, 6);
+  peerInfo.channel = WIFI_CHANNEL;
+  peerInfo.ifidx = WIFI_IF_STA;
+
+  bool added = esp_now_add_peer(&peerInfo) == ESP_OK;
+  esp_err_t result = esp_now_send(mac, frame, len);
+  if (added) esp_now_del_peer(mac);
+  return result == ESP_OK;
+}
+
+/**
+ * @brief Initialize WiFi and ESP-NOW
+ * @return true if initialization successful
+ */
+bool initESPNow() {
+  WiFi.mode(WIFI_STA);
+  WiFi.disconnect();
+  esp_wifi_set_channel(WIFI_CHANNEL, WIFI_SECOND_CHAN_NONE);
+
+  if (esp_now_init() != ESP_OK) {
+    LOG_ERROR("❌ ESP-NOW Initialization Failed!\n");
+    return false;
+  }
+  esp_now_register_recv_cb(OnDataRecv);
+
+#if ENCRYPTION_MODE == 1
+  if (esp_now_set_pmk((const uint8_t *)FLEET_PMK) != ESP_OK) {
+    LOG_ERROR("❌ Failed to set the ESP-NOW PMK\n");
+    return false;
+  }
+#endif
+
+  // Beacons answering FRAME_DISCOVER are broadcast
+  esp_now_peer_info_t peerInfo;
+  memset(&peerInfo, 0, sizeof(peerInfo));
+  memcpy(peerInfo.peer_addr, broadcastAddress, 6);
+  peerInfo.channel = WIFI_CHANNEL;
+  peerInfo.ifidx = WIFI_IF_STA;
+  if (esp_now_add_peer(&peerInfo) != ESP_OK) {
+    LOG_ERROR("❌ Failed to add broadcast peer\n");
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Register a sender as an encrypted peer, with the LMK it derives for itself
+ *
+ * Called when a sender looks for a gateway, before its first encrypted frame.
+ */
+void addEncryptedPeer(const uint8_t mac[6]) {
+#if ENCRYPTION_MODE == 1
+  if (esp_now_is_peer_exist(mac)) return;
+
+  esp_now_peer_info_t peerInfo;
+  memset(&peerInfo, 0, sizeof(peerInfo));
+  memcpy(peerInfo.peer_addr, mac, 6);
+  peerInfo.channel = WIFI_CHANNEL;
+  peerInfo.ifidx = WIFI_IF_STA;
+  peerInfo.encrypt = true;
+  if (!frameDeriveKey((const uint8_t *)FLEET_KEY, "lmk", mac, peerInfo.lmk)) return;
+
+  esp_err_t result = esp_now_add_peer(&peerInfo);
+  if (result == ESP_ERR_ESPNOW_FULL) {
+    LOG_WARN("⚠️  Encrypted peer list full: %02X:%02X:%02X:%02X:%02X:%02X stays unreadable, "
+             "use ENCRYPTION_MODE 2 for this many senders\n",
+             mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+  } else if (result != ESP_OK) {
+    LOG_WARN("⚠️  Failed to add encrypted peer (0x%X)\n", result);
+  }
+#endif
+}
+
+// ==================== NODE TABLE ====================
+
+/**
+ * @brief Entry for this sender, created on first sight unless create is false
+ * @return nullptr if the table is full, or the sender is unknown and create is false
+ */
+node_entry *findNode(const uint8_t mac[6], bool create = true) {
+  uint32_t hash = 2166136261u;
+  for (int i = 0; i < 6; i++) {
+    hash = (hash ^ mac[i]) * 16777619u;
+  }
+
+  for (size_t probe = 0; probe < MAX_NODES; probe++) {
+    node_entry &node = nodes[(hash + probe) % MAX_NODES];
+    if (node.used && memcmp(node.mac, mac, 6) == 0) return &node;
+    if (!node.used) {
+      if (!create) return nullptr;
+      memset(&node, 0, sizeof(node));
+      memcpy(node.mac, mac, 6);
+      node.used = true;
+      node.slot = nextSlot;
+      nextSlot = (nextSlot + 1) % SLOT_COUNT;
+      nodeCount++;
+      return &node;
+    }
+  }
+  return nullptr;
+}
+
+/**
+ * @brief Count frames missing between the last sequence number and this one
+ */
+void trackSequence(node_entry &node, uint16_t seq) {
+  if (node.frames > 0) {
+    uint16_t gap = (uint16_t)(seq - node.lastSeq);
+    // Retransmissions repeat a sequence number; a huge jump is a reboot
+    if (gap > 1 && gap < 0x8000) node.lost += gap - 1;
+  }
+  node.lastSeq = seq;
+  node.frames++;
+}
+
+/**
+ * @brief Tell a sender its TDMA slot when first seen and then periodically
+ */
+void serviceSlot(node_entry &node) {
+#if ASSIGN_SLOTS
+  unsigned long now = millis();
+  if (node.slotSent && now - node.slotSentMs < SLOT_REFRESH_MS) return;
+
+  uint8_t frame[FRAME_SLOT_SIZE];
+  uint16_t phase = (uint16_t)((now - epochMs) % reportIntervalMs);
+  size_t len = encodeSlotFrame(frame, sizeof(frame), gatewayMac, controlSeq++,
+                               node.slot, SLOT_COUNT, phase);
+  if (sendToNode(node.mac, frame, len)) {
+    node.slotSent = true;
+    node.slotSentMs = now;
+  }
+#endif
+}
+
+/**
+ * @brief NVS key for a sender: its MAC in hex
+ */
+void nodeKey(const uint8_t mac[6], char key[13]) {
+  snprintf(key, 13, "%02x%02x%02x%02x%02x%02x", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+}
+
+/**
+ * @brief Restore the replay floor saved for a sender, on its first sealed frame since boot
+ *
+ * Only counters above the saved one are accepted afterwards.
+ */
+void loadSealFloor(node_entry &node) {
+  char key[13];
+  nodeKey(node.mac, key);
+  sealPrefs.begin("seal", true);
+  uint32_t floor = sealPrefs.getUInt(key, 0);
+  sealPrefs.end();
+
+  if (floor != 0) {
+    node.sealCounter = floor;
+    node.sealSeen = 0xFFFFFFFFu;  // The whole window below it counts as seen
+  }
+  node.sealSaved = floor;
+  node.sealLoaded = true;
+}
+
+/**
+ * @brief Save a sender's highest accepted counter once it moved SEAL_FLOOR_STEP on
+ */
+void saveSealFloor(node_entry &node) {
+  if (node.sealCounter - node.sealSaved < SEAL_FLOOR_STEP) return;
+  char key[13];
+  nodeKey(node.mac, key);
+  sealPrefs.begin("seal", false);
+  sealPrefs.putUInt(key, node.sealCounter);
+  sealPrefs.end();
+  node.sealSaved = node.sealCounter;
+}
+
+// ==================== FORWARDING ====================
+
+void flushForward() {
+  if (forwardLen == 0) return;
+  Serial.write((const uint8_t *)forwardBuffer, forwardLen);
+  bytesForwarded += forwardLen;
+  forwardLen = 0;
+  lastFlushMs = millis();
+}
+
+/**
+ * @brief Append one CSV line of snprintf() output, flushing first if it would not fit
+ */
+void forwardLine(const char *line, int n, size_t size) {
+  if (n <= 0) return;
+  if ((size_t)n >= size) n = size - 1;
+
+  if (forwardLen + n > sizeof(forwardBuffer)) flushForward();
+  memcpy(forwardBuffer + forwardLen, line, n);
+  forwardLen += n;
+}
+
+/**
+ * @brief Append ",<reading>" for every SampleLayout channel and ",<rssi>\n" to a line
+ * @param n Characters already in line (snprintf() result)
+ * @return New snprintf()-style length
+ */
+int appendReadings(char *line, size_t size, int n, const sensor_data &s, int8_t rssi) {
+  float value[FRAME_FIELD_COUNT];
+  SampleLayout::values(s, value);
+  for (int i = 0; i < FRAME_FIELD_COUNT && n > 0 && (size_t)n < size; i++) {
+    n += snprintf(line + n, size - n, ",%.*f", SampleLayout::precision(i), value[i]);
+  }
+  if (n > 0 && (size_t)n < size) {
+    n += snprintf(line + n, size - n, ",%d\n", rssi);
+  }
+  return n;
+}
+
+/**
+ * @brief Forward one sample as a CSV line
+ */
+void forwardSample(const frame_header &hdr, const sensor_data &s, int8_t rssi) {
+  char line[128];
+  int n = snprintf(line, sizeof(line), "%02X:%02X:%02X:%02X:%02X:%02X,%u,%lu",
+                   hdr.mac[0], hdr.mac[1], hdr.mac[2], hdr.mac[3], hdr.mac[4], hdr.mac[5],
+                   hdr.seq, s.timestamp);
+  n = appendReadings(line, sizeof(line), n, s, rssi);
+  forwardLine(line, n, sizeof(line));
+  samplesForwarded++;
+}
+
+/**
+ * @brief Forward an anomaly alarm as an "alarm," CSV line
+ */
+void forwardAlarm(const frame_header &hdr, uint8_t mask, const sensor_data &s, int8_t rssi) {
+  char line[160];
+  int n = snprintf(line, sizeof(line), "alarm,%02X:%02X:%02X:%02X:%02X:%02X,%u,%u,%lu",
+                   hdr.mac[0], hdr.mac[1], hdr.mac[2], hdr.mac[3], hdr.mac[4], hdr.mac[5],
+                   hdr.seq, mask, s.timestamp);
+  n = appendReadings(line, sizeof(line), n, s, rssi);
+  forwardLine(line, n, sizeof(line));
+  alarmsForwarded++;
+}
+
+/**
+ * @brief Forward window statistics as a "summary," CSV line
+ */
+void forwardSummary(const frame_header &hdr, const sensor_summary &s, int8_t rssi) {
+  char line[384];
+  int n = snprintf(line, sizeof(line), "summary,%02X:%02X:%02X:%02X:%02X:%02X,%u,%lu,%lu",
+                   hdr.mac[0], hdr.mac[1], hdr.mac[2], hdr.mac[3], hdr.mac[4], hdr.mac[5],
+                   hdr.seq, (unsigned long)s.startMs, (unsigned long)s.windowMs);
+  for (int i = 0; i < FRAME_FIELD_COUNT && n > 0 && (size_t)n < sizeof(line); i++) {
+    const channel_summary &c = s.channel[i];
+    n += snprintf(line + n, sizeof(line) - n, ",%u,%.2f,%.2f,%.2f,%.2f",
+                  c.count, c.mean, c.min, c.max, c.stddev);
+  }
+  if (n > 0 && (size_t)n < sizeof(line)) {
+    n += snprintf(line + n, sizeof(line) - n, ",%d\n", rssi);
+  }
+  forwardLine(line, n, sizeof(line));
+  summariesForwarded++;
+}
+
+/**
+ * @brief Forward a sender's health trailer as a "health," CSV line
+ */
+void forwardHealth(const frame_header &hdr, const health_record &h, int8_t rssi) {
+  char line[160];
+  int n = snprintf(line, sizeof(line),
+                   "health,%02X:%02X:%02X:%02X:%02X:%02X,%lu,%lu,%lu,%lu,%u,%u,%d,%lu,%lu,%lu,%d\n",
+                   hdr.mac[0], hdr.mac[1], hdr.mac[2], hdr.mac[3], hdr.mac[4], hdr.mac[5],
+                   (unsigned long)h.acked, (unsigned long)h.failed, (unsigned long)h.retransmits,
+                   (unsigned long)h.dropped, h.ackRate, h.queueDepth, h.rssi,
+                   (unsigned long)h.freeHeap, (unsigned long)h.loopMaxUs, (unsigned long)h.wakeMs, rssi);
+  forwardLine(line, n, sizeof(line));
+  healthForwarded++;
+}
+
+// ==================== REMOTE CONTROL ====================
+
+#if REMOTE_CONTROL
+bool configHasKey(const uint8_t *items, size_t len, uint8_t key) {
+  const uint8_t *p = items;
+  uint8_t itemKey, itemLen;
+  const uint8_t *value;
+  while (frameNextConfigItem(p, items + len, itemKey, value, itemLen)) {
+    if (itemKey == key) return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Add config items to a sender's pending ones, replacing older values of the same keys
+ */
+void mergeConfig(node_entry &node, const uint8_t *items, size_t len, uint32_t version) {
+  uint8_t merged[FRAME_CONFIG_ITEMS_MAX];
+  size_t n = 0;
+  const uint8_t *p = node.config;
+  uint8_t key, itemLen;
+  const uint8_t *value;
+  while (frameNextConfigItem(p, node.config + node.configLen, key, value, itemLen)) {
+    if (!configHasKey(items, len, key)) n += framePutConfigItem(merged + n, sizeof(merged) - n, key, value, itemLen);
+  }
+  if (n + len > sizeof(merged)) n = 0;  // Can't happen with one item per key
+  memcpy(merged + n, items, len);
+
+  memcpy(node.config, merged, n + len);
+  node.configLen = (uint8_t)(n + len);
+  node.configVersion = version;
+  node.configSent = false;
+}
+
+/**
+ * @brief Hand the config commands from the control task to their senders' entries
+ */
+void serviceConfigRequests() {
+  while (!configRing.empty()) {
+    const config_request &req = configRing.peek();
+    if (req.all) {
+      for (size_t i = 0; i < MAX_NODES; i++) {
+        if (nodes[i].used) mergeConfig(nodes[i], req.items, req.len, req.version);
+      }
+
+      // The slot schedule follows the fleet's new interval
+      const uint8_t *p = req.items;
+      uint8_t key, len;
+      const uint8_t *value;
+      while (frameNextConfigItem(p, req.items + req.len, key, value, len)) {
+        if (key == CONFIG_REPORT_INTERVAL && len == 4) reportIntervalMs = frameGet32(value);
+      }
+    } else {
+      node_entry *node = findNode(req.mac);
+      if (node != nullptr) {
+        mergeConfig(*node, req.items, req.len, req.version);
+      } else {
+        LOG_WARN("⚠️  Node table full, config %lu dropped\n", (unsigned long)req.version);
+      }
+    }
+    configRing.drop(1);
+  }
+}
+#endif
+
+/**
+ * @brief Send a sender its pending config, signed with its control key
+ *
+ * Called when the sender reports, so a sender in deep sleep hears it while
+ * it listens after the report.
+ */
+void serviceConfig(node_entry &node) {
+#if REMOTE_CONTROL
+  unsigned long now = millis();
+  if (node.configLen == 0 || (node.configSent && now - node.configSentMs < CONFIG_RETRY_MS)) return;
+
+  uint8_t key[FRAME_KEY_SIZE];
+  if (!frameDeriveKey((const uint8_t *)FLEET_KEY, "ctrl", node.mac, key)) return;
+  uint8_t frame[FRAME_HEADER_SIZE + 4 + FRAME_CONFIG_ITEMS_MAX + FRAME_CONTROL_TAG_SIZE];
+  size_t len = encodeConfigFrame(frame, sizeof(frame), gatewayMac, controlSeq++, node.configVersion,
+                                 node.config, node.configLen);
+  len = signControlFrame(key, frame, len, sizeof(frame));
+  if (len > 0 && sendToNode(node.mac, frame, len)) {
+    node.configSent = true;
+    node.configSentMs = now;
+  }
+#endif
+}
+
+/**
+ * @brief Offer the current update to a sender that has not joined it yet, or failed it a while ago
+ */
+void serviceOtaOffer(node_entry &node) {
+#if REMOTE_CONTROL
+  ota_campaign c = campaign.load();
+  if (!c.active) return;
+
+  unsigned long now = millis();
+  if (node.otaImage == c.imageId && node.otaState != OTA_IDLE &&
+      !(node.otaState == OTA_FAILED && now - node.otaOfferMs >= OTA_FAILED_RETRY_MS)) {
+    return;
+  }
+  if (node.otaOffered && now - node.otaOfferMs < OTA_OFFER_RETRY_MS) return;
+
+  uint8_t key[FRAME_KEY_SIZE];
+  if (!frameDeriveKey((const uint8_t *)FLEET_KEY, "ctrl", node.mac, key)) return;
+  uint8_t frame[FRAME_OTA_OFFER_SIZE(FRAME_OTA_SIG_MAX)];
+  size_t len = encodeOtaOfferFrame(frame, sizeof(frame), gatewayMac, controlSeq++, c.imageId, c.size,
+                                   c.hash, c.sig, c.sigLen);
+  len = signControlFrame(key, frame, len, sizeof(frame));
+  if (len > 0 && sendToNode(node.mac, frame, len)) {
+    node.otaOffered = true;
+    node.otaOfferMs = now;
+  }
+#endif
+}
+
+/**
+ * @brief Check the control tag of a FRAME_CONFIG_ACK or FRAME_OTA_STATUS from mac
+ */
+bool replyAuthentic(const uint8_t mac[6], const uint8_t *data, size_t len) {
+#if REMOTE_CONTROL
+  uint8_t key[FRAME_KEY_SIZE];
+  return frameDeriveKey((const uint8_t *)FLEET_KEY, "ctrl", mac, key) && verifyControlFrame(key, data, len);
+#else
+  (void)mac;
+  (void)data;
+  (void)len;
+  return false;
+#endif
+}
+
+/**
+ * @brief Handle an authenticated FRAME_CONFIG_ACK or FRAME_OTA_STATUS
+ */
+void processReply(node_entry *node, const uint8_t *data, size_t len, int8_t rssi) {
+#if REMOTE_CONTROL
+  frame_header hdr;
+  char line[96];
+  uint32_t version;
+  uint8_t result;
+  if (decodeConfigAckFrame(data, len, hdr, version, result)) {
+    if (node != nullptr && version == node->configVersion) node->configLen = 0;  // Done, whatever the result
+    int n = snprintf(line, sizeof(line), "config,%02X:%02X:%02X:%02X:%02X:%02X,%lu,%u\n",
+                     hdr.mac[0], hdr.mac[1], hdr.mac[2], hdr.mac[3], hdr.mac[4], hdr.mac[5],
+                     (unsigned long)version, result);
+    forwardLine(line, n, sizeof(line));
+    return;
+  }
+
+  uint32_t imageId;
+  uint8_t state;
+  uint16_t stored;
+  const uint8_t *sectors;
+  size_t mapLen;
+  if (!decodeOtaStatusFrame(data, len, hdr, imageId, state, stored, sectors, mapLen)) {
+    framesMalformed++;
+    return;
+  }
+  if (node != nullptr) {
+    node->otaImage = imageId;
+    node->otaState = state;
+    node->otaStored = stored;
+  }
+  int n = snprintf(line, sizeof(line), "ota,%02X:%02X:%02X:%02X:%02X:%02X,%lu,%u,%u,%d\n",
+                   hdr.mac[0], hdr.mac[1], hdr.mac[2], hdr.mac[3], hdr.mac[4], hdr.mac[5],
+                   (unsigned long)imageId, state, stored, rssi);
+  forwardLine(line, n, sizeof(line));
+
+  // The control task resends what is missing
+  ota_campaign c = campaign.load();
+  if (c.active && imageId == c.imageId && state == OTA_RECEIVING && mapLen > 0) {
+    ota_request *req = otaRequestRing.claim();
+    if (req != nullptr) {
+      req->len = (uint8_t)(mapLen < sizeof(req->sectors) ? mapLen : sizeof(req->sectors));
+      memcpy(req->sectors, sectors, req->len);
+      otaRequestRing.commit();
+    }
+  }
+#else
+  (void)node;
+  (void)data;
+  (void)len;
+  (void)rssi;
+#endif
+}
+
+// ==================== DECODING ====================
+
+/**
+ * @brief Handle one received frame: answer control frames, forward samples
+ */
+void processFrame(const rx_frame &frame) {
+  static sensor_data samples[FRAME_DELTA_MAX_SAMPLES];
+  static uint8_t opened[FRAME_MAX_SIZE];
+
+  frame_header hdr;
+  if (!decodeFrameHeader(frame.data, frame.len, hdr)) {
+    framesMalformed++;
+    return;
+  }
+
+  if (hdr.type == FRAME_DISCOVER) {
+    addEncryptedPeer(frame.mac);
+    uint8_t beacon[FRAME_BEACON_SIZE];
+    size_t len = encodeBeaconFrame(beacon, sizeof(beacon), gatewayMac, controlSeq++, WIFI_CHANNEL);
+    len = signBeaconFrame(beaconKey, beacon, len, sizeof(beacon), frame.mac, hdr.baseTimestamp);  // Nonce
+    if (len > 0) esp_now_send(broadcastAddress, beacon, len);
+    return;
+  }
+  if (hdr.type == FRAME_BEACON || hdr.type == FRAME_SLOT || hdr.type == FRAME_CONFIG ||
+      hdr.type == FRAME_OTA_OFFER || hdr.type == FRAME_OTA_CHUNK) {
+    return;  // Another gateway
+  }
+
+  const uint8_t *data = frame.data;
+  size_t len = frame.len;
+  uint32_t sealCounter = 0;
+  if (hdr.type == FRAME_SEALED) {
+    uint8_t key[FRAME_KEY_SIZE];
+    len = 0;
+    if (frameDeriveKey((const uint8_t *)FLEET_KEY, "seal", hdr.mac, key)) {
+      len = openFrame(key, frame.data, frame.len, opened, sizeof(opened), sealCounter);
+    }
+    // The key vouches for the outer MAC only: the inner frame and the radio must agree with it
+    frame_header inner;
+    if (len == 0 || !decodeFrameHeader(opened, len, inner) || memcmp(inner.mac, hdr.mac, 6) != 0 ||
+        memcmp(hdr.mac, frame.mac, 6) != 0) {
+      framesRejected++;
+      return;
+    }
+    data = opened;
+  } else if (ENCRYPTION_MODE == 2) {
+    framesRejected++;
+    return;
+  }
+
+  size_t samplesEnd = 0;
+  size_t count = 0;
+  sensor_summary summary;
+  uint8_t alarmMask = 0;
+  frame_header inner;
+  bool isReply = decodeFrameHeader(data, len, inner) &&
+                 (inner.type == FRAME_CONFIG_ACK || inner.type == FRAME_OTA_STATUS);
+  if (isReply) hdr = inner;
+  bool isAlarm = !isReply && decodeAlarmFrame(data, len, hdr, alarmMask, samples[0]);
+  bool isSummary = !isReply && !isAlarm && decodeSummaryFrame(data, len, hdr, summary, &samplesEnd);
+  if (!isReply && !isAlarm && !isSummary) {
+    count = decodeFrameSamples(data, len, hdr, samples, FRAME_DELTA_MAX_SAMPLES, &samplesEnd);
+    if (count == 0) {
+      framesMalformed++;
+      return;
+    }
+  }
+
+  // Replies carry the sender's control tag and must come from that sender's radio
+  if (isReply && (memcmp(hdr.mac, frame.mac, 6) != 0 || !replyAuthentic(hdr.mac, data, len))) {
+    framesRejected++;
+    return;
+  }
+
+  // Readings create the node entry, replies only update an existing one
+  node_entry *node = findNode(hdr.mac, !isReply);
+  if (node != nullptr && data == opened) {
+    if (!node->sealLoaded) loadSealFloor(*node);
+    if (!frameAcceptCounter(sealCounter, node->sealCounter, node->sealSeen)) {
+      framesRejected++;  // Replay, or a retransmitted copy
+      return;
+    }
+    saveSealFloor(*node);
+  }
+  framesDecoded++;
+
+  if (isReply) {
+    if (node == nullptr) nodesDropped++;
+    processReply(node, data, len, frame.rssi);
+    return;
+  }
+
+  if (isAlarm) {
+    if (node == nullptr) {
+      nodesDropped++;
+    } else if (node->alarms > 0 && hdr.seq == node->lastAlarmSeq) {
+      return;  // Retransmitted copy
+    } else {
+      node->lastAlarmSeq = hdr.seq;
+      node->alarms++;
+    }
+    forwardAlarm(hdr, alarmMask, samples[0], frame.rssi);
+    flushForward();  // Alarms don't wait for the buffer to fill
+    return;
+  }
+
+  if (node == nullptr) {
+    nodesDropped++;
+  } else {
+    trackSequence(*node, hdr.seq);
+    node->samples += count;
+    serviceSlot(*node);
+    serviceConfig(*node);
+    serviceOtaOffer(*node);
+  }
+
+  if (isSummary) {
+    forwardSummary(hdr, summary, frame.rssi);
+  }
+  for (size_t i = 0; i < count; i++) {
+    forwardSample(hdr, samples[i], frame.rssi);
+  }
+
+  health_record health;
+  if (decodeHealthTrailer(data, len, samplesEnd, health)) {
+    forwardHealth(hdr, health, frame.rssi);
+  }
+}
+
+void printStats() {
+  uint32_t lost = 0;
+  for (size_t i = 0; i < MAX_NODES; i++) {
+    if (nodes[i].used) lost += nodes[i].lost;
+  }
+
+  flushForward();  // Keep the log line out of the middle of a CSV line
+  LOG_INFO("📊 Gateway: %lu frames, %lu samples, %lu summaries, %lu alarms, %lu health reports, %lu bytes out, %u nodes\n",
+           (unsigned long)framesDecoded, (unsigned long)samplesForwarded,
+           (unsigned long)summariesForwarded, (unsigned long)alarmsForwarded,
+           (unsigned long)healthForwarded, (unsigned long)bytesForwarded, (unsigned)nodeCount);
+  LOG_INFO("   Lost in sequence %lu, malformed %lu, rejected %lu, ring overflows %lu, untracked %lu\n",
+           (unsigned long)lost, (unsigned long)framesMalformed, (unsigned long)framesRejected,
+           (unsigned long)rxRingOverflows.load(std::memory_order_relaxed),
+           (unsigned long)nodesDropped);
+}
+
+/**
+ * @brief Decode stage: drains the receive ring and batches the UART output
+ */
+void decodeTask(void *param) {
+  unsigned long lastStats = millis();
+
+  for (;;) {
+    // Woken per frame; the timeout flushes a partly filled buffer
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(FORWARD_FLUSH_MS));
+
+#if REMOTE_CONTROL
+    serviceConfigRequests();
+#endif
+    while (!rxRing.empty()) {
+      processFrame(rxRing.peek());  // Decoded in place, then released
+      rxRing.drop(1);
+    }
+
+    if (millis() - lastFlushMs >= FORWARD_FLUSH_MS) {
+      flushForward();
+    }
+    if (millis() - lastStats >= STATS_INTERVAL_MS) {
+      lastStats = millis();
+      printStats();
+    }
+  }
+}
+
+// ==================== CONTROL TASK ====================
+
+#if REMOTE_CONTROL
+/**
+ * @brief Answer an ota command with an "upload," line
+ */
+void replyUpload(const char *what, bool ok) {
+  char line[48];
+  int n = snprintf(line, sizeof(line), "upload,%s,%s\n", what, ok ? "ok" : "error");
+  if (n > 0 && (size_t)n < sizeof(line)) Serial.write((const uint8_t *)line, n);
+}
+
+bool parseMac(const char *text, uint8_t mac[6]) {
+  unsigned int b[6];
+  char end;
+  if (sscanf(text, "%x:%x:%x:%x:%x:%x%c", &b[0], &b[1], &b[2], &b[3], &b[4], &b[5], &end) != 6) return false;
+  for (int i = 0; i < 6; i++) {
+    if (b[i] > 0xFF) return false;
+    mac[i] = (uint8_t)b[i];
+  }
+  return true;
+}
+
+int hexDigit(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+/**
+ * @brief Parse a string of hex digit pairs
+ * @param len Set to the bytes written
+ * @return false if it is not valid hex or longer than room bytes
+ */
+bool parseHex(const char *hex, uint8_t *out, size_t room, size_t &len) {
+  len = 0;
+  if (hex == nullptr || strlen(hex) % 2 != 0 || strlen(hex) / 2 > room) return false;
+  for (size_t i = 0; hex[2 * i] != '\0'; i++) {
+    int hi = hexDigit(hex[2 * i]);
+    int lo = hexDigit(hex[2 * i + 1]);
+    if (hi < 0 || lo < 0) return false;
+    out[len++] = (uint8_t)(hi << 4 | lo);
+  }
+  return true;
+}
+
+/**
+ * @brief config <mac|*> key=value...: queue it for the decode task
+ */
+void commandConfig(char *args) {
+  char *save;
+  char *target = strtok_r(args, " ", &save);
+  config_request *req = configRing.claim();
+  if (target == nullptr || req == nullptr) {
+    LOG_WARN("⚠️  Usage: config <mac|*> [interval=<ms>] [channel=<n>] [gateway=<mac>]\n");
+    return;
+  }
+  req->all = strcmp(target, "*") == 0;
+  if (!req->all && !parseMac(target, req->mac)) {
+    LOG_WARN("⚠️  Bad MAC %s\n", target);
+    return;
+  }
+
+  size_t n = 0;
+  uint32_t interval = 0;
+  for (char *item = strtok_r(nullptr, " ", &save); item != nullptr; item = strtok_r(nullptr, " ", &save)) {
+    char *value = strchr(item, '=');
+    if (value == nullptr) break;
+    *value++ = '\0';
+
+    uint8_t bytes[6];
+    size_t added = 0;
+    if (strcmp(item, "interval") == 0) {
+      interval = strtoul(value, nullptr, 10);
+      framePut32(bytes, interval);
+      added = framePutConfigItem(req->items + n, sizeof(req->items) - n, CONFIG_REPORT_INTERVAL, bytes, 4);
+    } else if (strcmp(item, "channel") == 0) {
+      bytes[0] = (uint8_t)atoi(value);
+      added = framePutConfigItem(req->items + n, sizeof(req->items) - n, CONFIG_WIFI_CHANNEL, bytes, 1);
+    } else if (strcmp(item, "gateway") == 0 && parseMac(value, bytes)) {
+      added = framePutConfigItem(req->items + n, sizeof(req->items) - n, CONFIG_GATEWAY, bytes, 6);
+    }
+    if (added == 0) {
+      LOG_WARN("⚠️  Bad config item %s=%s\n", item, value);
+      return;
+    }
+    n += added;
+  }
+  if (n == 0) {
+    LOG_WARN("⚠️  Nothing to configure\n");
+    return;
+  }
+  req->len = (uint8_t)n;
+  req->version = ++configVersion;
+
+  gatewayPrefs.begin("gateway", false);
+  gatewayPrefs.putUInt("cfgver", configVersion);
+  if (req->all && interval != 0) gatewayPrefs.putUInt("interval", interval);
+  gatewayPrefs.end();
+
+  configRing.commit();
+  LOG_INFO("⚙️  Config %lu queued for %s\n", (unsigned long)req->version, req->all ? "every sender" : target);
+}
+
+/**
+ * @brief ota begin|chunk|start|stop
+ */
+void commandOta(char *args) {
+  char *save;
+  char *verb = strtok_r(args, " ", &save);
+  if (verb == nullptr) verb = (char *)"";
+
+  if (strcmp(verb, "chunk") == 0) {
+    char *index = strtok_r(nullptr, " ", &save);
+    char *hex = strtok_r(nullptr, " ", &save);
+    uint8_t data[OTA_CHUNK_SIZE];
+    size_t len;
+    bool ok = index != nullptr && parseHex(hex, data, sizeof(data), len) &&
+              otaUpload.write(strtoul(index, nullptr, 10), data, len);
+    replyUpload(index != nullptr ? index : "chunk", ok);
+    return;
+  }
+
+  // Everything else changes the offer: stop the current one first
+  ota_campaign c = campaign.load();
+  c.active = false;
+  campaign.store(c);
+
+  if (strcmp(verb, "begin") == 0) {
+    char *size = strtok_r(nullptr, " ", &save);
+    char *id = strtok_r(nullptr, " ", &save);
+    bool ok = size != nullptr && id != nullptr &&
+              otaUpload.begin(esp_ota_get_next_update_partition(nullptr), strtoul(size, nullptr, 10));
+    otaUploadId = ok ? strtoul(id, nullptr, 10) : 0;
+    replyUpload("begin", ok);
+  } else if (strcmp(verb, "start") == 0) {
+    size_t sigLen;
+    bool ok = otaUpload.complete() && otaUploadId != 0 &&
+              parseHex(strtok_r(nullptr, " ", &save), c.sig, sizeof(c.sig), sigLen) &&
+              otaUpload.hash(otaUploadId, c.hash);
+    if (ok && !otaVerifySignature(OTA_PUBLIC_KEY, c.hash, c.sig, sigLen)) {
+      LOG_WARN("⚠️  Update %lu: signature does not match the image and OTA_PUBLIC_KEY\n",
+               (unsigned long)otaUploadId);
+      ok = false;
+    }
+    if (ok) {
+      c.sigLen = (uint8_t)sigLen;
+      c.active = true;
+      c.imageId = otaUploadId;
+      c.size = otaUpload.size();
+      memset(otaSending, 0, sizeof(otaSending));
+      memset(otaRequested, 0, sizeof(otaRequested));
+      otaCursor = 0;
+      campaign.store(c);
+      LOG_INFO("📤 Offering update %lu (%lu bytes)\n", (unsigned long)c.imageId, (unsigned long)c.size);
+    }
+    replyUpload("start", ok);
+  } else if (strcmp(verb, "stop") == 0) {
+    replyUpload("stop", true);
+  } else {
+    LOG_WARN("⚠️  Usage: ota begin <size> <imageId> | ota chunk <index> <hex> | ota start <signature hex> | ota stop\n");
+  }
+}
+
+void runCommand(char *line) {
+  char *save;
+  char *command = strtok_r(line, " ", &save);
+  if (command == nullptr) return;
+  if (strcmp(command, "config") == 0) {
+    commandConfig(save);
+  } else if (strcmp(command, "ota") == 0) {
+    commandOta(save);
+  } else {
+    LOG_WARN("⚠️  Unknown command %s\n", command);
+  }
+}
+
+bool sectorBit(const uint8_t *map, uint32_t sector) { return (map[sector / 8] >> (sector % 8)) & 1; }
+
+/**
+ * @brief Broadcast the next chunk of the current round
+ *
+ * A round sends the sectors some sender asked for, in order. Requests for
+ * sectors this round has yet to reach are already covered; the rest wait for
+ * the next round.
+ * @return true if a chunk went out (or is to be retried)
+ */
+bool streamOtaChunk() {
+  ota_campaign c = campaign.load();
+  uint32_t sectors = otaUpload.sectors();
+
+  while (!otaRequestRing.empty()) {
+    const ota_request &req = otaRequestRing.peek();
+    for (uint32_t s = 0; c.active && s < sectors && s / 8 < req.len; s++) {
+      if (!sectorBit(req.sectors, s)) continue;
+      bool ahead = s * OTA_CHUNKS_PER_SECTOR >= otaCursor && sectorBit(otaSending, s);
+      if (!ahead) otaRequested[s / 8] |= (uint8_t)(1u << (s % 8));
+    }
+    otaRequestRing.drop(1);
+  }
+  if (!c.active) return false;
+
+  uint32_t sector = otaCursor < otaUpload.chunks() ? otaCursor / OTA_CHUNKS_PER_SECTOR : sectors;
+  while (sector < sectors && !sectorBit(otaSending, sector)) sector++;
+  if (sector >= sectors) {
+    memcpy(otaSending, otaRequested, sizeof(otaSending));
+    memset(otaRequested, 0, sizeof(otaRequested));
+    otaCursor = 0;
+    return false;
+  }
+  if (otaCursor < sector * OTA_CHUNKS_PER_SECTOR) otaCursor = sector * OTA_CHUNKS_PER_SECTOR;
+
+  uint8_t data[OTA_CHUNK_SIZE];
+  uint8_t frame[FRAME_OTA_CHUNK_MAX_SIZE];
+  size_t len = otaUpload.read(otaCursor, data);
+  size_t frameLen = encodeOtaChunkFrame(frame, sizeof(frame), gatewayMac, otaSeq++, c.imageId,
+                                        (uint16_t)otaCursor, data, len);
+  frameLen = signControlFrame(chunkKey, frame, frameLen, sizeof(frame));
+  // Out of send buffers: the same chunk again after the pause
+  if (frameLen == 0 || esp_now_send(broadcastAddress, frame, frameLen) != ESP_ERR_ESPNOW_NO_MEM) otaCursor++;
+  return true;
+}
+
+/**
+ * @brief Control stage: reads commands from the UART and streams the update
+ */
+void controlTask(void *param) {
+  static char line[COMMAND_LINE_MAX];
+  size_t lineLen = 0;
+  bool overlong = false;
+
+  for (;;) {
+    while (Serial.available() > 0) {
+      int c = Serial.read();
+      if (c == '\n' || c == '\r') {
+        line[lineLen] = '\0';
+        if (overlong) {
+          LOG_WARN("⚠️  Command longer than %d characters ignored\n", COMMAND_LINE_MAX - 1);
+        } else if (lineLen > 0) {
+          runCommand(line);
+        }
+        lineLen = 0;
+        overlong = false;
+      } else if (lineLen < sizeof(line) - 1) {
+        line[lineLen++] = (char)c;
+      } else {
+        overlong = true;
+      }
+    }
+    vTaskDelay(pdMS_TO_TICKS(streamOtaChunk() ? OTA_CHUNK_INTERVAL_MS : CONTROL_POLL_MS));
+  }
+}
+#endif
+
+// ==================== SETUP ====================
+
+void setup() {
+  Serial.setTxBufferSize(FORWARD_BUFFER_SIZE);
+#if REMOTE_CONTROL
+  Serial.setRxBufferSize(4 * COMMAND_LINE_MAX);
+#endif
+  Serial.begin(FORWARD_BAUD);
+
+  LOG_INFO("\n========================================\n");
+  LOG_INFO("   ESP32 RECEIVER - GATEWAY\n");
+  LOG_INFO("========================================\n\n");
+
+  esp_read_mac(gatewayMac, ESP_MAC_WIFI_STA);
+  frameDeriveKey((const uint8_t *)FLEET_KEY, "bcn", gatewayMac, beaconKey);
+  epochMs = millis();
+
+#if REMOTE_CONTROL
+  gatewayPrefs.begin("gateway", false);
+  configVersion = gatewayPrefs.getUInt("cfgver", 0);
+  reportIntervalMs = gatewayPrefs.getUInt("interval", REPORT_INTERVAL_MS);
+  gatewayPrefs.end();
+  frameDeriveFleetKey((const uint8_t *)FLEET_KEY, "chunk", chunkKey);
+#endif
+
+  xTaskCreatePinnedToCore(decodeTask, "decode", DECODE_TASK_STACK, nullptr,
+                          DECODE_TASK_PRIORITY, &decodeTaskHandle, DECODE_TASK_CORE);
+#if REMOTE_CONTROL
+  xTaskCreatePinnedToCore(controlTask, "control", CONTROL_TASK_STACK, nullptr,
+                          CONTROL_TASK_PRIORITY, &controlTaskHandle, CONTROL_TASK_CORE);
+#endif
+
+  if (!initESPNow()) {
+    LOG_WARN("\n⚠️  Gateway will not receive anything!\n");
+    return;
+  }
+
+  LOG_INFO("📱 MAC Address : %02X:%02X:%02X:%02X:%02X:%02X\n",
+           gatewayMac[0], gatewayMac[1], gatewayMac[2],
+           gatewayMac[3], gatewayMac[4], gatewayMac[5]);
+  LOG_INFO("📡 WiFi Channel: %d\n", WIFI_CHANNEL);
+  LOG_INFO("✅ Gateway ready, forwarding at %d baud\n\n", FORWARD_BAUD);
+}
+
+// ==================== MAIN LOOP ====================
+
+void loop() {
+  // All work happens in the receive callback and the decode and control tasks
+  vTaskDelete(NULL);
+}
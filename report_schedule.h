@@ -0,0 +1,81 @@
+#ifndef REPORT_SCHEDULE_H
+#define REPORT_SCHEDULE_H
+
+#include <stdint.h>
+
+// ==================== REPORT SCHEDULE ====================
+//
+// When the next report goes out. Free-running: one interval after the
+// previous report, plus or minus jitterMs. Slotted (TDMA): the interval is
+// split into `slots` equal slots counted from epochMs, the report goes out at
+// the start of the node's own slot, with up to jitterMs (capped at half a
+// slot) of forward jitter. Nodes powered up together thus stop reporting on
+// the same millis() boundaries.
+//
+// The random input is supplied by the caller (esp_random() on the device), so
+// the same code runs in the host simulation (sim/).
+
+class ReportSchedule {
+public:
+  constexpr ReportSchedule(bool slotted, uint8_t slots, uint32_t jitterMs)
+      : slotted_(slotted), slot_(0), slots_(slots), epochMs_(0), jitterMs_(jitterMs) {}
+
+  /**
+   * @brief Default slot for a node: its MAC hashed (FNV-1a) onto the slot count
+   */
+  static uint8_t macSlot(const uint8_t mac[6], uint8_t slots) {
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < 6; i++) {
+      hash = (hash ^ mac[i]) * 16777619u;
+    }
+    return (uint8_t)(hash % slots);
+  }
+
+  /**
+   * @brief Use this slot; epochMs is the local time at which slot 0 started
+   */
+  void assign(uint8_t slot, uint8_t slots, uint32_t epochMs) {
+    if (slots == 0 || slot >= slots) return;
+    slot_ = slot;
+    slots_ = slots;
+    epochMs_ = epochMs;
+  }
+
+  /**
+   * @brief Time of the report after one sent (or skipped) at nowMs
+   * @param random Uniformly distributed 32-bit value
+   */
+  uint32_t next(uint32_t nowMs, uint32_t intervalMs, uint32_t random) const {
+    uint32_t jitter = jitterMs_;
+    if (slotted_) {
+      uint32_t slotWidth = intervalMs / slots_;
+      if (jitter > slotWidth / 2) jitter = slotWidth / 2;  // Stay inside our slot
+      // Reduce before subtracting: our slot may still be ahead of nowMs
+      uint32_t sinceEpoch = (nowMs - epochMs_) % intervalMs;
+      uint32_t offset = (slot_ * slotWidth) % intervalMs;
+      uint32_t sinceSlot = (sinceEpoch + intervalMs - offset) % intervalMs;
+      return nowMs + (intervalMs - sinceSlot) + (jitter > 0 ? random % jitter : 0);
+    }
+    if (jitter > intervalMs / 2) jitter = intervalMs / 2;
+    return nowMs + intervalMs - jitter + (jitter > 0 ? random % (2 * jitter) : 0);
+  }
+
+  /**
+   * @brief Offset of this node's slot from the interval start (0 when free-running)
+   */
+  uint32_t slotOffset(uint32_t intervalMs) const {
+    return slotted_ ? slot_ * (intervalMs / slots_) : 0;
+  }
+
+  uint8_t slot() const { return slot_; }
+  uint8_t slots() const { return slots_; }
+
+private:
+  bool slotted_;
+  uint8_t slot_;
+  uint8_t slots_;
+  uint32_t epochMs_;
+  uint32_t jitterMs_;
+};
+
+#endif  // REPORT_SCHEDULE_H
@@ -0,0 +1,81 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <stddef.h>
+#include <atomic>
+
+/**
+ * @brief Fixed-capacity single-producer/single-consumer ring buffer
+ *
+ * Lock-free when exactly one context pushes and one context pops/peeks/drops.
+ * N must be a power of two; storage is static, nothing is allocated.
+ */
+template <typename T, size_t N>
+class RingBuffer {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "RingBuffer capacity must be a power of two");
+
+public:
+  bool push(const T &item) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) >= N) return false;
+    items_[head & (N - 1)] = item;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Next free slot, for filling in place (producer side)
+   * @return nullptr if full; the item becomes visible to the consumer on commit()
+   */
+  T *claim() {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) >= N) return nullptr;
+    return &items_[head & (N - 1)];
+  }
+
+  /**
+   * @brief Publish the slot returned by claim() (producer side)
+   */
+  void commit() {
+    head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  bool pop(T &item) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == head_.load(std::memory_order_acquire)) return false;
+    item = items_[tail & (N - 1)];
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Returns the i-th oldest item without removing it (consumer side)
+   */
+  const T &peek(size_t i = 0) const {
+    return items_[(tail_.load(std::memory_order_relaxed) + i) & (N - 1)];
+  }
+
+  /**
+   * @brief Discards up to n of the oldest items (consumer side)
+   */
+  void drop(size_t n) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    size_t count = head_.load(std::memory_order_acquire) - tail;
+    tail_.store(tail + (n < count ? n : count), std::memory_order_release);
+  }
+
+  size_t size() const {
+    return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+  }
+
+  bool empty() const { return size() == 0; }
+  bool full() const { return size() >= N; }
+  static constexpr size_t capacity() { return N; }
+
+private:
+  T items_[N];
+  std::atomic<size_t> head_{0};
+  std::atomic<size_t> tail_{0};
+};
+
+#endif  // RING_BUFFER_H
@@ -0,0 +1,280 @@
+#ifndef SEND_WINDOW_H
+#define SEND_WINDOW_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// ==================== SEND WINDOW ====================
+//
+// Ack-driven flow control for ESP-NOW. Encoded frames are copied into a fixed
+// pool of slots and move through two FIFOs:
+//
+//   enqueue() ──▶ pending ──markSent()──▶ in flight ──onAck()──▶ free
+//                    ▲                        │
+//                    └──── failed, retries ───┘
+//
+// At most W frames are in flight at once, which keeps esp_now_send() from
+// overrunning the driver's TX buffer (ESP_ERR_ESPNOW_NO_MEM). ESP-NOW reports
+// delivery in send order, so each onAck() settles the oldest in-flight frame.
+// Failed frames go back to the front of the pending queue until they run out
+// of retries. Frames keep their sequence number, so receivers drop duplicates.
+// Urgent frames (alarms) also go to the front, ahead of everything pending.
+// Frames whose report is overdue are sent again; their reports may still
+// turn up, so that many reports are then ignored rather than charged to the
+// frames sent after them (until a link reset, or another timeout of silence).
+//
+// A frame can carry a tag (e.g. how many flash log records it holds). The
+// final outcome of a tagged frame, acked or dropped, is queued for
+// popSettled(), however it settled (ack, send error, expiry, link reset or
+// dropAll()). A tagged frame keeps its slot until then, so the caller can
+// still read a dropped frame and rescue what it carried.
+//
+// Not thread-safe: owned by the single context that drives the radio.
+
+enum send_result : uint8_t {
+  SEND_ACKED,    // Delivered, slot released
+  SEND_RETRY,    // Failed, queued again for retransmission
+  SEND_DROPPED,  // Failed and out of retries, slot released
+  SEND_UNKNOWN,  // Ack with nothing in flight, or late for an expired frame (ignored)
+};
+
+template <size_t Slots, size_t W, size_t MaxFrame, uint8_t MaxRetries>
+class SendWindow {
+  static_assert(W >= 1 && W <= Slots, "Window must fit in the slot pool");
+
+public:
+  SendWindow() {
+    for (size_t i = 0; i < Slots; i++) freeList_[i] = (uint8_t)(Slots - 1 - i);
+    freeCount_ = Slots;
+  }
+
+  /**
+   * @brief Copy a frame into the window
+   * @param urgent Send it next, before frames already pending
+   * @param tag Nonzero to have the frame's outcome reported by popSettled()
+   * @return false if the frame is too large or every slot is taken
+   */
+  bool enqueue(const uint8_t *frame, size_t len, bool urgent = false, uint8_t tag = 0) {
+    if (len == 0 || len > MaxFrame || freeCount_ == 0) return false;
+    uint8_t idx = freeList_[--freeCount_];
+    memcpy(slots_[idx].data, frame, len);
+    slots_[idx].len = (uint8_t)len;
+    slots_[idx].retries = 0;
+    slots_[idx].tag = tag;
+    if (urgent) {
+      pending_.pushFront(idx);
+    } else {
+      pending_.pushBack(idx);
+    }
+    return true;
+  }
+
+  /**
+   * @brief Whether the next pending frame may be handed to the radio now
+   */
+  bool canSend() const {
+    return !pending_.empty() && inFlight_.size() < W && !blocked_;
+  }
+
+  /**
+   * @brief Next pending frame (retransmissions first); valid while canSend()
+   */
+  const uint8_t *peekPending(size_t &len) const {
+    const slot &s = slots_[pending_.front()];
+    len = s.len;
+    return s.data;
+  }
+
+  /**
+   * @brief The radio accepted the head pending frame
+   */
+  void markSent(uint32_t nowMs) {
+    uint8_t idx = pending_.popFront();
+    slots_[idx].sentMs = nowMs;
+    inFlight_.pushBack(idx);
+  }
+
+  /**
+   * @brief The radio's TX buffer is full: hold off until the next ack
+   *
+   * With nothing in flight no ack will come, so the caller simply retries.
+   */
+  void markBlocked() {
+    blocked_ = !inFlight_.empty();
+    blockedCount_++;
+  }
+
+  /**
+   * @brief The radio rejected the head pending frame outright
+   */
+  send_result onSendError() {
+    return settle(pending_.popFront(), false);
+  }
+
+  /**
+   * @brief Delivery report for the oldest in-flight frame
+   */
+  send_result onAck(bool success) {
+    blocked_ = false;
+    if (late_ > 0) {
+      late_--;
+      return SEND_UNKNOWN;
+    }
+    if (inFlight_.empty()) return SEND_UNKNOWN;
+    return settle(inFlight_.popFront(), success);
+  }
+
+  /**
+   * @brief Treat frames whose ack never arrived as failed
+   * @return Number of frames expired
+   */
+  size_t expire(uint32_t nowMs, uint32_t timeoutMs) {
+    if (late_ > 0 && nowMs - lateMs_ >= timeoutMs) late_ = 0;  // Those reports are not coming
+    if (inFlight_.empty() || nowMs - slots_[inFlight_.front()].sentMs < timeoutMs) return 0;
+    size_t n = requeueAll();
+    late_ += n;
+    lateMs_ = nowMs;
+    return n;
+  }
+
+  /**
+   * @brief Put every in-flight frame back in front of the queue (link reset)
+   *
+   * No report will come for them, nor for frames expired earlier.
+   * @return Number of frames requeued or dropped
+   */
+  size_t requeueInFlight() {
+    late_ = 0;
+    return requeueAll();
+  }
+
+  /**
+   * @brief Give up on every queued frame, without retries (e.g. before deep sleep)
+   * @return Number of frames dropped
+   */
+  size_t dropAll() {
+    size_t n = 0;
+    blocked_ = false;
+    while (!inFlight_.empty()) {
+      settle(inFlight_.popFront(), false, false);
+      n++;
+    }
+    while (!pending_.empty()) {
+      settle(pending_.popFront(), false, false);
+      n++;
+    }
+    return n;
+  }
+
+  /**
+   * @brief Oldest unreported outcome of a tagged frame, releasing its slot
+   * @param frame If set, receives the frame's bytes, valid until the next enqueue()
+   * @return false if none is waiting
+   */
+  bool popSettled(uint8_t &tag, bool &acked, const uint8_t **frame = nullptr, size_t *len = nullptr) {
+    if (settledCount_ == 0) return false;
+    const settled_frame &f = settled_[settledHead_];
+    tag = slots_[f.idx].tag;
+    acked = f.acked;
+    if (frame != nullptr) *frame = slots_[f.idx].data;
+    if (len != nullptr) *len = slots_[f.idx].len;
+    freeList_[freeCount_++] = f.idx;
+    settledHead_ = (settledHead_ + 1) % Slots;
+    settledCount_--;
+    return true;
+  }
+
+  size_t pending() const { return pending_.size(); }
+  size_t inFlight() const { return inFlight_.size(); }
+  size_t freeSlots() const { return freeCount_; }
+  bool empty() const { return pending_.empty() && inFlight_.empty(); }
+
+  uint32_t retransmits() const { return retransmits_; }
+  uint32_t dropped() const { return dropped_; }
+  uint32_t blockedCount() const { return blockedCount_; }
+
+private:
+  struct slot {
+    uint8_t data[MaxFrame];
+    uint8_t len;
+    uint8_t retries;
+    uint8_t tag;
+    uint32_t sentMs;
+  };
+
+  struct settled_frame {
+    uint8_t idx;  // Slot, held until popSettled()
+    bool acked;
+  };
+
+  // Tiny deque of slot indices
+  struct index_queue {
+    uint8_t items[Slots];
+    size_t head = 0;
+    size_t count = 0;
+
+    bool empty() const { return count == 0; }
+    size_t size() const { return count; }
+    uint8_t front() const { return items[head]; }
+    void pushBack(uint8_t v) { items[(head + count++) % Slots] = v; }
+    void pushFront(uint8_t v) {
+      head = (head + Slots - 1) % Slots;
+      items[head] = v;
+      count++;
+    }
+    uint8_t popFront() {
+      uint8_t v = items[head];
+      head = (head + 1) % Slots;
+      count--;
+      return v;
+    }
+    uint8_t popBack() { return items[(head + --count) % Slots]; }
+  };
+
+  size_t requeueAll() {
+    size_t n = 0;
+    blocked_ = false;
+    // Newest first so the oldest ends up at the very front again
+    while (!inFlight_.empty()) {
+      settle(inFlight_.popBack(), false);
+      n++;
+    }
+    return n;
+  }
+
+  send_result settle(uint8_t idx, bool success, bool retry = true) {
+    if (!success && retry && slots_[idx].retries < MaxRetries) {
+      slots_[idx].retries++;
+      retransmits_++;
+      pending_.pushFront(idx);
+      return SEND_RETRY;
+    }
+    if (!success) dropped_++;
+    // At most Slots tagged frames exist at once, so there is always room
+    if (slots_[idx].tag != 0) {
+      settled_[(settledHead_ + settledCount_++) % Slots] = {idx, success};
+    } else {
+      freeList_[freeCount_++] = idx;
+    }
+    return success ? SEND_ACKED : SEND_DROPPED;
+  }
+
+  slot slots_[Slots];
+  index_queue pending_;
+  index_queue inFlight_;
+  uint8_t freeList_[Slots];
+  size_t freeCount_ = 0;
+  bool blocked_ = false;
+  size_t late_ = 0;       // Reports still owed to expired frames
+  uint32_t lateMs_ = 0;   // When the last frames expired
+  settled_frame settled_[Slots];
+  size_t settledHead_ = 0;
+  size_t settledCount_ = 0;
+
+  uint32_t retransmits_ = 0;
+  uint32_t dropped_ = 0;
+  uint32_t blockedCount_ = 0;
+};
+
+#endif  // SEND_WINDOW_H
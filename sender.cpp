@@ -1,288 +1,2857 @@
 #include <esp_now.h>
 #include <WiFi.h>
 #include <esp_wifi.h>
-#include <DHT.h>
+#include <esp_sleep.h>
+#include <esp_timer.h>
+#include <esp_pm.h>
+#include <esp_ota_ops.h>
+#include <Wire.h>
+#include <esp_cpu.h>
+#include <esp_heap_caps.h>
+#include <Preferences.h>
+#include <atomic>
+#include "dht22_async.h"
+#include "mq_adc.h"
+#include "max30102.h"
+#include "sensor_frame.h"
+#include "ring_buffer.h"
+#include "logging.h"
+#include "send_window.h"
+#include "flash_log.h"
+#include "peer_table.h"
+#include "adaptive_interval.h"
+#include "seqlock.h"
+#include "benchmark.h"
+#include "report_schedule.h"
+#include "node_health.h"
+#include "frame_crypto.h"
+#include "window_stats.h"
+#include "anomaly_detector.h"
+#include "ota_image.h"
 
 // ==================== CONFIGURATION ====================
 
-// REPLACE with your Receiver ESP32's MAC Address
-uint8_t serverAddress[] = {0xB8, 0xD6, 0x1A, 0xA7, 0x66, 0x88};
+// REPLACE with your Receiver ESP32 MAC Addresses: primary first, then any
+// failover gateways. Each frame goes to the best-rated one (see peer_table.h)
+uint8_t serverAddresses[][6] = {
+  {0xB8, 0xD6, 0x1A, 0xA7, 0x66, 0x88},
+};
+#define MAX_PEERS 4               // Peer table capacity
+#define PEER_PROBE_INTERVAL_MS 60000  // Send one frame via a standby peer this often
+
+// Set to 1 to broadcast every frame to all gateways in range instead.
+// Broadcasts are never acknowledged, so nothing is retransmitted.
+#define PEER_BROADCAST 0
+
+// Encryption (see frame_crypto.h): 0 off, 1 ESP-NOW CCMP encrypted peers,
+// 2 AES-GCM sealed frames, for gateways serving more senders than ESP-NOW's
+// encrypted peer limit. REPLACE both keys (16 characters each) with the
+// gateway's before deployment.
+#define ENCRYPTION_MODE 2
+#define FLEET_PMK "pmk-change-me-16"  // ESP-NOW primary master key (mode 1)
+#define FLEET_KEY "key-change-me-16"  // Per-sender LMK and seal keys, and beacon checks, derive from it
+#define SEAL_COUNTER_BLOCK 1024       // Nonce counters reserved per NVS write (mode 2)
+
+#if ENCRYPTION_MODE == 2
+#define FRAME_PAYLOAD_MAX (FRAME_MAX_SIZE - FRAME_SEAL_OVERHEAD)
+#else
+#define FRAME_PAYLOAD_MAX FRAME_MAX_SIZE
+#endif
 
 // DHT22 Sensor Configuration
 #define DHTPIN 4
-#define DHTTYPE DHT22
+#define DHT_WAKE_TIMEOUT_MS 30  // Max wait for a conversion after boot/wake
+
+// MQ Sensor Configuration (Analog Pin - Use ADC1 pins only: 32-39)
+// NOTE: ADC2 pins (0,2,4,12-15,25-27) don't work with WiFi!
+#define MQ_PIN 34  // GPIO34 is ADC1_CH6 - Safe to use with WiFi
+
+// Oversample the MQ sensor in the background with the ADC DMA driver and report
+// the per-window mean (falls back to a single analogRead() if set to 0 or if
+// the driver fails to start)
+#define MQ_CONTINUOUS_ADC 1
+
+// MAX30102 pulse oximeter on I2C, FIFO drained on its INT pin (set to 0 for
+// simulated heart rate/SpO2 on nodes without the sensor). Heart rate and SpO2
+// are reported as 0 while no finger is on the sensor.
+#define MAX30102_ENABLED 1
+#define MAX30102_INT_PIN 19
+#define I2C_SDA_PIN 21
+#define I2C_SCL_PIN 22
+#define I2C_CLOCK_HZ 400000
+
+// Send data every 12 seconds
+const unsigned long SEND_INTERVAL = 12000;
+
+// Batch mode: sample every SAMPLE_INTERVAL into a ring buffer and ship up to
+// BATCH_MAX_SAMPLES readings per ESP-NOW frame (set to 0 for one frame per sample)
+#define BATCH_MODE 0
+
+// Delta codec: batches go out as FRAME_DELTA (keyframe + compressed deltas,
+// see sensor_frame.h), fitting ~35 noisy or up to 128 steady readings per
+// frame instead of 23. Raise BATCH_FLUSH_TIMEOUT to actually fill them.
+#define BATCH_DELTA_CODEC 1
+
+#if BATCH_DELTA_CODEC
+#define BATCH_MAX_SAMPLES 64
+#else
+#define BATCH_MAX_SAMPLES \
+  ((FRAME_PAYLOAD_MAX - FRAME_HEADER_SIZE - FRAME_BATCH_COUNT_SIZE) / FRAME_SAMPLE_SIZE)
+#endif
+#define SAMPLE_RING_SIZE 128  // Power of two, >= BATCH_MAX_SAMPLES
+const unsigned long SAMPLE_INTERVAL = 1200;  // DHT22 itself refreshes at most every 2s
+const unsigned long BATCH_FLUSH_TIMEOUT = SEND_INTERVAL;  // Max age of a partial batch
+
+// Aggregate mode: sample every AGGREGATE_SAMPLE_MS and send one FRAME_SUMMARY
+// per report (count, mean, min, max and stddev per sensor, see window_stats.h)
+// instead of a point sample taken just before sending. The DHT22 values
+// repeat between its 2s conversions; MQ and pulse readings are fresh each time.
+#define AGGREGATE_MODE 0
+const unsigned long AGGREGATE_SAMPLE_MS = 1000;
+
+// WiFi Channel (1-13, match with receiver). With AUTO_PAIRING this is only
+// the fallback when no gateway has been found yet
+#define WIFI_CHANNEL 1
+
+// Auto pairing: on first boot, scan the channels for a gateway (FRAME_DISCOVER
+// / FRAME_BEACON handshake) and cache its MAC and channel in NVS. Re-scan when
+// the link still delivers nothing after RESCAN_AFTER_RESTARTS recoveries.
+#define AUTO_PAIRING 1
+#define SCAN_CHANNEL_MAX 13
+#define SCAN_DWELL_MS 60          // Listen time per channel for beacons
+#define RESCAN_AFTER_RESTARTS 2
+
+// Maximum retry attempts for ESP-NOW initialization
+#define MAX_INIT_RETRIES 3
+
+// Link recovery: restart ESP-NOW after this many consecutive delivery failures,
+// retrying with exponential backoff between attempts
+#define RECOVERY_FAILURE_THRESHOLD 5
+#define RECOVERY_BACKOFF_MIN_MS 1000
+#define RECOVERY_BACKOFF_MAX_MS 60000
+#define ACK_RING_SIZE 16  // Delivery reports buffered between callback and consumer
+
+// Send window: at most SEND_WINDOW_SIZE frames awaiting OnDataSent at once, out
+// of SEND_QUEUE_SLOTS buffered; failed frames are retransmitted up to
+// SEND_MAX_RETRIES times before being dropped
+#define SEND_WINDOW_SIZE 4
+#define SEND_QUEUE_SLOTS 8
+#define SEND_MAX_RETRIES 3
+#define SEND_ACK_TIMEOUT_MS 1000  // In-flight frames with no callback by then are resent
+
+// Store-and-forward: readings taken while the link is down are appended to a
+// ring log in flash (partition below, see partitions.csv) and drained oldest
+// first as batch frames once it's back. Survives reboots and firmware updates.
+// Stored readings leave the log only once their frame is acknowledged, so one
+// stored batch is in flight at a time.
+#define STORE_FORWARD 1
+#define STORE_FORWARD_PARTITION "storefwd"
+#define STORE_DRAIN_FRAMES 4  // Deep sleep: stored batches sent per wake, each waiting for its ack
+
+// Deep-sleep mode: wake on the RTC timer every SEND_INTERVAL, read the sensors,
+// send one frame, wait for the delivery callback and sleep again (loop() never runs)
+#define DEEP_SLEEP_MODE 0
+#define ACK_TIMEOUT_MS 200  // Max wait for the send window to drain before sleeping anyway
+
+// Pipeline mode: run sampling, encoding and transmission as separate FreeRTOS
+// tasks linked by lock-free ring buffers instead of serially in loop()
+#define PIPELINE_MODE 0
+#define TX_RING_SIZE 8          // Encoded frames waiting for the radio task
+#define SENSOR_POLL_MS 20       // Sensor task tick (DHT22 state machine)
+#define RADIO_RETRY_MS 1000     // Radio task retry period while frames are pending
+#define SENSOR_TASK_CORE 1      // Application core, away from the Wi-Fi stack
+#define ENCODE_TASK_CORE 1
+#define RADIO_TASK_CORE 0       // Same core as the Wi-Fi/ESP-NOW stack
+
+// Report-by-exception: only transmit a reading when some channel has moved
+// past its deadband since the last reported one, or the heartbeat is due.
+// The receiver holds the last value in between.
+#define DEADBAND_MODE 0
+#define DEADBAND_TEMP 0.2f   // °C
+#define DEADBAND_HUM 1.0f    // %
+#define DEADBAND_MQ 40       // Raw ADC counts
+#define DEADBAND_HR 5.0f     // bpm
+#define DEADBAND_SPO2 2.0f   // %
+const unsigned long DEADBAND_HEARTBEAT_MS = 300000;  // Max silence, counted in reading intervals
+
+// Adaptive interval: back off while deliveries keep failing (channel
+// congestion), speed up while readings move by more than the deadbands above.
+// Scales SEND_INTERVAL, or BATCH_FLUSH_TIMEOUT in batch mode.
+#define ADAPTIVE_INTERVAL 0
+const unsigned long ADAPT_MIN_INTERVAL = 3000;
+const unsigned long ADAPT_MAX_INTERVAL = 120000;
+
+// Slotted transmission: nodes powered up together would otherwise report on
+// the same millis() boundaries. TDMA mode splits each reporting interval into
+// TDMA_SLOTS slots and sends in this node's own one, derived from its MAC
+// until a gateway assigns one (FRAME_SLOT). Up to SEND_JITTER_MS of random
+// jitter is added on top (kept inside the slot in TDMA mode).
+#define TDMA_MODE 0
+#define TDMA_SLOTS 16
+#define SEND_JITTER_MS 1000
+
+// Benchmark mode: time the read/encode/send/ack stages in CPU cycles,
+// histogram the send-to-delivery-callback latency and print a summary with
+// throughput and heap/stack high-water marks every BENCH_REPORT_MS (every
+// BENCH_REPORT_CYCLES wakes in deep sleep mode, where the counters live in RTC
+// memory). Costs a few hundred bytes and a cycle-counter read per stage.
+#define BENCHMARK_MODE 0
+#define BENCH_REPORT_MS 60000
+#define BENCH_REPORT_CYCLES 10
+
+// Health telemetry: every HEALTH_INTERVAL_MS the next data frame carries a
+// health trailer (delivery counts, ack rate, retries, queue depth, free heap,
+// loop time, wake time, RSSI) for the gateway to forward
+#define HEALTH_TRAILER 1
+#define HEALTH_INTERVAL_MS 60000
+#define HEALTH_REPORT_CYCLES 10  // Deep sleep: every this many wakes instead
+
+// Anomaly detection: every reading is checked against absolute limits and a
+// moving baseline per channel (anomaly_detector.h). An anomaly goes out at
+// once as a FRAME_ALARM, ahead of any queued frames, instead of waiting for
+// the next report. Between reports, point mode also takes a reading every
+// ANOMALY_WATCH_MS just for the check. Off in DEEP_SLEEP_MODE, where a wake's
+// only reading is reported right away anyway.
+#define ANOMALY_DETECT 1
+const unsigned long ANOMALY_WATCH_MS = 1000;
+const unsigned long ANOMALY_HOLDOFF_MS = 10000;  // Repeat period while a channel stays in alarm
+#define ANOMALY_EWMA_ALPHA 0.05f  // Baseline weight of each reading (~20 readings)
+#define ANOMALY_TEMP_HIGH 50.0f   // °C
+#define ANOMALY_MQ_HIGH 2500      // Raw ADC counts
+#define ANOMALY_MQ_JUMP 400       // Raw ADC counts away from the baseline
+#define ANOMALY_HR_LOW 40.0f      // bpm
+#define ANOMALY_HR_HIGH 150.0f    // bpm
+#define ANOMALY_HR_JUMP 30.0f     // bpm away from the baseline
+#define ANOMALY_SPO2_LOW 90.0f    // %
+
+// Power save: the CPU runs at POWER_MIN_CPU_MHZ between loop passes and,
+// while no driver or sensor conversion holds it awake, drops into automatic
+// light sleep until the next tick it has work for (ESP-IDF power management;
+// the core needs CONFIG_PM_ENABLE, and CONFIG_FREERTOS_USE_TICKLESS_IDLE for
+// light sleep). The radio modem-sleeps and listens for ESP-NOW
+// ESPNOW_WAKE_WINDOW_MS of every ESPNOW_WAKE_INTERVAL_MS, so the node stays
+// paired without the boot cost of DEEP_SLEEP_MODE. The ADC DMA of
+// MQ_CONTINUOUS_ADC keeps the APB clock up, which rules out light sleep:
+// set it to 0 for the full saving.
+#define POWER_SAVE_MODE 0
+#define POWER_MAX_CPU_MHZ 240
+#define POWER_MIN_CPU_MHZ 80       // Below 80 MHz the APB clock (UART baud) follows the CPU
+#define POWER_LIGHT_SLEEP 1
+#define ESPNOW_WAKE_WINDOW_MS 20
+#define ESPNOW_WAKE_INTERVAL_MS 100
+
+// Remote control: the gateway can push settings into NVS with a FRAME_CONFIG
+// (report interval, Wi-Fi channel, gateway MAC) and broadcast a firmware
+// update to every node at once (FRAME_OTA_*, see ota_image.h). Images are
+// written straight to the spare OTA partition and only booted once they
+// match an offer signed by the release key. A transfer cut short by a reboot or a stall resumes from
+// the chunks recorded in NVS. Channel and gateway changes need AUTO_PAIRING
+// (they replace the cached pairing) and take effect with a restart.
+#define REMOTE_CONTROL 1
+#define CONTROL_RING_SIZE 32            // Control frames buffered between callback and consumer
+#define CONTROL_POLL_MS 5               // Loop period while an update is coming in
+#define CONTROL_LISTEN_MS 50            // Deep sleep: wait this long for the gateway after a report
+#define CONTROL_RESTART_DELAY_MS 2000   // Lets the last reply go out before restarting
+#define OTA_STATUS_INTERVAL_MS 10000    // Progress report (and NVS checkpoint) period
+#define OTA_STALL_MS 60000              // Pause the transfer after this long without a chunk
+// Public half of the ECDSA P-256 release key that signs images (README). The
+// placeholder's private key was discarded: replace it with your own before
+// deployment, or no image will ever be accepted.
+#define OTA_PUBLIC_KEY \
+  "-----BEGIN PUBLIC KEY-----\n" \
+  "MFkwEwYHKoZIzj0CAQYIKoZIzj0DAQcDQgAEbYk+u4w16Ne6tN95HVpQihWidtDN\n" \
+  "ofhs93BYMaQV6Ngxz5NATbye+qeGb2wWfdPuvgzSHnHgyszGkKJCbWguFw==\n" \
+  "-----END PUBLIC KEY-----\n"
+const unsigned long CONFIG_MIN_INTERVAL = 1000;
+const unsigned long CONFIG_MAX_INTERVAL = 3600000;
+
+#define ANOMALY_WATCH (ANOMALY_DETECT && !DEEP_SLEEP_MODE)
+
+#if DEEP_SLEEP_MODE && (BATCH_MODE || PIPELINE_MODE)
+#error "BATCH_MODE/PIPELINE_MODE keep samples in RAM and cannot be combined with DEEP_SLEEP_MODE"
+#endif
+
+#if AGGREGATE_MODE && (BATCH_MODE || PIPELINE_MODE || DEEP_SLEEP_MODE)
+#error "AGGREGATE_MODE samples in loop() and cannot be combined with BATCH_MODE, PIPELINE_MODE or DEEP_SLEEP_MODE"
+#endif
+
+#if POWER_SAVE_MODE && DEEP_SLEEP_MODE
+#error "POWER_SAVE_MODE keeps the node running between readings and cannot be combined with DEEP_SLEEP_MODE"
+#endif
+
+#if ENCRYPTION_MODE == 1 && PEER_BROADCAST
+#error "ESP-NOW cannot encrypt broadcasts: use ENCRYPTION_MODE 2 with PEER_BROADCAST"
+#endif
+
+static_assert(sizeof(FLEET_PMK) == FRAME_KEY_SIZE + 1, "FLEET_PMK must be 16 characters");
+static_assert(sizeof(FLEET_KEY) == FRAME_KEY_SIZE + 1, "FLEET_KEY must be 16 characters");
+
+// ==================== FUNCTION PROTOTYPES ====================
+
+bool initESPNow();
+bool scanForGateway();
+void saveLinkState();
+void pumpSendWindow();
+bool sendFrame(const uint8_t *frame, size_t frameLen, bool urgent = false, uint8_t records = 0);
+bool checkAnomaly(const sensor_data &reading);
+unsigned long reportInterval();
+void serviceControl();
+void configureModemSleep();
+#if STORE_FORWARD
+bool storeForwardActive();
+bool storeForLater(const sensor_data &sample);
+size_t drainStoredBacklog();
+void keepDroppedFrame(const uint8_t *frame, size_t len);
+#endif
+
+// ==================== GLOBAL VARIABLES ====================
+
+Dht22Async dht(DHTPIN);
+MqAdc mqAdc;
+Max30102 oximeter;
+mq_window mqWindow;  // Statistics behind the last reported mq_value
+Seqlock<sensor_data> latestSample;  // Newest reading, readable from any task
+
+std::atomic<bool> espNowConnected{false};  // Written by the recovery path, read by every stage
+uint8_t wifiChannel = WIFI_CHANNEL;
+SendWindow<SEND_QUEUE_SLOTS, SEND_WINDOW_SIZE, FRAME_MAX_SIZE, SEND_MAX_RETRIES> sendWindow;
+PeerTable<MAX_PEERS> peers;
+const uint8_t broadcastAddress[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+#if PIPELINE_MODE
+TaskHandle_t radioTaskHandle = nullptr;
+#endif
+
+#if STORE_FORWARD
+FlashLog flashLog;
+
+// Outcome of a stored batch, from the radio context to the flash log's owner
+typedef struct stored_settle_event {
+  uint8_t records;  // Flash log records the frame carried
+  bool acked;
+} stored_settle_event;
+
+RingBuffer<stored_settle_event, 4> storedSettleRing;
+size_t storedInFlight = 0;  // Records handed on but not acknowledged yet (flash log owner)
+
+// Tag of live data frames, so that one which runs out of retries can still
+// be rescued into the flash log (stored batches are tagged with their records)
+#define LIVE_FRAME_TAG 0xFF
+static_assert(BATCH_MAX_SAMPLES < LIVE_FRAME_TAG, "Stored batch tags must stay below LIVE_FRAME_TAG");
+
+// Plain copy of a dropped live frame, from the radio context to the flash log's owner
+typedef struct dropped_frame {
+  uint8_t len;
+  uint8_t data[FRAME_MAX_SIZE];
+} dropped_frame;
+
+RingBuffer<dropped_frame, SEND_QUEUE_SLOTS> droppedFrameRing;
+#else
+#define LIVE_FRAME_TAG 0  // Nowhere to rescue a dropped frame to
+#endif
+
+#if POWER_SAVE_MODE && CONFIG_PM_ENABLE
+esp_pm_lock_handle_t cpuLock = nullptr;     // Full clock while a pass does work
+esp_pm_lock_handle_t sensorLock = nullptr;  // No light sleep during a DHT22 conversion
+bool sensorLockHeld = false;
+#endif
+
+#if ENCRYPTION_MODE
+// Derived from FLEET_KEY and this node's MAC by initCrypto()
+uint8_t peerLmk[FRAME_KEY_SIZE];
+uint8_t sealKey[FRAME_KEY_SIZE];
+#endif
+
+// Delivery reports recorded by OnDataSent (Wi-Fi task) for processSendStatus()
+typedef struct send_status_event {
+  bool success;
+  uint8_t mac[6];
+  int64_t timeUs;
+} send_status_event;
+
+RingBuffer<send_status_event, ACK_RING_SIZE> ackRing;
+std::atomic<uint32_t> ackRingOverflows{0};
+
+// Signal strength of frames heard from a receiver, recorded by OnDataRecv
+typedef struct peer_rssi_event {
+  uint8_t mac[6];
+  int8_t rssi;
+} peer_rssi_event;
+
+RingBuffer<peer_rssi_event, ACK_RING_SIZE> rssiRing;
+
+// Gateways that answered a discovery probe, recorded by OnDataRecv
+typedef struct beacon_event {
+  uint8_t mac[6];
+  int8_t rssi;
+  uint8_t frame[FRAME_BEACON_SIZE];  // Checked by scanForGateway()
+} beacon_event;
+
+RingBuffer<beacon_event, 8> beaconRing;
+
+// Slot assignments from the gateway, recorded by OnDataRecv
+typedef struct slot_event {
+  uint8_t slot;
+  uint8_t slots;
+  unsigned long epochMs;  // Local millis() at which the gateway's interval started
+} slot_event;
+
+RingBuffer<slot_event, 2> slotRing;
+
+#if REMOTE_CONTROL
+// Config and update frames from the gateway, recorded by OnDataRecv
+typedef struct control_frame {
+  uint8_t mac[6];  // Radio source, checked against the gateways in peers
+  uint8_t len;
+  uint8_t data[FRAME_MAX_SIZE];
+} control_frame;
+
+RingBuffer<control_frame, CONTROL_RING_SIZE> controlRing;
+std::atomic<uint32_t> controlRingOverflows{0};
+uint32_t controlRejected = 0;  // Not from a gateway, or failed authentication
+
+// Derived from FLEET_KEY (and this node's MAC) by initCrypto()
+uint8_t controlKey[FRAME_KEY_SIZE];
+uint8_t chunkKey[FRAME_KEY_SIZE];
+
+// Firmware transfer in progress, owned by the context running serviceControl()
+typedef struct ota_session {
+  uint32_t imageId;
+  uint8_t digest[OTA_DIGEST_SIZE];  // Signed image hash from the offer
+  uint8_t state;                    // frame_ota_state
+  unsigned long lastChunkMs;
+  unsigned long lastStatusMs;
+  uint32_t savedStored;             // Chunks recorded by the last NVS checkpoint
+} ota_session;
+
+OtaImage otaImage;
+ota_session ota = {};
+std::atomic<bool> otaReceiving{false};  // ota.state == OTA_RECEIVING, for OnDataRecv
+uint16_t controlSeq = 0;  // Replies to the gateway
+bool restartPending = false;
+unsigned long restartAtMs = 0;
+#endif
+
+// Settings the gateway can change (kept in NVS, see loadRemoteConfig())
+RTC_DATA_ATTR uint32_t baseReportInterval = BATCH_MODE ? BATCH_FLUSH_TIMEOUT : SEND_INTERVAL;
+RTC_DATA_ATTR uint32_t appliedConfigVersion = 0;
+RTC_DATA_ATTR uint32_t runningImageId = 0;  // 0: flashed by cable
+#if REMOTE_CONTROL && PIPELINE_MODE
+// Interval set by the gateway in radioTask, applied by the task that schedules reports (0: none)
+std::atomic<uint32_t> pendingReportInterval{0};
+#endif
+
+// Report schedule, owned by the context that decides when to report
+unsigned long nextReportTime = 0;
+ReportSchedule sendSchedule(TDMA_MODE, TDMA_SLOTS, SEND_JITTER_MS);
+
+// Recovery state machine driven by serviceLinkRecovery()
+enum link_state : uint8_t {
+  LINK_UP,
+  LINK_RESTART,  // Failure threshold hit: tear ESP-NOW down
+  LINK_BACKOFF,  // Waiting before the next init attempt
+};
+
+link_state linkState = LINK_UP;
+int consecutiveFailures = 0;
+unsigned long recoveryBackoffMs = RECOVERY_BACKOFF_MIN_MS;
+unsigned long nextRecoveryMs = 0;
+int restartsSinceDelivery = 0;  // Link restarts with no successful delivery in between
+int64_t firstPacketUs = 0;  // esp_timer time of the first esp_now_send() accepted this boot
+
+// Delivery totals: counted by the radio context, read by the scheduler and the
+// health encoder (other tasks in PIPELINE_MODE). Kept as atomics in DRAM and
+// carried across deep sleep by saveCounters()/restoreCounters().
+std::atomic<uint32_t> successCount{0};
+std::atomic<uint32_t> failureCount{0};
+NodeHealth health;
+unsigned long lastHealthMs = 0;
+bool healthSent = false;  // Deep sleep: trailer already sent this wake
+
+// ==================== RTC STATE ====================
+// Kept in RTC slow memory: survives deep sleep, cleared on power-up
+
+#define RTC_LINK_MAGIC 0x45534E57  // "ESNW"
+
+typedef struct rtc_link_state {
+  uint32_t magic;
+  uint8_t peerAddr[6];
+  uint8_t channel;
+} rtc_link_state;
+
+RTC_DATA_ATTR uint32_t rtcSuccessCount = 0;
+RTC_DATA_ATTR uint32_t rtcFailureCount = 0;
+RTC_DATA_ATTR uint32_t rtcWakeMs = 0;  // Wake-to-transmit time of the previous cycle
+RTC_DATA_ATTR health_baseline healthBaseline;
+
+#if ENCRYPTION_MODE == 2
+RTC_DATA_ATTR uint32_t sealCounter = 0;   // Next nonce counter
+RTC_DATA_ATTR uint32_t sealReserved = 0;  // End of the block reserved in NVS (0: none yet)
+#endif
+RTC_DATA_ATTR uint16_t frameSeq = 0;
+RTC_DATA_ATTR uint32_t bootCount = 0;
+
+#if BENCHMARK_MODE
+RTC_DATA_ATTR Benchmark bench;
+unsigned long lastBenchReport = 0;
+
+// Adds the cycles spent in the enclosing scope to a benchmark stage
+struct bench_scope {
+  bench_stage stage;
+  uint32_t start;
+  explicit bench_scope(bench_stage s) : stage(s), start(esp_cpu_get_cycle_count()) {}
+  ~bench_scope() { bench.addCycles(stage, esp_cpu_get_cycle_count() - start); }
+};
+#define BENCH_SCOPE(stage) bench_scope benchScope_(stage)
+#else
+#define BENCH_SCOPE(stage) ((void)0)
+#endif
+RTC_DATA_ATTR rtc_link_state rtcLink;
+
+#if DEADBAND_MODE
+RTC_DATA_ATTR sensor_data lastReported;  // Reference for the deadband checks
+RTC_DATA_ATTR bool haveReported = false;
+RTC_DATA_ATTR uint32_t silentMs = 0;  // Reading intervals since the last report, summed
+#endif
+
+#if ADAPTIVE_INTERVAL
+RTC_DATA_ATTR AdaptiveInterval reportScheduler(BATCH_MODE ? BATCH_FLUSH_TIMEOUT : SEND_INTERVAL,
+                                               ADAPT_MIN_INTERVAL, ADAPT_MAX_INTERVAL);
+RTC_DATA_ATTR sensor_data lastCycleSample;  // Activity reference
+RTC_DATA_ATTR uint32_t lastCycleSuccess = 0;
+RTC_DATA_ATTR uint32_t lastCycleFailure = 0;
+#endif
+
+// Cached at startup by cacheDeviceMac()
+uint8_t deviceMac[6];
+char deviceMacStr[18];
+
+#if BATCH_MODE || PIPELINE_MODE
+RingBuffer<sensor_data, SAMPLE_RING_SIZE> sampleRing;
+unsigned long lastSampleTime = 0;
+#endif
+
+#if AGGREGATE_MODE
+WindowAggregator aggregator;  // Statistics of the current reporting window
+unsigned long lastAggregateSample = 0;
+#endif
+
+#if ANOMALY_WATCH
+// Per channel, in sample_fixed field order
+const anomaly_rule anomalyRules[FRAME_FIELD_COUNT] = {
+  {-INFINITY, ANOMALY_TEMP_HIGH, INFINITY},         // temperature
+  {-INFINITY, INFINITY, INFINITY},                  // humidity
+  {-INFINITY, ANOMALY_MQ_HIGH, ANOMALY_MQ_JUMP},    // mq_value
+  {ANOMALY_HR_LOW, ANOMALY_HR_HIGH, ANOMALY_HR_JUMP},  // heartRate
+  {ANOMALY_SPO2_LOW, INFINITY, INFINITY},           // spo2
+};
+AnomalyDetector anomaly(anomalyRules, ANOMALY_EWMA_ALPHA, ANOMALY_HOLDOFF_MS);
+uint16_t alarmSeq = 0;  // FRAME_ALARM numbering, owned by the sampling context
+unsigned long lastWatchTime = 0;
+#endif
+
+// ==================== HELPER FUNCTIONS ====================
+
+/**
+ * @brief Reads this ESP32's MAC address once into deviceMac/deviceMacStr
+ *
+ * The MAC never changes at runtime, so the sampling and send paths use the
+ * cached copies instead of re-reading and re-formatting it every cycle.
+ */
+void cacheDeviceMac() {
+  esp_read_mac(deviceMac, ESP_MAC_WIFI_STA);
+  snprintf(deviceMacStr, sizeof(deviceMacStr), "%02X:%02X:%02X:%02X:%02X:%02X",
+           deviceMac[0], deviceMac[1], deviceMac[2],
+           deviceMac[3], deviceMac[4], deviceMac[5]);
+}
+
+/**
+ * @brief Reads all sensors into a new reading and publishes it to latestSample
+ *
+ * Callers work on the returned copy; other tasks read latestSample, so no
+ * one ever sees a half-updated record.
+ *
+ * @param watch Anomaly watch between reports: reads the gas watch window
+ *              (since the previous check) instead of taking the report
+ *              window, so the reported mq_value still covers the whole
+ *              interval, and logs nothing
+ */
+sensor_data readSensors(bool watch = false) {
+  BENCH_SCOPE(BENCH_READ);
+  
+  // Starts from the previous reading, which failed sensors keep
+  sensor_data reading = latestSample.load();
+  
+  // Pick up the latest DHT22 sample produced in the background by dht.poll()
+  float temp, hum;
+  
+  // Check if DHT reading failed (no valid sample yet, or stale)
+  if (!dht.read(temp, hum)) {
+    if (!watch) LOG_WARN("⚠️  DHT22 Read Failed! Using previous values or defaults.\n");
+    // Keep previous values if available, otherwise use defaults
+    if (reading.temperature == 0.0) {
+      reading.temperature = 25.0;  // Default room temperature
+      reading.humidity = 50.0;      // Default humidity
+    }
+  } else {
+    reading.temperature = temp;
+    reading.humidity = hum;
+  }
+  
+  // Read MQ Gas Sensor (0-4095 for 12-bit ADC)
+  int mqRaw;
+  if (mqAdc.running()) {
+    // Mean of every DMA conversion since the previous reading (of this kind)
+    mq_window watched;
+    if (watch ? mqAdc.takeWatchWindow(watched) : mqAdc.takeWindow(mqWindow)) {
+      mqRaw = watch ? watched.meanRaw : mqWindow.meanRaw;
+    } else {
+      mqRaw = reading.mq_value;  // No conversions completed yet, keep previous
+    }
+  } else {
+    mqRaw = analogRead(MQ_PIN);
+  }
+  
+  // Validate ADC reading
+  if (mqRaw < 0 || mqRaw > 4095) {
+    LOG_WARN("⚠️  Invalid MQ sensor reading!\n");
+    reading.mq_value = 0;
+  } else {
+    reading.mq_value = mqRaw;
+  }
+  
+#if MAX30102_ENABLED
+  // Heart rate and SpO2 computed from the FIFO stream drained by oximeter.poll()
+  float heartRate, spo2;
+  if (oximeter.read(heartRate, spo2)) {
+    reading.heartRate = heartRate;
+    reading.spo2 = spo2;
+  } else {
+    reading.heartRate = 0.0;  // No finger, no recent beat, or no sensor
+    reading.spo2 = 0.0;
+  }
+#else
+  // Simulated Heart Rate and SpO2
+  // Realistic ranges: Heart Rate (60-100 bpm), SpO2 (95-100%)
+  reading.heartRate = 72.0 + (random(-10, 11) / 2.0);  // 67-77 bpm range
+  reading.spo2 = 97.5 + (random(-5, 6) / 2.0);         // 95-100% range
+  
+  // Clamp SpO2 to realistic range
+  if (reading.spo2 > 100.0) reading.spo2 = 100.0;
+  if (reading.spo2 < 90.0) reading.spo2 = 90.0;
+#endif
+  
+  // Add timestamp
+  reading.timestamp = millis();
+  
+  latestSample.store(reading);
+  if (watch) return reading;
+  
+  // Print readings to Serial Monitor (compiled out below LOG_LEVEL_DEBUG)
+  LOG_RECORD(LOG_LEVEL_DEBUG, LOG_EVT_SAMPLE, (int32_t)(reading.temperature * 100), reading.mq_value);
+  LOG_DEBUG("\n========== SENSOR READINGS ==========\n");
+  float value[FRAME_FIELD_COUNT];
+  SampleLayout::values(reading, value);
+  for (int i = 0; i < FRAME_FIELD_COUNT; i++) {
+    LOG_DEBUG("%s: %.*f %s\n", SampleLayout::label(i), SampleLayout::precision(i), value[i],
+              SampleLayout::unit(i));
+  }
+  if (mqAdc.running() && mqWindow.count > 0) {
+    LOG_DEBUG("🌫️  Gas window  : min %u / max %u over %lu samples, %d mV\n",
+                  mqWindow.minRaw, mqWindow.maxRaw, (unsigned long)mqWindow.count, mqWindow.meanMv);
+  }
+  LOG_DEBUG("📱 MAC Address : %s\n", deviceMacStr);
+  LOG_DEBUG("⏱️  Timestamp   : %lu ms\n", reading.timestamp);
+  LOG_DEBUG("=====================================\n");
+  return reading;
+}
+
+/**
+ * @brief Whether any channel differs from the reference reading by its deadband or more
+ */
+bool outsideDeadband(const sensor_data &s, const sensor_data &ref) {
+  return fabsf(s.temperature - ref.temperature) >= DEADBAND_TEMP ||
+         fabsf(s.humidity - ref.humidity) >= DEADBAND_HUM ||
+         abs(s.mq_value - ref.mq_value) >= DEADBAND_MQ ||
+         fabsf(s.heartRate - ref.heartRate) >= DEADBAND_HR ||
+         fabsf(s.spo2 - ref.spo2) >= DEADBAND_SPO2;
+}
+
+/**
+ * @brief Decide whether a reading just taken by readSensors() gets reported
+ *
+ * Always true unless DEADBAND_MODE is set. A true result makes the reading the
+ * new deadband reference, so call it once per reading, right where the reading
+ * would be sent or buffered. Silence is summed from the reading intervals rather
+ * than millis() so the heartbeat also works across deep sleep, and follows an
+ * interval stretched by ADAPTIVE_INTERVAL or the gateway.
+ */
+bool reportDue(const sensor_data &reading) {
+#if DEADBAND_MODE
+  const unsigned long interval = BATCH_MODE ? SAMPLE_INTERVAL : reportInterval();
+  bool due = !haveReported || outsideDeadband(reading, lastReported) ||
+             silentMs + interval >= DEADBAND_HEARTBEAT_MS;
+  
+  if (!due) {
+    silentMs += interval;
+    LOG_DEBUG("💤 Within deadband, not reporting (%lu s silent)\n", (unsigned long)(silentMs / 1000));
+    return false;
+  }
+  
+  lastReported = reading;
+  haveReported = true;
+  silentMs = 0;
+#endif
+  return true;
+}
+
+/**
+ * @brief Current reporting period: the send interval, or the batch flush timeout in BATCH_MODE
+ *
+ * Either one can be replaced by the gateway (CONFIG_REPORT_INTERVAL).
+ */
+unsigned long reportInterval() {
+#if ADAPTIVE_INTERVAL
+  return reportScheduler.interval();
+#else
+  return baseReportInterval;
+#endif
+}
+
+/**
+ * @brief Feed one reporting cycle to the adaptive scheduler (no-op unless ADAPTIVE_INTERVAL)
+ * @param latest Newest reading of the cycle, compared against the previous cycle's
+ *
+ * Delivery results are taken as the change in successCount/failureCount, so
+ * this only needs to run in the context that schedules, not the radio's.
+ */
+void adaptReportInterval(const sensor_data &latest) {
+#if ADAPTIVE_INTERVAL
+  bool changed = outsideDeadband(latest, lastCycleSample);
+  lastCycleSample = latest;
+  
+  uint32_t success = successCount.load(std::memory_order_relaxed);
+  uint32_t failure = failureCount.load(std::memory_order_relaxed);
+  unsigned long before = reportScheduler.interval();
+  unsigned long after = reportScheduler.next(success - lastCycleSuccess, failure - lastCycleFailure, changed);
+  lastCycleSuccess = success;
+  lastCycleFailure = failure;
+  
+  if (after != before) {
+    LOG_DEBUG("⏱️  Report interval %lu -> %lu ms (failure rate %ld‰%s)\n", before, after,
+              (long)reportScheduler.failRate(), changed ? ", readings moving" : "");
+  }
+#endif
+}
+
+/**
+ * @brief Make an interval set by the gateway the base of the report schedule
+ *
+ * Call from the context that schedules reports; in PIPELINE_MODE radioTask
+ * hands it over through pendingReportInterval instead.
+ */
+void setBaseReportInterval(uint32_t interval) {
+  baseReportInterval = interval;
+#if ADAPTIVE_INTERVAL
+  reportScheduler.setBase(interval);
+#endif
+}
+
+/**
+ * @brief Time of the next report: one interval on, in this node's slot, plus jitter
+ *
+ * Applies any slot assignment or interval received from the gateway first. Jitter comes
+ * from the hardware RNG, so identically flashed nodes still diverge.
+ */
+unsigned long scheduleNextReport(unsigned long now) {
+  slot_event assigned;
+  while (slotRing.pop(assigned)) {
+    sendSchedule.assign(assigned.slot, assigned.slots, assigned.epochMs);
+    LOG_INFO("🕐 Gateway assigned slot %u/%u\n", sendSchedule.slot(), sendSchedule.slots());
+  }
+#if REMOTE_CONTROL && PIPELINE_MODE
+  uint32_t interval = pendingReportInterval.exchange(0, std::memory_order_acq_rel);
+  if (interval != 0) setBaseReportInterval(interval);
+#endif
+  
+  return sendSchedule.next(now, reportInterval(), esp_random());
+}
+
+/**
+ * @brief Start the report schedule (the first report waits a full interval)
+ */
+void initReportSchedule() {
+  sendSchedule.assign(ReportSchedule::macSlot(deviceMac, TDMA_SLOTS), TDMA_SLOTS, 0);
+  nextReportTime = scheduleNextReport(millis());
+  if (TDMA_MODE) {
+    LOG_INFO("🕐 Reporting in slot %u/%u\n", sendSchedule.slot(), sendSchedule.slots());
+  }
+}
+
+/**
+ * @brief Whether the next report is due; if so, schedules the one after it
+ */
+bool reportSlotDue(unsigned long now) {
+  if ((long)(now - nextReportTime) < 0) return false;
+  nextReportTime = scheduleNextReport(now);
+  return true;
+}
+
+/**
+ * @brief Configure the MQ sensor ADC and start background oversampling
+ */
+void initMqSensor() {
+  // Configure MQ sensor pin
+  pinMode(MQ_PIN, INPUT);
+  
+  // Configure ADC resolution (12-bit by default)
+  analogReadResolution(12);
+  analogSetAttenuation(ADC_11db);  // Full range: 0-3.3V
+  
+#if MQ_CONTINUOUS_ADC
+  if (!mqAdc.begin(MQ_PIN)) {
+    LOG_WARN("⚠️  Continuous ADC failed to start, using analogRead()\n");
+  }
+#endif
+}
+
+/**
+ * @brief Start the MAX30102 on the I2C bus; its FIFO then fills in the background
+ */
+void initPulseOximeter() {
+#if MAX30102_ENABLED
+  Wire.begin(I2C_SDA_PIN, I2C_SCL_PIN, I2C_CLOCK_HZ);
+  if (oximeter.begin(Wire, MAX30102_INT_PIN)) {
+    LOG_INFO("✅ MAX30102 Initialized (%d Hz, FIFO on GPIO%d)\n",
+             MAX30102_SAMPLE_RATE_HZ, MAX30102_INT_PIN);
+  } else {
+    LOG_WARN("⚠️  MAX30102 not found! Heart rate and SpO2 will read 0.\n");
+  }
+#endif
+}
+
+// ==================== HEALTH TELEMETRY ====================
+
+/**
+ * @brief Whether the next data frame should carry a health trailer
+ *
+ * Encoder context only (loop(), or encodeTask in PIPELINE_MODE).
+ */
+bool healthDue() {
+#if !HEALTH_TRAILER
+  return false;
+#elif DEEP_SLEEP_MODE
+  return !healthSent && bootCount % HEALTH_REPORT_CYCLES == 0;
+#else
+  return millis() - lastHealthMs >= HEALTH_INTERVAL_MS;
+#endif
+}
+
+/**
+ * @brief Append a health trailer to an encoded data frame if one is due
+ * @param len Frame buffer capacity
+ * @return New frame length (unchanged if not due or no room)
+ */
+size_t appendHealth(uint8_t *frame, size_t frameLen, size_t len) {
+  if (!healthDue()) return frameLen;
+  
+  health_record h;
+  health.snapshot(h, successCount.load(std::memory_order_relaxed),
+                  failureCount.load(std::memory_order_relaxed), esp_get_free_heap_size(),
+                  healthBaseline);
+  size_t newLen = appendHealthTrailer(frame, frameLen, len, h);
+  if (newLen != frameLen) {
+    lastHealthMs = millis();
+    healthSent = true;
+    LOG_DEBUG("🩺 Health: %lu ok / %lu failed, %u%% acked, %u queued, %d dBm\n",
+              (unsigned long)h.acked, (unsigned long)h.failed, h.ackRate, h.queueDepth, h.rssi);
+  }
+  return newLen;
+}
+
+// ==================== POWER MANAGEMENT ====================
+
+/**
+ * @brief Hold the full CPU clock while this task works (pair with cpuIdle())
+ */
+void cpuBusy() {
+#if POWER_SAVE_MODE && CONFIG_PM_ENABLE
+  if (cpuLock) esp_pm_lock_acquire(cpuLock);
+#endif
+}
+
+/**
+ * @brief Let the clock scale down (and the chip light-sleep) before blocking
+ */
+void cpuIdle() {
+#if POWER_SAVE_MODE && CONFIG_PM_ENABLE
+  if (cpuLock) esp_pm_lock_release(cpuLock);
+#endif
+}
+
+/**
+ * @brief Keep light sleep off while a DHT22 conversion is running
+ *
+ * The start pulse timer and the edge capture need the chip awake; the
+ * conversion takes a few milliseconds every DHT22_MIN_INTERVAL_MS. Call
+ * right after dht.poll(), from the same context.
+ */
+void holdAwakeForSensors() {
+#if POWER_SAVE_MODE && CONFIG_PM_ENABLE
+  bool busy = dht.busy();
+  if (!sensorLock || busy == sensorLockHeld) return;
+  if (busy) {
+    esp_pm_lock_acquire(sensorLock);
+  } else {
+    esp_pm_lock_release(sensorLock);
+  }
+  sensorLockHeld = busy;
+#endif
+}
+
+/**
+ * @brief Enable clock scaling and automatic light sleep
+ *
+ * Takes the full-clock lock for the rest of setup(), which releases it when
+ * done. The MAX30102 needs no wake source of its own: its INT line stays
+ * low until the FIFO is drained, and the loop's timer wakes come well
+ * within the FIFO's 320 ms of headroom.
+ */
+void initPowerSave() {
+#if POWER_SAVE_MODE && CONFIG_PM_ENABLE
+  esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "busy", &cpuLock);
+  esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "dht22", &sensorLock);
+  cpuBusy();
+  
+  esp_pm_config_t pm = {};
+  pm.max_freq_mhz = POWER_MAX_CPU_MHZ;
+  pm.min_freq_mhz = POWER_MIN_CPU_MHZ;
+  pm.light_sleep_enable = POWER_LIGHT_SLEEP;
+  esp_err_t err = esp_pm_configure(&pm);
+  if (err == ESP_ERR_NOT_SUPPORTED && pm.light_sleep_enable) {
+    LOG_WARN("⚠️  Core built without tickless idle, scaling the clock only\n");
+    pm.light_sleep_enable = false;
+    err = esp_pm_configure(&pm);
+  }
+  if (err != ESP_OK) {
+    LOG_ERROR("❌ Power management setup failed! Error: 0x%X\n", err);
+    return;
+  }
+  
+  LOG_INFO("✅ Power Save: %d-%d MHz%s\n", POWER_MIN_CPU_MHZ, POWER_MAX_CPU_MHZ,
+           pm.light_sleep_enable ? ", light sleep when idle" : "");
+  if (pm.light_sleep_enable && mqAdc.running()) {
+    LOG_WARN("⚠️  Continuous MQ ADC holds the APB clock: no light sleep while it runs\n");
+  }
+#elif POWER_SAVE_MODE
+  LOG_WARN("⚠️  POWER_SAVE_MODE needs CONFIG_PM_ENABLE, running at full clock\n");
+#endif
+}
+
+/**
+ * @brief Put the radio into modem sleep with a periodic ESP-NOW listen window
+ *
+ * ESP-NOW needs no association to keep, so the node stays paired through
+ * modem sleep. Sends wake the radio on demand; gateway frames (beacons,
+ * slot assignments) are heard inside the wake windows.
+ */
+void configureModemSleep() {
+#if POWER_SAVE_MODE
+  esp_wifi_set_ps(WIFI_PS_MIN_MODEM);
+  esp_now_set_wake_window(ESPNOW_WAKE_WINDOW_MS);
+  esp_wifi_connectionless_module_set_wake_interval(ESPNOW_WAKE_INTERVAL_MS);
+#endif
+}
+
+// ==================== ENCRYPTION ====================
+
+/**
+ * @brief Derive this node's ESP-NOW LMK and seal key from the fleet key
+ */
+void initCrypto() {
+  const uint8_t *fleetKey = (const uint8_t *)FLEET_KEY;
+#if ENCRYPTION_MODE
+  if (!frameDeriveKey(fleetKey, "lmk", deviceMac, peerLmk) ||
+      !frameDeriveKey(fleetKey, "seal", deviceMac, sealKey)) {
+    LOG_ERROR("❌ Key derivation failed\n");
+  }
+#endif
+#if REMOTE_CONTROL
+  if (!frameDeriveKey(fleetKey, "ctrl", deviceMac, controlKey) ||
+      !frameDeriveFleetKey(fleetKey, "chunk", chunkKey)) {
+    LOG_ERROR("❌ Control key derivation failed\n");
+  }
+#endif
+  (void)fleetKey;
+}
+
+#if ENCRYPTION_MODE == 2
+Preferences cryptoPrefs;
+
+/**
+ * @brief Reserve the next SEAL_COUNTER_BLOCK nonce counters in NVS
+ *
+ * The reservation is written before any counter in it is used, so a reset
+ * or power loss skips the rest of a block but never repeats a counter. RTC
+ * memory carries the position through deep sleep.
+ */
+bool reserveSealCounters() {
+  cryptoPrefs.begin("crypto", false);
+  if (sealReserved == 0) {
+    sealCounter = cryptoPrefs.getUInt("seal", 0);  // Power-up: continue after the last block
+  }
+  uint32_t next = sealCounter + SEAL_COUNTER_BLOCK;
+  bool ok = next > sealCounter && cryptoPrefs.putUInt("seal", next) == sizeof(uint32_t);
+  cryptoPrefs.end();
+  
+  if (!ok) {
+    LOG_ERROR("❌ Could not reserve encryption counters, not sending\n");
+    return false;
+  }
+  sealReserved = next;
+  return true;
+}
+#endif
+
+/**
+ * @brief Put a plain frame into the send window, sealing it first in ENCRYPTION_MODE 2
+ * @param frameLen At most FRAME_PAYLOAD_MAX
+ * @param urgent Send it before the frames already pending
+ * @param records Flash log records in the frame, LIVE_FRAME_TAG for live
+ *                readings, 0 for anything else
+ * @return false if the window is full or the frame could not be sealed
+ */
+bool enqueueFrame(const uint8_t *frame, size_t frameLen, bool urgent = false, uint8_t records = 0) {
+#if ENCRYPTION_MODE == 2
+  if (sendWindow.freeSlots() == 0) return false;  // Don't spend a counter on it
+  if (sealCounter >= sealReserved && !reserveSealCounters()) return false;
+  
+  uint8_t sealed[FRAME_MAX_SIZE];
+  size_t sealedLen = sealFrame(sealKey, sealCounter, frame, frameLen, sealed, sizeof(sealed));
+  if (sealedLen == 0) {
+    LOG_ERROR("❌ Sealing a %u-byte frame failed\n", (unsigned)frameLen);
+    return false;
+  }
+  sealCounter++;
+  return sendWindow.enqueue(sealed, sealedLen, urgent, records);
+#else
+  return sendWindow.enqueue(frame, frameLen, urgent, records);
+#endif
+}
+
+// ==================== ESP-NOW FUNCTIONS ====================
+
+/**
+ * @brief Callback function when data is sent via ESP-NOW
+ *
+ * Runs in the Wi-Fi task: only records the outcome. Counting, logging and
+ * any reconnection happen in processSendStatus()/serviceLinkRecovery().
+ */
+void OnDataSent(const uint8_t *mac_addr, esp_now_send_status_t status) {
+  send_status_event event;
+  event.success = status == ESP_NOW_SEND_SUCCESS;
+  memcpy(event.mac, mac_addr, 6);
+  event.timeUs = esp_timer_get_time();
+  if (!ackRing.push(event)) {
+    ackRingOverflows.fetch_add(1, std::memory_order_relaxed);
+  }
+  
+#if PIPELINE_MODE
+  // A window slot just freed up: let the radio task send the next frame
+  if (radioTaskHandle != nullptr) {
+    xTaskNotifyGive(radioTaskHandle);
+  }
+#endif
+}
+
+/**
+ * @brief Callback when ESP-NOW data is received (runs in the Wi-Fi task)
+ *
+ * Beacons are queued for scanForGateway(); for everything else only the
+ * RSSI is used, to rate known receivers.
+ */
+void OnDataRecv(const esp_now_recv_info_t *info, const uint8_t *data, int len) {
+  frame_header hdr;
+  uint8_t channel;
+  if (decodeBeaconFrame(data, len, hdr, channel)) {
+    beacon_event beacon;
+    memcpy(beacon.mac, info->src_addr, 6);
+    beacon.rssi = (int8_t)info->rx_ctrl->rssi;
+    memcpy(beacon.frame, data, FRAME_BEACON_SIZE);
+    beaconRing.push(beacon);
+  }
+  
+  uint8_t slot, slots;
+  uint16_t phaseMs;
+  if (TDMA_MODE && decodeSlotFrame(data, len, hdr, slot, slots, phaseMs)) {
+    slot_event assigned = {slot, slots, millis() - phaseMs};
+    slotRing.push(assigned);
+  }
+  
+#if REMOTE_CONTROL
+  // Checked and applied by serviceControl(), outside the Wi-Fi task
+  if (len <= FRAME_MAX_SIZE && decodeFrameHeader(data, len, hdr) &&
+      (hdr.type == FRAME_CONFIG || hdr.type == FRAME_OTA_OFFER ||
+       (hdr.type == FRAME_OTA_CHUNK && otaReceiving.load(std::memory_order_relaxed)))) {
+    control_frame *frame = controlRing.claim();
+    if (frame == nullptr) {
+      controlRingOverflows.fetch_add(1, std::memory_order_relaxed);  // A later round resends it
+    } else {
+      memcpy(frame->mac, info->src_addr, 6);
+      frame->len = (uint8_t)len;
+      memcpy(frame->data, data, len);
+      controlRing.commit();
+#if PIPELINE_MODE
+      if (radioTaskHandle != nullptr) {
+        xTaskNotifyGive(radioTaskHandle);
+      }
+#endif
+    }
+  }
+#endif
+  
+  peer_rssi_event event;
+  memcpy(event.mac, info->src_addr, 6);
+  event.rssi = (int8_t)info->rx_ctrl->rssi;
+  rssiRing.push(event);  // Dropped if full: RSSI is only a hint
+}
+
+/**
+ * @brief Hand over to the recovery state machine once the link looks dead
+ *
+ * Failed deliveries and rejected sends both count towards the threshold.
+ */
+void checkLinkFailures() {
+  if (consecutiveFailures >= RECOVERY_FAILURE_THRESHOLD && linkState == LINK_UP) {
+    LOG_EVENT(LOG_LEVEL_WARN, LOG_EVT_LINK_RESTART, consecutiveFailures, 0,
+              "⚠️  %d failures in a row. Scheduling ESP-NOW restart...\n", consecutiveFailures);
+    linkState = LINK_RESTART;
+  }
+}
+
+/**
+ * @brief Drain delivery reports queued by OnDataSent and update link health
+ */
+void processSendStatus() {
+  peer_rssi_event heard;
+  while (rssiRing.pop(heard)) {
+    int idx = peers.find(heard.mac);
+    if (idx >= 0) peers.onRssi(idx, heard.rssi);
+  }
+  health.publishRssi(peers.rssi(peers.active()));
+  
+  send_status_event event;
+  while (ackRing.pop(event)) {
+    BENCH_SCOPE(BENCH_ACK);
+#if BENCHMARK_MODE
+    bench.onAck(event.success, event.timeUs);
+#endif
+    send_result result = sendWindow.onAck(event.success);
+    if (result == SEND_UNKNOWN) continue;  // Late report for a frame already resent
+    
+    int idx = peers.find(event.mac);
+    if (idx >= 0) peers.onDelivery(idx, event.success);
+    
+    if (event.success) {
+      uint32_t success = successCount.fetch_add(1, std::memory_order_relaxed) + 1;
+      uint32_t failure = failureCount.load(std::memory_order_relaxed);
+      consecutiveFailures = 0;
+      restartsSinceDelivery = 0;
+      LOG_EVENT(LOG_LEVEL_DEBUG, LOG_EVT_DELIVERY_OK, success, failure,
+                "\n📤 Send Status: ✅ Delivery Success\n   Total Success: %lu | Failures: %lu\n",
+                (unsigned long)success, (unsigned long)failure);
+    } else {
+      uint32_t success = successCount.load(std::memory_order_relaxed);
+      uint32_t failure = failureCount.fetch_add(1, std::memory_order_relaxed) + 1;
+      consecutiveFailures++;
+      LOG_EVENT(LOG_LEVEL_WARN, LOG_EVT_DELIVERY_FAIL, success, failure,
+                "\n📤 Send Status: ❌ Delivery Failed\n   Total Success: %lu | Failures: %lu\n",
+                (unsigned long)success, (unsigned long)failure);
+      if (result == SEND_RETRY) {
+        LOG_DEBUG("   Retransmitting (%u queued)\n", (unsigned)sendWindow.pending());
+      } else if (result == SEND_DROPPED) {
+        LOG_WARN("   Out of retries, frame dropped\n");
+      }
+    }
+    
+    checkLinkFailures();
+  }
+  
+  // Callbacks lost (e.g. across an ESP-NOW restart) must not stall the window
+  size_t expired = sendWindow.expire(millis(), SEND_ACK_TIMEOUT_MS);
+  if (expired > 0) {
+#if BENCHMARK_MODE
+    bench.onAcksLost();
+#endif
+    LOG_WARN("⚠️  %u frames got no delivery callback, resending\n", (unsigned)expired);
+  }
+  
+#if STORE_FORWARD
+  // Stored batches settle with the flash log's owner, dropped live frames go to it
+  stored_settle_event settled;
+  const uint8_t *frame;
+  size_t frameLen;
+  while (sendWindow.popSettled(settled.records, settled.acked, &frame, &frameLen)) {
+    if (settled.records != LIVE_FRAME_TAG) {
+      storedSettleRing.push(settled);
+    } else if (!settled.acked) {
+      keepDroppedFrame(frame, frameLen);
+    }
+  }
+#endif
+  
+  pumpSendWindow();
+  health.publishWindow(sendWindow.pending() + sendWindow.inFlight(),
+                       sendWindow.retransmits(), sendWindow.dropped());
+}
+
+/**
+ * @brief Non-blocking ESP-NOW recovery with exponential backoff
+ *
+ * Call regularly from the context that owns the radio (loop() or radioTask).
+ */
+void serviceLinkRecovery() {
+  switch (linkState) {
+    case LINK_UP:
+      break;
+    
+    case LINK_RESTART:
+      espNowConnected.store(false, std::memory_order_relaxed);
+      esp_now_deinit();
+      sendWindow.requeueInFlight();  // No callbacks will come for these
+      restartsSinceDelivery++;
+      nextRecoveryMs = millis() + recoveryBackoffMs;
+      linkState = LINK_BACKOFF;
+      break;
+    
+    case LINK_BACKOFF:
+      if ((long)(millis() - nextRecoveryMs) < 0) break;
+      
+#if AUTO_PAIRING
+      // Restarts alone haven't helped: the gateway may have changed channel
+      if (restartsSinceDelivery >= RESCAN_AFTER_RESTARTS) {
+        scanForGateway();
+        restartsSinceDelivery = 0;
+      }
+#endif
+      
+      if (initESPNow()) {
+        LOG_EVENT(LOG_LEVEL_INFO, LOG_EVT_LINK_RECOVERED, recoveryBackoffMs, 0,
+                  "✅ ESP-NOW link recovered\n");
+        consecutiveFailures = 0;
+        recoveryBackoffMs = RECOVERY_BACKOFF_MIN_MS;
+        linkState = LINK_UP;
+        pumpSendWindow();
+      } else {
+        esp_now_deinit();
+        recoveryBackoffMs *= 2;
+        if (recoveryBackoffMs > RECOVERY_BACKOFF_MAX_MS) recoveryBackoffMs = RECOVERY_BACKOFF_MAX_MS;
+        nextRecoveryMs = millis() + recoveryBackoffMs;
+        LOG_WARN("⏳ Recovery failed, next attempt in %lu ms\n", recoveryBackoffMs);
+      }
+      break;
+  }
+}
+
+/**
+ * @brief Fill the peer table from the configured receiver addresses
+ */
+void initPeers() {
+  for (size_t i = 0; i < sizeof(serverAddresses) / sizeof(serverAddresses[0]); i++) {
+    if (peers.add(serverAddresses[i]) < 0) {
+      LOG_WARN("⚠️  Peer table full, ignoring receiver %u\n", (unsigned)i);
+    }
+  }
+}
+
+/**
+ * @brief Register one ESP-NOW peer on the current channel
+ * @param replace Remove a stale registration first (not needed after a fresh init)
+ */
+esp_err_t addPeer(const uint8_t *mac, bool replace) {
+  esp_now_peer_info_t peerInfo;
+  memset(&peerInfo, 0, sizeof(peerInfo));
+  memcpy(peerInfo.peer_addr, mac, 6);
+  peerInfo.channel = wifiChannel;  // Must match the radio channel
+#if ENCRYPTION_MODE == 1
+  // CCMP in the Wi-Fi MAC; the gateway registers this node with the same LMK
+  peerInfo.encrypt = true;
+  memcpy(peerInfo.lmk, peerLmk, FRAME_KEY_SIZE);
+#else
+  peerInfo.encrypt = false;
+#endif
+  peerInfo.ifidx = WIFI_IF_STA;
+  
+  // Check if peer already exists
+  if (replace && esp_now_is_peer_exist(mac)) {
+    LOG_WARN("⚠️  Peer already exists, removing...\n");
+    esp_now_del_peer(mac);
+    delay(100);
+  }
+  
+  return esp_now_add_peer(&peerInfo);
+}
+
+/**
+ * @brief Register every receiver in the peer table (or the broadcast address)
+ */
+esp_err_t addPeers(bool replace) {
+#if ENCRYPTION_MODE == 1
+  esp_err_t pmkResult = esp_now_set_pmk((const uint8_t *)FLEET_PMK);
+  if (pmkResult != ESP_OK) return pmkResult;
+#endif
+  
+  if (PEER_BROADCAST) {
+    return addPeer(broadcastAddress, replace);
+  }
+  
+  for (size_t i = 0; i < peers.size(); i++) {
+    esp_err_t result = addPeer(peers.mac(i), replace);
+    if (result != ESP_OK) return result;
+  }
+  return ESP_OK;
+}
+
+// ==================== PAIRING ====================
+
+#if AUTO_PAIRING
+Preferences pairingPrefs;
+
+/**
+ * @brief Load the gateway and channel found by an earlier scan from NVS
+ * @return false if nothing valid is cached
+ */
+bool loadPairing() {
+  uint8_t mac[6];
+  pairingPrefs.begin("pairing", true);
+  uint8_t channel = pairingPrefs.getUChar("channel", 0);
+  size_t macLen = pairingPrefs.getBytes("gateway", mac, sizeof(mac));
+  pairingPrefs.end();
+  
+  if (channel < 1 || channel > SCAN_CHANNEL_MAX || macLen != sizeof(mac)) return false;
+  
+  int idx = peers.add(mac);
+  if (idx < 0) return false;
+  peers.setActive(idx);
+  wifiChannel = channel;
+  LOG_INFO("✅ Paired gateway %02X:%02X:%02X:%02X:%02X:%02X on channel %u (from NVS)\n",
+           mac[0], mac[1], mac[2], mac[3], mac[4], mac[5], channel);
+  return true;
+}
+
+/**
+ * @brief Cache the gateway and channel in NVS (skipped if unchanged, to spare flash)
+ */
+void savePairing(const uint8_t *mac, uint8_t channel) {
+  uint8_t stored[6];
+  pairingPrefs.begin("pairing", false);
+  if (pairingPrefs.getUChar("channel", 0) != channel ||
+      pairingPrefs.getBytes("gateway", stored, sizeof(stored)) != sizeof(stored) ||
+      memcmp(stored, mac, 6) != 0) {
+    pairingPrefs.putUChar("channel", channel);
+    pairingPrefs.putBytes("gateway", mac, 6);
+  }
+  pairingPrefs.end();
+}
+
+/**
+ * @brief Find a gateway by broadcasting FRAME_DISCOVER on each channel in turn
+ *
+ * Blocks for up to SCAN_CHANNEL_MAX * SCAN_DWELL_MS and leaves ESP-NOW
+ * deinitialized; call initESPNow() afterwards. Every gateway answering on the
+ * first channel that gets a reply joins the peer table, the strongest one
+ * becomes active. Only beacons tagged for this probe's nonce count, so a
+ * device without the fleet key cannot pair the node to itself. Must not run
+ * with frames in flight: the discovery broadcasts would be credited to them.
+ *
+ * @return false if no gateway answered (wifiChannel is left unchanged)
+ */
+bool scanForGateway() {
+  LOG_INFO("\n🔍 Scanning channels 1-%d for a gateway...\n", SCAN_CHANNEL_MAX);
+  
+  WiFi.mode(WIFI_STA);
+  WiFi.disconnect();
+#if POWER_SAVE_MODE
+  esp_wifi_set_ps(WIFI_PS_NONE);  // Listen through the whole dwell on every channel
+#endif
+  if (esp_now_init() != ESP_OK) return false;
+  esp_now_register_recv_cb(OnDataRecv);
+  
+  esp_now_peer_info_t peerInfo;
+  memset(&peerInfo, 0, sizeof(peerInfo));
+  memcpy(peerInfo.peer_addr, broadcastAddress, 6);
+  peerInfo.channel = 0;  // Follow the radio across the scan
+  peerInfo.ifidx = WIFI_IF_STA;
+  esp_now_add_peer(&peerInfo);
+  
+  uint8_t probe[FRAME_HEADER_SIZE];
+  uint32_t nonce = esp_random();
+  encodeFrameHeader(probe, FRAME_DISCOVER, deviceMac, 0, nonce);
+  
+  beacon_event best;
+  bool found = false;
+  uint8_t foundChannel = 0;
+  for (uint8_t channel = 1; channel <= SCAN_CHANNEL_MAX && !found; channel++) {
+    esp_wifi_set_promiscuous(true);
+    esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE);
+    esp_wifi_set_promiscuous(false);
+    esp_now_send(broadcastAddress, probe, sizeof(probe));
+    
+    unsigned long start = millis();
+    while (millis() - start < SCAN_DWELL_MS) {
+      delay(1);
+      beacon_event beacon;
+      while (beaconRing.pop(beacon)) {
+        uint8_t key[FRAME_KEY_SIZE];
+        if (!frameDeriveKey((const uint8_t *)FLEET_KEY, "bcn", beacon.mac, key) ||
+            !verifyBeaconFrame(key, beacon.frame, sizeof(beacon.frame), deviceMac, nonce)) {
+          LOG_WARN("⚠️  Beacon from %02X:%02X:%02X:%02X:%02X:%02X failed authentication, ignored\n",
+                   beacon.mac[0], beacon.mac[1], beacon.mac[2], beacon.mac[3], beacon.mac[4], beacon.mac[5]);
+          continue;
+        }
+        peers.add(beacon.mac);
+        if (!found || beacon.rssi > best.rssi) best = beacon;
+        found = true;
+        foundChannel = channel;  // Where we heard it; the beacon's own field is informational
+      }
+    }
+  }
+  esp_now_deinit();
+  
+  if (!found) {
+    LOG_WARN("⚠️  No gateway answered, staying on channel %d\n", wifiChannel);
+    return false;
+  }
+  
+  int idx = peers.find(best.mac);
+  if (idx >= 0) peers.setActive(idx);
+  wifiChannel = foundChannel;
+  savePairing(best.mac, foundChannel);
+  LOG_INFO("✅ Found gateway %02X:%02X:%02X:%02X:%02X:%02X on channel %u (RSSI %d)\n",
+           best.mac[0], best.mac[1], best.mac[2], best.mac[3], best.mac[4], best.mac[5],
+           foundChannel, best.rssi);
+  return true;
+}
+#endif
+
+/**
+ * @brief Initialize ESP-NOW protocol
+ */
+bool initESPNow() {
+  // Set device as Wi-Fi Station
+  WiFi.mode(WIFI_STA);
+  
+  // Disconnect from any AP first
+  WiFi.disconnect();
+  delay(100);
+  
+  // Set WiFi channel
+  esp_wifi_set_promiscuous(true);
+  esp_wifi_set_channel(wifiChannel, WIFI_SECOND_CHAN_NONE);
+  esp_wifi_set_promiscuous(false);
+  
+  LOG_INFO("\n📡 Initializing ESP-NOW...\n");
+  LOG_INFO("   WiFi Channel: %d\n", wifiChannel);
+  
+  // Initialize ESP-NOW
+  esp_err_t initResult = esp_now_init();
+  if (initResult != ESP_OK) {
+    LOG_ERROR("❌ ESP-NOW Initialization Failed! Error: 0x%X\n", initResult);
+    espNowConnected.store(false, std::memory_order_relaxed);
+    return false;
+  }
+  
+  LOG_INFO("✅ ESP-NOW Initialized Successfully\n");
+  
+  // Register send callback
+  esp_err_t callbackResult = esp_now_register_send_cb(OnDataSent);
+  if (callbackResult != ESP_OK) {
+    LOG_ERROR("❌ Failed to register send callback! Error: 0x%X\n", callbackResult);
+    return false;
+  }
+  
+  // RSSI of frames heard from the receivers feeds the peer rating
+  esp_now_register_recv_cb(OnDataRecv);
+  
+  // Register peers (receivers)
+  esp_err_t addPeerResult = addPeers(true);
+  if (addPeerResult != ESP_OK) {
+    LOG_ERROR("❌ Failed to Add Peer! Error: 0x%X\n", addPeerResult);
+    espNowConnected.store(false, std::memory_order_relaxed);
+    return false;
+  }
+  
+  espNowConnected.store(true, std::memory_order_relaxed);
+  LOG_INFO("✅ %u Peer(s) Added Successfully\n", (unsigned)peers.size());
+  saveLinkState();
+  configureModemSleep();
+  
+  // Print server MACs
+  for (size_t i = 0; i < peers.size(); i++) {
+    const uint8_t *mac = peers.mac(i);
+    LOG_INFO("   Server MAC: %02X:%02X:%02X:%02X:%02X:%02X%s\n",
+             mac[0], mac[1], mac[2], mac[3], mac[4], mac[5],
+             i == peers.active() ? " (active)" : "");
+  }
+  if (PEER_BROADCAST) {
+    LOG_INFO("   Broadcasting to all gateways in range\n");
+  }
+  
+  return true;
+}
+
+/**
+ * @brief Fast ESP-NOW bring-up for wake-from-sleep
+ *
+ * Uses the channel/peer restored from RTC memory and skips the disconnect,
+ * promiscuous channel toggle, peer cleanup and their settle delays: after a
+ * deep sleep the radio is freshly reset and the peer list is empty.
+ */
+bool initESPNowFast() {
+  WiFi.persistent(false);  // Don't rewrite Wi-Fi config to NVS on every wake
+  WiFi.mode(WIFI_STA);
+  esp_wifi_set_channel(wifiChannel, WIFI_SECOND_CHAN_NONE);
+  
+  if (esp_now_init() != ESP_OK) return false;
+  if (esp_now_register_send_cb(OnDataSent) != ESP_OK) {
+    esp_now_deinit();
+    return false;
+  }
+  
+  esp_now_register_recv_cb(OnDataRecv);
+  
+  if (addPeers(false) != ESP_OK) {
+    esp_now_deinit();
+    return false;
+  }
+  
+  espNowConnected.store(true, std::memory_order_relaxed);
+  return true;
+}
+
+/**
+ * @brief Hand pending frames to ESP-NOW while the send window allows
+ *
+ * Called after every enqueue and every batch of delivery reports.
+ */
+void pumpSendWindow() {
+  while (espNowConnected.load(std::memory_order_relaxed) && sendWindow.canSend()) {
+    size_t frameLen;
+    const uint8_t *frame = sendWindow.peekPending(frameLen);
+    const uint8_t *dest = PEER_BROADCAST ? broadcastAddress
+                                         : peers.mac(peers.select(millis(), PEER_PROBE_INTERVAL_MS));
+    esp_err_t result;
+    {
+      BENCH_SCOPE(BENCH_SEND);
+      result = esp_now_send(dest, frame, frameLen);
+    }
+    
+    if (result == ESP_OK) {
+      // Boot/wake-to-transmit latency, reported once per boot
+      if (firstPacketUs == 0) {
+        firstPacketUs = esp_timer_get_time();
+        health.setWakeMs((uint32_t)(firstPacketUs / 1000));
+      }
+#if BENCHMARK_MODE
+      bench.onSent(frameLen, esp_timer_get_time());
+#endif
+      sendWindow.markSent(millis());
+      LOG_EVENT(LOG_LEVEL_DEBUG, LOG_EVT_SEND_QUEUED, (unsigned)frameLen, 0,
+                "✅ %u-byte frame queued for transmission\n", (unsigned)frameLen);
+    } else if (result == ESP_ERR_ESPNOW_NO_MEM) {
+      // Driver TX buffer full: wait for the next delivery report
+      sendWindow.markBlocked();
+      break;
+    } else {
+      uint32_t failure = failureCount.fetch_add(1, std::memory_order_relaxed) + 1;
+      consecutiveFailures++;
+      sendWindow.onSendError();
+      LOG_EVENT(LOG_LEVEL_ERROR, LOG_EVT_SEND_ERROR, result, failure,
+                "❌ Error sending data (Error code: 0x%X)\n", result);
+      checkLinkFailures();  // A wedged driver rejects every send
+      break;
+    }
+  }
+}
+
+/**
+ * @brief Queue an encoded frame for transmission to the receiver
+ * @param urgent Send it before the frames already pending (alarms)
+ * @param records Flash log records in the frame, LIVE_FRAME_TAG for live
+ *                readings, 0 for anything else
+ * @return false if the send window has no free slot
+ */
+bool sendFrame(const uint8_t *frame, size_t frameLen, bool urgent, uint8_t records) {
+  if (!enqueueFrame(frame, frameLen, urgent, records)) {
+    LOG_WARN("⚠️  Send window full (%u in flight), frame not queued\n",
+             (unsigned)sendWindow.inFlight());
+    return false;
+  }
+  
+  pumpSendWindow();
+  return true;
+}
+
+/**
+ * @brief Send sensor data via ESP-NOW to receiver
+ * @return true if the frame was queued for transmission
+ */
+bool sendData(const sensor_data &reading) {
+#if STORE_FORWARD
+  // Keep the series in order: while a backlog exists, new readings join it
+  if (storeForwardActive()) {
+    storeForLater(reading);
+    return drainStoredBacklog() > 0;
+  }
+#endif
+  
+  if (!espNowConnected.load(std::memory_order_relaxed)) {
+    LOG_EVENT(LOG_LEVEL_WARN, LOG_EVT_SEND_SKIPPED, 1, 0,
+              "⚠️  ESP-NOW not connected! Skipping transmission...\n");
+    return false;
+  }
+  
+  // Pack the reading into the compact wire format (see sensor_frame.h)
+  uint8_t frame[FRAME_MAX_SIZE];
+  size_t frameLen;
+  {
+    BENCH_SCOPE(BENCH_ENCODE);
+    frameLen = encodeSampleFrame(frame, FRAME_PAYLOAD_MAX, deviceMac, frameSeq++, reading);
+    frameLen = appendHealth(frame, frameLen, FRAME_PAYLOAD_MAX);
+  }
+  
+  if (!sendFrame(frame, frameLen, false, LIVE_FRAME_TAG)) {
+#if STORE_FORWARD
+    storeForLater(reading);
+#endif
+    return false;
+  }
+  return true;
+}
+
+#if AGGREGATE_MODE
+/**
+ * @brief Send the statistics of the window that just closed and start the next one
+ * @return true if the frame was queued for transmission
+ */
+bool sendSummary(unsigned long now) {
+  if (aggregator.empty()) return false;
+  
+  sensor_summary summary;
+  aggregator.summarize(summary, now);
+  aggregator.reset(now);
+  
+  if (!espNowConnected.load(std::memory_order_relaxed)) {
+    LOG_EVENT(LOG_LEVEL_WARN, LOG_EVT_SEND_SKIPPED, summary.channel[0].count, 0,
+              "⚠️  ESP-NOW not connected! Skipping summary of %u readings...\n",
+              summary.channel[0].count);
+    return false;
+  }
+  
+  uint8_t frame[FRAME_MAX_SIZE];
+  size_t frameLen;
+  {
+    BENCH_SCOPE(BENCH_ENCODE);
+    frameLen = encodeSummaryFrame(frame, FRAME_PAYLOAD_MAX, deviceMac, frameSeq++, summary);
+    frameLen = appendHealth(frame, frameLen, FRAME_PAYLOAD_MAX);
+  }
+  
+  LOG_DEBUG("\n📤 Sending summary of %u readings over %lu ms (T %.2f ±%.2f °C)...\n",
+            summary.channel[0].count, (unsigned long)summary.windowMs,
+            summary.channel[0].mean, summary.channel[0].stddev);
+  return sendFrame(frame, frameLen);
+}
+#endif
+
+/**
+ * @brief Pack time-ordered samples into one batch frame with the configured codec
+ */
+size_t encodeBatch(uint8_t *frame, size_t len, uint16_t seq,
+                   const sensor_data *samples, size_t count, size_t &consumed) {
+  BENCH_SCOPE(BENCH_ENCODE);
+#if BATCH_DELTA_CODEC
+  return encodeDeltaFrame(frame, len, deviceMac, seq, samples, count, consumed);
+#else
+  return encodeBatchFrame(frame, len, deviceMac, seq, samples, count, consumed);
+#endif
+}
+
+#if BATCH_MODE || PIPELINE_MODE
+/**
+ * @brief Encode the oldest buffered samples into one batch frame
+ *
+ * Consumer side of sampleRing: samples are only peeked, the caller drops
+ * the consumed ones once the frame is safely on its way. A due health
+ * trailer takes the room of the last couple of samples.
+ */
+size_t buildBatchFrame(uint8_t *frame, size_t len, uint16_t seq, size_t &consumed) {
+  static sensor_data batch[BATCH_MAX_SAMPLES];  // Off the task stack; single caller
+  size_t count = sampleRing.size();
+  if (count > BATCH_MAX_SAMPLES) count = BATCH_MAX_SAMPLES;
+  for (size_t i = 0; i < count; i++) {
+    batch[i] = sampleRing.peek(i);
+  }
+  
+  size_t reserve = healthDue() ? FRAME_HEALTH_SIZE : 0;
+  size_t frameLen = encodeBatch(frame, len - reserve, seq, batch, count, consumed);
+  return appendHealth(frame, frameLen, len);
+}
+#endif
+
+#if BATCH_MODE && !PIPELINE_MODE
+/**
+ * @brief Send the buffered samples as one batch frame
+ *
+ * Samples stay in the ring until the frame has been queued, so a skipped or
+ * failed send keeps them for the next flush (oldest are dropped when full).
+ */
+void sendBatch() {
+  if (sampleRing.empty()) return;
+  
+  if (!espNowConnected.load(std::memory_order_relaxed)) {
+    LOG_EVENT(LOG_LEVEL_WARN, LOG_EVT_SEND_SKIPPED, (unsigned)sampleRing.size(), 0,
+              "⚠️  ESP-NOW not connected! Holding %u samples...\n", (unsigned)sampleRing.size());
+    return;
+  }
+  
+  uint8_t frame[FRAME_MAX_SIZE];
+  size_t consumed = 0;
+  size_t frameLen = buildBatchFrame(frame, FRAME_PAYLOAD_MAX, frameSeq, consumed);
+  if (frameLen == 0) return;
+  
+  LOG_DEBUG("\n📤 Sending batch of %u samples (%u bytes) to receiver...\n",
+                (unsigned)consumed, (unsigned)frameLen);
+  
+  if (sendFrame(frame, frameLen, false, LIVE_FRAME_TAG)) {
+    frameSeq++;
+    sampleRing.drop(consumed);
+  }
+}
+
+/**
+ * @brief Send the buffered samples and let the scheduler see the cycle
+ */
+void flushBatch(const sensor_data &latest) {
+  adaptReportInterval(latest);
+  sendBatch();
+  
+  // Print connection status
+  LOG_DEBUG("\n📊 Connection Status: %s\n", 
+                espNowConnected.load(std::memory_order_relaxed) ? "✅ Connected" : "❌ Disconnected");
+}
+#endif
+
+// ==================== STORE AND FORWARD ====================
+
+#if STORE_FORWARD
+/**
+ * @brief Mount the flash log, picking up readings left over from before a reboot
+ */
+void initStoreForward() {
+  if (flashLog.begin(STORE_FORWARD_PARTITION)) {
+    LOG_INFO("✅ Flash log mounted (%u stored readings pending)\n", (unsigned)flashLog.count());
+  } else {
+    LOG_WARN("⚠️  No '%s' partition, readings taken during outages will be lost\n",
+             STORE_FORWARD_PARTITION);
+  }
+}
+
+/**
+ * @brief Whether new readings should go to flash instead of the radio
+ *
+ * True while the link is down, and afterwards until the backlog has drained
+ * so the receiver still sees the readings in order. A gateway outage leaves
+ * ESP-NOW up: there, the first live frame that runs out of retries is
+ * rescued into the log and starts it.
+ */
+bool storeForwardActive() {
+  return flashLog.ready() && (!espNowConnected.load(std::memory_order_relaxed) || flashLog.count() > 0 ||
+                              !droppedFrameRing.empty());
+}
+
+/**
+ * @brief Append one reading to the flash log
+ */
+bool storeForLater(const sensor_data &sample) {
+  if (!flashLog.ready()) return false;
+  
+  if (!flashLog.append(sample)) {
+    LOG_ERROR("❌ Flash log write failed, reading lost\n");
+    return false;
+  }
+  LOG_DEBUG("💾 Reading stored for later (%u in flash log)\n", (unsigned)flashLog.count());
+  return true;
+}
+
+/**
+ * @brief Encode the oldest stored readings into one batch frame
+ *
+ * Like buildBatchFrame(), records are only peeked: the caller consumes them
+ * once the frame has been handed on.
+ */
+size_t buildStoredBatchFrame(uint8_t *frame, size_t len, uint16_t seq, size_t &consumed) {
+  static sensor_data batch[BATCH_MAX_SAMPLES];  // Off the task stack; single caller
+  size_t count = flashLog.peek(batch, BATCH_MAX_SAMPLES);
+  if (count == 0) return 0;
+  
+  return encodeBatch(frame, len, seq, batch, count, consumed);
+}
+
+/**
+ * @brief Hand a live frame that ran out of retries to the flash log's owner (radio context)
+ */
+void keepDroppedFrame(const uint8_t *frame, size_t len) {
+  dropped_frame dropped;
+#if ENCRYPTION_MODE == 2
+  uint32_t counter;
+  dropped.len = (uint8_t)openFrame(sealKey, frame, len, dropped.data, sizeof(dropped.data), counter);
+#else
+  dropped.len = (uint8_t)len;
+  memcpy(dropped.data, frame, len);
+#endif
+  if (dropped.len == 0 || !droppedFrameRing.push(dropped)) {
+    LOG_ERROR("❌ Dropped frame could not be kept, readings lost\n");
+  }
+}
+
+/**
+ * @brief Write the readings of dropped live frames to the flash log
+ */
+void storeDroppedFrames() {
+  static sensor_data samples[FRAME_DELTA_MAX_SAMPLES];  // Off the task stack; single caller
+  dropped_frame dropped;
+  while (droppedFrameRing.pop(dropped)) {
+    frame_header hdr;
+    size_t count = decodeFrameSamples(dropped.data, dropped.len, hdr, samples, FRAME_DELTA_MAX_SAMPLES);
+    for (size_t i = 0; i < count; i++) {
+      storeForLater(samples[i]);
+    }
+    LOG_WARN("⚠️  Frame dropped, %u readings kept in the flash log\n", (unsigned)count);
+  }
+}
+
+/**
+ * @brief Release stored readings whose frame was acknowledged
+ *
+ * A dropped frame leaves its readings in the log, to be sent again in a new
+ * frame. Readings in a frame still in the window when the node sleeps or
+ * reboots are sent again too: a lost ack can repeat readings, never lose them.
+ * Readings of dropped live frames join the log here as well.
+ */
+void settleStoredBatch() {
+  storeDroppedFrames();
+  stored_settle_event settled;
+  while (storedSettleRing.pop(settled)) {
+    if (settled.acked) {
+      flashLog.consume(settled.records);
+    } else {
+      LOG_WARN("⚠️  Stored batch dropped, %u readings kept for the next attempt\n", settled.records);
+    }
+    storedInFlight = 0;
+  }
+}
+
+/**
+ * @brief Send the next batch frame from the flash log once the previous one is acknowledged
+ *
+ * Called repeatedly while the link is up. Batches go one at a time because
+ * the log can only release its oldest readings.
+ * @return Number of frames queued (0 or 1)
+ */
+size_t drainStoredBacklog() {
+  settleStoredBatch();
+  if (storedInFlight > 0 || !espNowConnected.load(std::memory_order_relaxed) || flashLog.count() == 0 ||
+      sendWindow.freeSlots() == 0) {
+    return 0;
+  }
+  
+  uint8_t frame[FRAME_MAX_SIZE];
+  size_t consumed = 0;
+  size_t frameLen = buildStoredBatchFrame(frame, FRAME_PAYLOAD_MAX, frameSeq, consumed);
+  if (frameLen == 0 || !sendFrame(frame, frameLen, false, (uint8_t)consumed)) return 0;
+  
+  storedInFlight = consumed;
+  frameSeq++;
+  LOG_DEBUG("📤 Sending %u stored readings, %u in flash\n", (unsigned)consumed, (unsigned)flashLog.count());
+  return 1;
+}
+
+#if BATCH_MODE || PIPELINE_MODE
+/**
+ * @brief Move everything buffered in RAM to the flash log (consumer side of sampleRing)
+ */
+void spillSampleRing() {
+  while (!sampleRing.empty()) {
+    storeForLater(sampleRing.peek());
+    sampleRing.drop(1);
+  }
+}
+#endif
+#endif
+
+// ==================== BENCHMARK ====================
+
+#if BENCHMARK_MODE
+/**
+ * @brief Print stage timings, delivery latency, throughput and memory high-water marks
+ */
+void printBenchmark() {
+  static const char *const stageNames[BENCH_STAGE_COUNT] = {"read", "encode", "send", "ack"};
+  const float cyclesPerUs = getCpuFrequencyMhz();
+  
+  LOG_INFO("\n⏱️  ========== BENCHMARK ==========\n");
+  for (int i = 0; i < BENCH_STAGE_COUNT; i++) {
+    const bench_timing &t = bench.stage((bench_stage)i);
+    if (t.count == 0) continue;
+    LOG_INFO("   %-7s %7lu runs  avg %8.1f us  min %8.1f  max %8.1f\n", stageNames[i],
+             (unsigned long)t.count, t.totalCycles / (float)t.count / cyclesPerUs,
+             t.minCycles / cyclesPerUs, t.maxCycles / cyclesPerUs);
+  }
+  
+  uint32_t frames, bytes;
+  int64_t periodUs;
+  bench.takeWindow(esp_timer_get_time(), frames, bytes, periodUs);
+  if (!DEEP_SLEEP_MODE && periodUs > 0) {  // esp_timer restarts on every wake
+    LOG_INFO("   %.2f frames/s, %.1f bytes/s\n", frames * 1e6f / periodUs, bytes * 1e6f / periodUs);
+  }
+  LOG_INFO("   %lu frames, %llu bytes sent; %lu delivered, %lu failed\n",
+           (unsigned long)bench.frames(), (unsigned long long)bench.bytes(),
+           (unsigned long)bench.acked(), (unsigned long)bench.failed());
+  
+  LOG_INFO("   Delivery callback latency:\n");
+  for (size_t i = 0; i < BENCH_LATENCY_BUCKETS; i++) {
+    uint32_t n = bench.latencyCount(i);
+    if (n == 0) continue;
+    if (Benchmark::bucketLimitUs(i) > 0) {
+      LOG_INFO("     < %6lu us : %lu\n", (unsigned long)Benchmark::bucketLimitUs(i), (unsigned long)n);
+    } else {
+      LOG_INFO("     longer    : %lu\n", (unsigned long)n);
+    }
+  }
+  
+  LOG_INFO("   Heap %lu free, %lu lowest, %lu largest block; %lu bytes stack left\n",
+           (unsigned long)esp_get_free_heap_size(), (unsigned long)esp_get_minimum_free_heap_size(),
+           (unsigned long)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT),
+           (unsigned long)uxTaskGetStackHighWaterMark(NULL));
+  LOG_INFO("=====================================\n");
+}
+#endif
+
+/**
+ * @brief Print the benchmark summary once BENCH_REPORT_MS has passed
+ */
+void serviceBenchmark() {
+#if BENCHMARK_MODE
+  if (millis() - lastBenchReport >= BENCH_REPORT_MS) {
+    lastBenchReport = millis();
+    printBenchmark();
+  }
+#endif
+}
 
-// MQ Sensor Configuration (Analog Pin - Use ADC1 pins only: 32-39)
-// NOTE: ADC2 pins (0,2,4,12-15,25-27) don't work with WiFi!
-#define MQ_PIN 34  // GPIO34 is ADC1_CH6 - Safe to use with WiFi
+// ==================== REMOTE CONTROL ====================
 
-// Send data every 12 seconds
-const unsigned long SEND_INTERVAL = 12000;
+#if REMOTE_CONTROL
+Preferences controlPrefs;
 
-// WiFi Channel (1-13, match with receiver)
-#define WIFI_CHANNEL 1
+/**
+ * @brief Load the settings pushed by the gateway and the installed image id from NVS
+ *
+ * Cold boot only: deep sleep keeps them in RTC memory. An image that was
+ * set to boot is only taken as installed once it is the one running; if the
+ * bootloader rolled it back, the previous id stays.
+ */
+void loadRemoteConfig() {
+  controlPrefs.begin("control", false);
+  baseReportInterval = controlPrefs.getUInt("interval", baseReportInterval);
+  appliedConfigVersion = controlPrefs.getUInt("cfgver", 0);
+  runningImageId = controlPrefs.getUInt("image", 0);
+  
+  if (controlPrefs.isKey("nextimage")) {
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    if (running != nullptr && running->address == controlPrefs.getUInt("nextpart", 0)) {
+      runningImageId = controlPrefs.getUInt("nextimage", 0);
+      controlPrefs.putUInt("image", runningImageId);
+      LOG_INFO("✅ Running update %lu\n", (unsigned long)runningImageId);
+    } else {
+      LOG_WARN("⚠️  Update %lu did not boot, still running %lu\n",
+               (unsigned long)controlPrefs.getUInt("nextimage", 0), (unsigned long)runningImageId);
+    }
+    controlPrefs.remove("nextimage");
+    controlPrefs.remove("nextpart");
+  }
+  controlPrefs.end();
+  
+  setBaseReportInterval(baseReportInterval);  // Before the tasks start
+  if (baseReportInterval != (BATCH_MODE ? BATCH_FLUSH_TIMEOUT : SEND_INTERVAL)) {
+    LOG_INFO("⚙️  Report interval %lu ms (set by the gateway)\n", (unsigned long)baseReportInterval);
+  }
+}
 
-// Maximum retry attempts for ESP-NOW initialization
-#define MAX_INIT_RETRIES 3
+/**
+ * @brief Restart once the last reply had time to go out (new pairing or firmware)
+ */
+void scheduleRestart() {
+  restartPending = true;
+  restartAtMs = millis() + CONTROL_RESTART_DELAY_MS;
+}
 
-// ==================== DATA STRUCTURE ====================
+/**
+ * @brief Check and apply the items of a FRAME_CONFIG, all or nothing
+ * @return frame_config_result
+ */
+uint8_t applyConfigItems(const uint8_t *items, size_t itemsLen) {
+  uint32_t interval = 0;
+  uint8_t channel = 0;
+  const uint8_t *gateway = nullptr;
+  
+  const uint8_t *p = items;
+  const uint8_t *end = items + itemsLen;
+  uint8_t key, len;
+  const uint8_t *value;
+  while (frameNextConfigItem(p, end, key, value, len)) {
+    if (key == CONFIG_REPORT_INTERVAL && len == 4) {
+      interval = frameGet32(value);
+      if (interval < CONFIG_MIN_INTERVAL || interval > CONFIG_MAX_INTERVAL) return CONFIG_REJECTED;
+    } else if (AUTO_PAIRING && key == CONFIG_WIFI_CHANNEL && len == 1) {
+      channel = value[0];
+      if (channel < 1 || channel > SCAN_CHANNEL_MAX) return CONFIG_REJECTED;
+    } else if (AUTO_PAIRING && key == CONFIG_GATEWAY && len == 6) {
+      gateway = value;
+    } else {
+      return CONFIG_REJECTED;
+    }
+  }
+  if (p != end) return CONFIG_REJECTED;  // Truncated item
+  
+  if (interval != 0) {
+#if PIPELINE_MODE
+    pendingReportInterval.store(interval, std::memory_order_release);  // Taken at the next report
+#else
+    setBaseReportInterval(interval);
+#endif
+    controlPrefs.begin("control", false);
+    controlPrefs.putUInt("interval", interval);
+    controlPrefs.end();
+    LOG_INFO("⚙️  Report interval set to %lu ms\n", (unsigned long)interval);
+  }
+  
+#if AUTO_PAIRING
+  if (channel != 0 || gateway != nullptr) {
+    const uint8_t *mac = gateway != nullptr ? gateway : peers.mac(peers.active());
+    savePairing(mac, channel != 0 ? channel : wifiChannel);
+    LOG_INFO("⚙️  Gateway %02X:%02X:%02X:%02X:%02X:%02X on channel %u, restarting to switch\n",
+             mac[0], mac[1], mac[2], mac[3], mac[4], mac[5], channel != 0 ? channel : wifiChannel);
+    scheduleRestart();
+  }
+#else
+  (void)channel;
+  (void)gateway;
+#endif
+  return CONFIG_APPLIED;
+}
 
-typedef struct sensor_data {
-  float temperature;
-  float humidity;
-  int mq_value;
-  float heartRate;
-  float spo2;
-  char mac[18];
-  unsigned long timestamp;
-} sensor_data;
+/**
+ * @brief Apply an authenticated FRAME_CONFIG unless already applied, and acknowledge it
+ */
+void handleConfig(const uint8_t *data, size_t len) {
+  frame_header hdr;
+  uint32_t version;
+  const uint8_t *items;
+  size_t itemsLen;
+  if (!decodeConfigFrame(data, len, hdr, version, items, itemsLen)) return;
+  
+  // The gateway repeats a config until it is acknowledged
+  uint8_t result = CONFIG_STALE;
+  if ((int32_t)(version - appliedConfigVersion) > 0) {
+    result = applyConfigItems(items, itemsLen);
+    if (result == CONFIG_APPLIED) {
+      appliedConfigVersion = version;
+      controlPrefs.begin("control", false);
+      controlPrefs.putUInt("cfgver", version);
+      controlPrefs.end();
+    } else {
+      LOG_WARN("⚠️  Config %lu rejected\n", (unsigned long)version);
+    }
+  }
+  
+  uint8_t frame[FRAME_CONFIG_ACK_SIZE];
+  size_t frameLen = encodeConfigAckFrame(frame, sizeof(frame), deviceMac, controlSeq++, version, result);
+  frameLen = signControlFrame(controlKey, frame, frameLen, sizeof(frame));
+  if (frameLen > 0) sendFrame(frame, frameLen);
+}
 
-// ==================== GLOBAL VARIABLES ====================
+/**
+ * @brief Change the transfer state; OnDataRecv only queues chunks while receiving
+ */
+void setOtaState(uint8_t state) {
+  ota.state = state;
+  otaReceiving.store(state == OTA_RECEIVING, std::memory_order_relaxed);
+}
 
-DHT dht(DHTPIN, DHTTYPE);
-sensor_data sensorData;
+/**
+ * @brief Report the transfer state and the sectors still missing to the gateway
+ */
+void sendOtaStatus() {
+  uint8_t sectors[OTA_SECTOR_MAP_SIZE];
+  size_t mapLen = 0;
+  if (ota.state == OTA_RECEIVING || ota.state == OTA_IDLE) {
+    mapLen = otaImage.incompleteSectors(sectors, sizeof(sectors));
+  }
+  
+  uint8_t frame[FRAME_OTA_STATUS_SIZE(OTA_SECTOR_MAP_SIZE)];
+  size_t frameLen = encodeOtaStatusFrame(frame, sizeof(frame), deviceMac, controlSeq++, ota.imageId,
+                                         ota.state, (uint16_t)otaImage.stored(), sectors, mapLen);
+  frameLen = signControlFrame(controlKey, frame, frameLen, sizeof(frame));
+  ota.lastStatusMs = millis();
+  if (frameLen > 0) sendFrame(frame, frameLen);
+}
 
-bool espNowConnected = false;
-unsigned long lastSendTime = 0;
-int successCount = 0;
-int failureCount = 0;
+/**
+ * @brief Record the chunks stored so far, so a restart resumes instead of starting over
+ */
+void saveOtaProgress() {
+  if (otaImage.stored() == ota.savedStored) return;
+  controlPrefs.begin("control", false);
+  controlPrefs.putBytes("otachunks", otaImage.receivedWords(), otaImage.sectors() * sizeof(uint32_t));
+  controlPrefs.end();
+  ota.savedStored = otaImage.stored();
+}
 
-// ==================== HELPER FUNCTIONS ====================
+void clearOtaProgress() {
+  controlPrefs.begin("control", false);
+  controlPrefs.remove("otaimage");
+  controlPrefs.remove("otachunks");
+  controlPrefs.end();
+}
 
 /**
- * @brief Gets the MAC address of this ESP32 as a formatted string
+ * @brief Start receiving an offered image, or resume an earlier transfer of it
+ *
+ * NVS is only written when the image differs from the one recorded, so
+ * repeated offers and retries after a failure do not wear it.
  */
-String getMacAddress() {
-  uint8_t mac[6];
-  esp_read_mac(mac, ESP_MAC_WIFI_STA);
-  char macStr[18];
-  snprintf(macStr, sizeof(macStr), "%02X:%02X:%02X:%02X:%02X:%02X",
-           mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
-  return String(macStr);
+void beginOta(uint32_t imageId, uint32_t size, const uint8_t digest[OTA_DIGEST_SIZE]) {
+  static uint32_t saved[OTA_MAX_SECTORS];
+  uint8_t savedDigest[OTA_DIGEST_SIZE];
+  
+  ota.imageId = imageId;
+  memcpy(ota.digest, digest, OTA_DIGEST_SIZE);
+  
+  const esp_partition_t *part = esp_ota_get_next_update_partition(nullptr);
+  if (!otaImage.begin(part, size)) {
+    LOG_ERROR("❌ Update %lu (%lu bytes) does not fit the OTA partition\n",
+              (unsigned long)imageId, (unsigned long)size);
+    setOtaState(OTA_FAILED);
+    sendOtaStatus();
+    return;
+  }
+  
+  controlPrefs.begin("control", false);
+  bool sameImage = controlPrefs.getUInt("otaimage", 0) == imageId &&
+                   controlPrefs.getUInt("otasize", 0) == size &&
+                   controlPrefs.getBytes("otadigest", savedDigest, sizeof(savedDigest)) == sizeof(savedDigest) &&
+                   memcmp(savedDigest, digest, OTA_DIGEST_SIZE) == 0;
+  bool resume = sameImage && controlPrefs.getBytes("otachunks", saved, sizeof(saved)) > 0;
+  if (!resume) {
+    memset(saved, 0, sizeof(saved));
+    if (controlPrefs.isKey("otachunks")) controlPrefs.remove("otachunks");
+  }
+  if (!sameImage) {
+    controlPrefs.putUInt("otaimage", imageId);
+    controlPrefs.putUInt("otasize", size);
+    controlPrefs.putBytes("otadigest", digest, OTA_DIGEST_SIZE);
+  }
+  controlPrefs.end();
+  otaImage.begin(part, size, saved);
+  
+  setOtaState(OTA_RECEIVING);
+  ota.lastChunkMs = millis();
+  ota.savedStored = otaImage.stored();
+  esp_wifi_set_ps(WIFI_PS_NONE);  // Chunks are broadcast: keep the receiver on
+  LOG_INFO("📥 %s update %lu: %lu bytes, %lu/%lu chunks stored\n", resume ? "Resuming" : "Receiving",
+           (unsigned long)imageId, (unsigned long)size, (unsigned long)otaImage.stored(),
+           (unsigned long)otaImage.chunks());
+  sendOtaStatus();
 }
 
 /**
- * @brief Reads all sensors and updates the sensorData structure
+ * @brief All chunks are in: check the image against the signed hash and set it to boot
  */
-void readSensors() {
-  // Read DHT22 Temperature & Humidity
-  float temp = dht.readTemperature();
-  float hum = dht.readHumidity();
+void finishOta() {
+  LOG_INFO("🔏 Update %lu complete, verifying...\n", (unsigned long)ota.imageId);
+  uint8_t digest[OTA_DIGEST_SIZE];
+  bool authentic = otaImage.hash(ota.imageId, digest) && frameTagEqual(digest, ota.digest, OTA_DIGEST_SIZE);
+  esp_err_t err = authentic ? esp_ota_set_boot_partition(otaImage.partition()) : ESP_FAIL;
+  configureModemSleep();
   
-  // Check if DHT reading failed
-  if (isnan(temp) || isnan(hum)) {
-    Serial.println("⚠️  DHT22 Read Failed! Using previous values or defaults.");
-    // Keep previous values if available, otherwise use defaults
-    if (sensorData.temperature == 0.0) {
-      sensorData.temperature = 25.0;  // Default room temperature
-      sensorData.humidity = 50.0;      // Default humidity
-    }
+  if (err != ESP_OK) {
+    // The next offer of the image starts it over
+    LOG_ERROR("❌ Update %lu rejected (%s)\n", (unsigned long)ota.imageId,
+              authentic ? "invalid image" : "hash mismatch");
+    controlPrefs.begin("control", false);
+    controlPrefs.remove("otachunks");
+    controlPrefs.end();
+    ota.savedStored = 0;
+    setOtaState(OTA_FAILED);
   } else {
-    sensorData.temperature = temp;
-    sensorData.humidity = hum;
+    clearOtaProgress();
+    // Confirmed by loadRemoteConfig() once the new image is running
+    controlPrefs.begin("control", false);
+    controlPrefs.putUInt("nextimage", ota.imageId);
+    controlPrefs.putUInt("nextpart", otaImage.partition()->address);
+    controlPrefs.end();
+    LOG_INFO("✅ Update %lu verified, restarting into it\n", (unsigned long)ota.imageId);
+    setOtaState(OTA_DONE);
+    scheduleRestart();
   }
+  sendOtaStatus();
+}
+
+/**
+ * @brief React to an authenticated FRAME_OTA_OFFER: join the transfer, or just report where it stands
+ *
+ * A paused transfer resumes and a failed one starts over. While receiving,
+ * or restarting into a new image, offers of another image are ignored. The
+ * release signature is checked once per image, before anything is written.
+ */
+void handleOffer(const uint8_t *data, size_t len) {
+  frame_header hdr;
+  uint32_t imageId, size;
+  uint8_t digest[OTA_DIGEST_SIZE];
+  const uint8_t *sig;
+  size_t sigLen;
+  if (!decodeOtaOfferFrame(data, len, hdr, imageId, size, digest, sig, sigLen)) return;
   
-  // Read MQ Gas Sensor (0-4095 for 12-bit ADC)
-  int mqRaw = analogRead(MQ_PIN);
-  
-  // Validate ADC reading
-  if (mqRaw < 0 || mqRaw > 4095) {
-    Serial.println("⚠️  Invalid MQ sensor reading!");
-    sensorData.mq_value = 0;
-  } else {
-    sensorData.mq_value = mqRaw;
+  bool known = ota.imageId != 0 && imageId == ota.imageId && memcmp(digest, ota.digest, OTA_DIGEST_SIZE) == 0;
+  if (known && (ota.state == OTA_RECEIVING || ota.state == OTA_DONE)) {
+    if (millis() - ota.lastStatusMs >= OTA_STATUS_INTERVAL_MS) sendOtaStatus();
+    return;
+  }
+  if (ota.state == OTA_RECEIVING || restartPending) return;
+  if (!known && !otaVerifySignature(OTA_PUBLIC_KEY, digest, sig, sigLen)) {
+    LOG_WARN("⚠️  Update %lu is not signed by the release key, ignored\n", (unsigned long)imageId);
+    return;
   }
   
-  // Simulated Heart Rate and SpO2 (replace with actual MAX30102 sensor if available)
-  // Realistic ranges: Heart Rate (60-100 bpm), SpO2 (95-100%)
-  sensorData.heartRate = 72.0 + (random(-10, 11) / 2.0);  // 67-77 bpm range
-  sensorData.spo2 = 97.5 + (random(-5, 6) / 2.0);         // 95-100% range
+  if (imageId <= runningImageId) {
+    // Already running, or a rollback to an older image
+    ota.imageId = imageId;
+    memcpy(ota.digest, digest, OTA_DIGEST_SIZE);
+    if (imageId < runningImageId && ota.state != OTA_FAILED) {
+      LOG_WARN("⚠️  Update %lu is older than the running %lu, refused\n",
+               (unsigned long)imageId, (unsigned long)runningImageId);
+    }
+    setOtaState(imageId == runningImageId ? OTA_DONE : OTA_FAILED);
+    sendOtaStatus();
+    return;
+  }
+  beginOta(imageId, size, digest);
+}
+
+/**
+ * @brief Whether a control frame comes from one of this node's gateways and carries a valid tag
+ * @param key controlKey, or chunkKey for a FRAME_OTA_CHUNK
+ */
+bool controlFrameAuthentic(const control_frame &frame, const uint8_t key[FRAME_KEY_SIZE]) {
+  frame_header hdr;
+  return decodeFrameHeader(frame.data, frame.len, hdr) && memcmp(hdr.mac, frame.mac, 6) == 0 &&
+         peers.find(frame.mac) >= 0 && verifyControlFrame(key, frame.data, frame.len);
+}
+
+void handleChunk(const uint8_t *data, size_t len) {
+  if (ota.state != OTA_RECEIVING) return;
   
-  // Clamp SpO2 to realistic range
-  if (sensorData.spo2 > 100.0) sensorData.spo2 = 100.0;
-  if (sensorData.spo2 < 90.0) sensorData.spo2 = 90.0;
+  frame_header hdr;
+  uint32_t imageId;
+  uint16_t chunk;
+  const uint8_t *bytes;
+  size_t bytesLen;
+  if (!decodeOtaChunkFrame(data, len, hdr, imageId, chunk, bytes, bytesLen) || imageId != ota.imageId) return;
+  if (!otaImage.write(chunk, bytes, bytesLen)) return;  // Bad chunk or flash error: asked for again
   
-  // Add timestamp
-  sensorData.timestamp = millis();
+  ota.lastChunkMs = millis();
+  if (otaImage.complete()) finishOta();
+}
+#endif
+
+/**
+ * @brief Apply control frames from the gateway and drive a running update
+ *
+ * Runs in the radio context (loop(), or radioTask in PIPELINE_MODE): replies
+ * go through the send window like any other frame.
+ */
+void serviceControl() {
+#if REMOTE_CONTROL
+  while (!controlRing.empty()) {
+    const control_frame &frame = controlRing.peek();
+    uint8_t type = frame.data[0] & 0x0F;
+    if (!controlFrameAuthentic(frame, type == FRAME_OTA_CHUNK ? chunkKey : controlKey)) {
+      controlRejected++;
+      if (type != FRAME_OTA_CHUNK) LOG_WARN("⚠️  Control frame failed authentication, ignored\n");
+    } else {
+      switch (type) {
+        case FRAME_CONFIG: handleConfig(frame.data, frame.len); break;
+        case FRAME_OTA_OFFER: handleOffer(frame.data, frame.len); break;
+        case FRAME_OTA_CHUNK: handleChunk(frame.data, frame.len); break;
+      }
+    }
+    controlRing.drop(1);
+  }
   
-  // Add MAC address
-  String macStr = getMacAddress();
-  macStr.toCharArray(sensorData.mac, 18);
+  unsigned long now = millis();
+  if (ota.state == OTA_RECEIVING) {
+    if (now - ota.lastChunkMs >= OTA_STALL_MS) {
+      // The next offer resumes from the last checkpoint
+      saveOtaProgress();
+      setOtaState(OTA_IDLE);
+      configureModemSleep();
+      LOG_WARN("⚠️  Update %lu stalled at %lu/%lu chunks, paused (%lu frames lost to a full ring, %lu rejected)\n",
+               (unsigned long)ota.imageId, (unsigned long)otaImage.stored(), (unsigned long)otaImage.chunks(),
+               (unsigned long)controlRingOverflows.load(std::memory_order_relaxed),
+               (unsigned long)controlRejected);
+      sendOtaStatus();
+    } else if (now - ota.lastStatusMs >= OTA_STATUS_INTERVAL_MS) {
+      saveOtaProgress();
+      sendOtaStatus();
+    }
+  }
   
-  // Print readings to Serial Monitor
-  Serial.println("\n========== SENSOR READINGS ==========");
-  Serial.printf("🌡️  Temperature : %.2f °C\n", sensorData.temperature);
-  Serial.printf("💧 Humidity    : %.2f %%\n", sensorData.humidity);
-  Serial.printf("🌫️  Gas Level   : %d (Raw ADC)\n", sensorData.mq_value);
-  Serial.printf("❤️  Heart Rate  : %.2f bpm\n", sensorData.heartRate);
-  Serial.printf("🩺 SpO2        : %.2f %%\n", sensorData.spo2);
-  Serial.printf("📱 MAC Address : %s\n", sensorData.mac);
-  Serial.printf("⏱️  Timestamp   : %lu ms\n", sensorData.timestamp);
-  Serial.println("=====================================");
+  // Restart once the reply is delivered, or the delay has passed twice over
+  if (restartPending && (long)(now - restartAtMs) >= 0 &&
+      (sendWindow.empty() || (long)(now - restartAtMs) >= (long)CONTROL_RESTART_DELAY_MS)) {
+    LOG_INFO("🔄 Restarting...\n");
+    Serial.flush();
+    ESP.restart();
+  }
+#endif
 }
 
-// ==================== ESP-NOW FUNCTIONS ====================
+/**
+ * @brief A transfer or a restart is underway: keep polling the control frames closely
+ */
+bool remoteBusy() {
+#if REMOTE_CONTROL
+  return ota.state == OTA_RECEIVING || restartPending;
+#else
+  return false;
+#endif
+}
+
+// ==================== TASK PIPELINE ====================
+
+#if PIPELINE_MODE
+// sensorTask --sampleRing--> encodeTask --txRing--> radioTask
+// Alarms skip the encoder: sensorTask --alarmTxRing--> radioTask
+// Each ring has exactly one producer and one consumer task, so no locks are
+// needed; task notifications wake the next stage.
+
+typedef struct tx_frame {
+  uint8_t len;
+  uint8_t records;  // Flash log records in the frame, or LIVE_FRAME_TAG
+  uint8_t data[FRAME_MAX_SIZE];
+} tx_frame;
+
+RingBuffer<tx_frame, TX_RING_SIZE> txRing;
+#if ANOMALY_WATCH
+RingBuffer<tx_frame, 4> alarmTxRing;
+#endif
+TaskHandle_t encodeTaskHandle = nullptr;
+volatile uint32_t samplesDropped = 0;
 
 /**
- * @brief Callback function when data is sent via ESP-NOW
+ * @brief Sampling stage: drives the DHT22 state machine and takes readings
  */
-void OnDataSent(const uint8_t *mac_addr, esp_now_send_status_t status) {
-  Serial.print("\n📤 Send Status: ");
+void sensorTask(void *param) {
+  TickType_t lastWake = xTaskGetTickCount();
+  unsigned long lastSample = millis();
+  cpuBusy();
   
-  if (status == ESP_NOW_SEND_SUCCESS) {
-    espNowConnected = true;
-    successCount++;
-    Serial.println("✅ Delivery Success");
-    Serial.printf("   Total Success: %d | Failures: %d\n", successCount, failureCount);
-  } else {
-    espNowConnected = false;
-    failureCount++;
-    Serial.println("❌ Delivery Failed");
-    Serial.printf("   Total Success: %d | Failures: %d\n", successCount, failureCount);
+  for (;;) {
+    uint32_t passStart = micros();
+    dht.poll();
+    holdAwakeForSensors();
+    oximeter.poll();
     
-    // Attempt reconnection if multiple failures
-    if (failureCount % 5 == 0) {
-      Serial.println("⚠️  Multiple failures detected. Attempting ESP-NOW restart...");
-      esp_now_deinit();
-      delay(1000);
-      initESPNow();
+    bool due = BATCH_MODE ? millis() - lastSample >= SAMPLE_INTERVAL : reportSlotDue(millis());
+#if ANOMALY_WATCH
+    // Between reports, readings only feed the anomaly check (batches check every sample)
+    if (!BATCH_MODE && !due && millis() - lastWatchTime >= ANOMALY_WATCH_MS) {
+      lastWatchTime = millis();
+      checkAnomaly(readSensors(true));
     }
+#endif
+    if (due) {
+      lastSample = millis();
+      sensor_data reading = readSensors();
+      checkAnomaly(reading);
+      if (!BATCH_MODE) adaptReportInterval(reading);  // Batches adapt in encodeTask
+      
+      if (reportDue(reading)) {
+        // Producer side can't evict: drop the newest reading if the encoder is behind
+        if (!sampleRing.push(reading)) {
+          samplesDropped++;
+        }
+        xTaskNotifyGive(encodeTaskHandle);
+      }
+    }
+    
+    health.onLoopPass(micros() - passStart);
+    cpuIdle();
+    vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(SENSOR_POLL_MS));
+    cpuBusy();
   }
 }
 
 /**
- * @brief Initialize ESP-NOW protocol
+ * @brief Encoding stage: packs buffered samples into frames for the radio
  */
-bool initESPNow() {
-  // Set device as Wi-Fi Station
-  WiFi.mode(WIFI_STA);
-  
-  // Disconnect from any AP first
-  WiFi.disconnect();
-  delay(100);
+void encodeTask(void *param) {
+  cpuBusy();
+  for (;;) {
+    // Woken per sample; the timeout also catches the batch report slot
+    long untilReport = BATCH_MODE ? (long)(nextReportTime - millis()) : (long)SAMPLE_INTERVAL;
+    if (untilReport < 1) untilReport = 1;
+    if (untilReport > (long)SAMPLE_INTERVAL) untilReport = SAMPLE_INTERVAL;
+    cpuIdle();
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(untilReport));
+    cpuBusy();
+    
+#if STORE_FORWARD
+    // Park readings in flash during an outage; once the link is back the
+    // backlog is encoded first, one frame per acknowledgment
+    if (storeForwardActive()) {
+      settleStoredBatch();  // Rescued frames first, they are older
+      spillSampleRing();
+      if (storedInFlight == 0 && espNowConnected.load(std::memory_order_relaxed) && flashLog.count() > 0 &&
+          !txRing.full()) {
+        tx_frame frame;
+        size_t consumed = 0;
+        frame.len = (uint8_t)buildStoredBatchFrame(frame.data, FRAME_PAYLOAD_MAX, frameSeq, consumed);
+        frame.records = (uint8_t)consumed;
+        if (frame.len > 0) {
+          txRing.push(frame);
+          storedInFlight = consumed;
+          frameSeq++;
+          xTaskNotifyGive(radioTaskHandle);
+        }
+      }
+      continue;
+    }
+#endif
+    
+#if BATCH_MODE
+    // Partial batches go out in this node's report slot, full ones right away
+    bool slotDue = reportSlotDue(millis());
+#endif
+    while (!sampleRing.empty() && !txRing.full()) {
+#if BATCH_MODE
+      bool ready = slotDue || sampleRing.size() >= BATCH_MAX_SAMPLES;
+      if (!ready) break;
+      adaptReportInterval(sampleRing.peek(sampleRing.size() - 1));
+#endif
+      
+      tx_frame frame;
+      size_t consumed = 0;
+#if BATCH_MODE
+      frame.len = (uint8_t)buildBatchFrame(frame.data, FRAME_PAYLOAD_MAX, frameSeq, consumed);
+#else
+      frame.len = (uint8_t)encodeSampleFrame(frame.data, FRAME_PAYLOAD_MAX, deviceMac,
+                                             frameSeq, sampleRing.peek());
+      frame.len = (uint8_t)appendHealth(frame.data, frame.len, FRAME_PAYLOAD_MAX);
+      consumed = 1;
+#endif
+      frame.records = LIVE_FRAME_TAG;
+      if (frame.len == 0) break;
+      
+      txRing.push(frame);
+      sampleRing.drop(consumed);
+      frameSeq++;
+      xTaskNotifyGive(radioTaskHandle);
+    }
+  }
+}
+
+/**
+ * @brief Radio stage: hands encoded frames to ESP-NOW in order
+ */
+void radioTask(void *param) {
+  cpuBusy();
+  for (;;) {
+    cpuIdle();
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(RADIO_RETRY_MS));
+    cpuBusy();
+    
+    processSendStatus();
+    serviceLinkRecovery();
+    serviceBenchmark();
+    serviceControl();
+    
+#if ANOMALY_WATCH
+    // Alarms overtake everything already queued
+    while (!alarmTxRing.empty()) {
+      const tx_frame &frame = alarmTxRing.peek();
+      if (!enqueueFrame(frame.data, frame.len, true)) break;
+      alarmTxRing.drop(1);
+    }
+#endif
+    
+    // Move encoded frames into the send window as slots free up
+    while (!txRing.empty() && sendWindow.freeSlots() > 0) {
+      const tx_frame &frame = txRing.peek();
+      if (!enqueueFrame(frame.data, frame.len, false, frame.records)) break;  // Kept for the next pass
+      txRing.drop(1);
+    }
+    pumpSendWindow();
+    
+    // Frames freed up: let the encoder catch up on any backlog
+    xTaskNotifyGive(encodeTaskHandle);
+  }
+}
+
+/**
+ * @brief Create the pipeline tasks, pinned sensibly across both cores
+ */
+void startPipeline() {
+  xTaskCreatePinnedToCore(radioTask, "radio", 4096, nullptr, 4, &radioTaskHandle, RADIO_TASK_CORE);
+  xTaskCreatePinnedToCore(encodeTask, "encode", 4096, nullptr, 3, &encodeTaskHandle, ENCODE_TASK_CORE);
+  xTaskCreatePinnedToCore(sensorTask, "sensor", 4096, nullptr, 2, nullptr, SENSOR_TASK_CORE);
+  LOG_INFO("✅ Sensor/encode/radio pipeline started\n");
+}
+#endif
+
+// ==================== ANOMALY DETECTION ====================
+
+/**
+ * @brief Check a reading for anomalies and send an alarm at once if one is raised
+ *
+ * No-op unless ANOMALY_WATCH. Call it from the sampling context (loop(), or
+ * sensorTask in PIPELINE_MODE), once for every reading taken.
+ *
+ * @return true if an alarm was queued for transmission
+ */
+bool checkAnomaly(const sensor_data &reading) {
+#if ANOMALY_WATCH
+  uint8_t mask = anomaly.check(reading, millis());
+  if (mask == 0) return false;
   
-  // Set WiFi channel
-  esp_wifi_set_promiscuous(true);
-  esp_wifi_set_channel(WIFI_CHANNEL, WIFI_SECOND_CHAN_NONE);
-  esp_wifi_set_promiscuous(false);
+  LOG_WARN("🚨 Anomaly (channels 0x%02X): %.2f °C, gas %d, %.1f bpm, SpO2 %.1f %%\n",
+           mask, reading.temperature, reading.mq_value, reading.heartRate, reading.spo2);
+  if (!espNowConnected.load(std::memory_order_relaxed)) {
+    LOG_WARN("⚠️  ESP-NOW not connected! Alarm not sent\n");
+    return false;
+  }
   
-  Serial.println("\n📡 Initializing ESP-NOW...");
-  Serial.printf("   WiFi Channel: %d\n", WIFI_CHANNEL);
+#if PIPELINE_MODE
+  tx_frame frame;
+  frame.len = (uint8_t)encodeAlarmFrame(frame.data, FRAME_PAYLOAD_MAX, deviceMac, alarmSeq++,
+                                        mask, reading);
+  if (!alarmTxRing.push(frame)) return false;
+  xTaskNotifyGive(radioTaskHandle);
+  return true;
+#else
+  uint8_t frame[FRAME_ALARM_SIZE];
+  size_t frameLen = encodeAlarmFrame(frame, sizeof(frame), deviceMac, alarmSeq++, mask, reading);
+  return sendFrame(frame, frameLen, true);
+#endif
+#else
+  return false;
+#endif
+}
+
+// ==================== DEEP SLEEP ====================
+
+/**
+ * @brief Copy the delivery totals and wake time into RTC memory before sleeping
+ */
+void saveCounters() {
+  rtcSuccessCount = successCount.load(std::memory_order_relaxed);
+  rtcFailureCount = failureCount.load(std::memory_order_relaxed);
+  rtcWakeMs = health.wakeMs();
+}
+
+/**
+ * @brief Pick up the totals saved before the last deep sleep (all zero after power-up)
+ *
+ * The wake time stays the previous cycle's until this one's first transmission,
+ * so a trailer on the first frame of a wake still has one.
+ */
+void restoreCounters() {
+  successCount.store(rtcSuccessCount, std::memory_order_relaxed);
+  failureCount.store(rtcFailureCount, std::memory_order_relaxed);
+  health.setWakeMs(rtcWakeMs);
+}
+
+/**
+ * @brief Remember the working channel/peer so they survive deep sleep
+ */
+void saveLinkState() {
+  rtcLink.magic = RTC_LINK_MAGIC;
+  memcpy(rtcLink.peerAddr, peers.mac(peers.active()), 6);
+  rtcLink.channel = wifiChannel;
+}
+
+/**
+ * @brief Restore channel/peer saved before the last deep sleep
+ * @return false on a power-up boot (RTC memory not yet valid) or a full peer table
+ */
+bool restoreLinkState() {
+  if (rtcLink.magic != RTC_LINK_MAGIC) return false;
+  // A scanned gateway is not among serverAddresses, so it may not be in the table yet
+  int idx = peers.add(rtcLink.peerAddr);
+  if (idx < 0) return false;
+  peers.setActive(idx);
+  wifiChannel = rtcLink.channel;
+  return true;
+}
+
+/**
+ * @brief Service delivery reports until the send window drains (or the timeout hits)
+ *
+ * Failed frames are retransmitted from processSendStatus() meanwhile.
+ */
+bool waitForSendWindow(unsigned long timeoutMs) {
+  unsigned long start = millis();
+  while (!sendWindow.empty()) {
+    if (millis() - start >= timeoutMs) return false;
+    delay(1);
+    processSendStatus();
+  }
+  return true;
+}
+
+/**
+ * @brief Sleep until the next send slot, accounting for time spent awake
+ */
+void enterDeepSleep() {
+  uint64_t awakeUs = esp_timer_get_time();
+  uint64_t intervalUs = (uint64_t)reportInterval() * 1000ULL;
+  uint64_t sleepUs = awakeUs < intervalUs ? intervalUs - awakeUs : 1000ULL;
   
-  // Initialize ESP-NOW
-  esp_err_t initResult = esp_now_init();
-  if (initResult != ESP_OK) {
-    Serial.printf("❌ ESP-NOW Initialization Failed! Error: 0x%X\n", initResult);
-    espNowConnected = false;
-    return false;
+#if TDMA_MODE
+  // First cycle after power-up: move into this node's slot, later wakes keep the phase
+  if (esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_TIMER) {
+    sendSchedule.assign(ReportSchedule::macSlot(deviceMac, TDMA_SLOTS), TDMA_SLOTS, 0);
+    sleepUs += (uint64_t)sendSchedule.slotOffset(reportInterval()) * 1000ULL;
   }
+#else
+  // Zero-mean jitter so nodes powered up together drift apart
+  int64_t jitterUs = ((int64_t)(esp_random() % (2 * SEND_JITTER_MS + 1)) - SEND_JITTER_MS) * 1000LL;
+  sleepUs = (int64_t)sleepUs + jitterUs > 1000 ? sleepUs + jitterUs : 1000ULL;
+#endif
   
-  Serial.println("✅ ESP-NOW Initialized Successfully");
+  LOG_EVENT(LOG_LEVEL_INFO, LOG_EVT_SLEEP, (unsigned long)(awakeUs / 1000ULL), (unsigned long)(sleepUs / 1000ULL),
+            "\n😴 Awake %llu ms, sleeping %llu ms (boot #%lu)\n",
+            awakeUs / 1000ULL, sleepUs / 1000ULL, (unsigned long)bootCount);
+  Serial.flush();
   
-  // Register send callback
-  esp_err_t callbackResult = esp_now_register_send_cb(OnDataSent);
-  if (callbackResult != ESP_OK) {
-    Serial.printf("❌ Failed to register send callback! Error: 0x%X\n", callbackResult);
-    return false;
+  saveCounters();
+  esp_now_deinit();
+  esp_sleep_enable_timer_wakeup(sleepUs);
+  esp_deep_sleep_start();
+}
+
+#if REMOTE_CONTROL
+/**
+ * @brief Give the gateway CONTROL_LISTEN_MS after the report to send config or an update offer
+ *
+ * The gateway answers a node's report with any pending config or update.
+ * An update it offers keeps the node awake until the image is in (and the
+ * node restarts into it) or the transfer stalls; the next wake resumes it.
+ */
+void listenForControl() {
+  unsigned long start = millis();
+  while (millis() - start < CONTROL_LISTEN_MS || remoteBusy()) {
+    serviceControl();
+    processSendStatus();
+    delay(CONTROL_POLL_MS);
   }
+  waitForSendWindow(ACK_TIMEOUT_MS);  // Replies
+}
+#endif
+
+/**
+ * @brief One duty cycle: send the current reading, wait for the ack, sleep
+ * @param reading The reading taken this cycle
+ * @param report false if the deadband check suppressed this reading
+ */
+void runDutyCycle(const sensor_data &reading, bool report) {
+  bool queued = report && sendData(reading);
+#if STORE_FORWARD
+  if (!report) queued = drainStoredBacklog() > 0;
+#endif
   
-  // Register peer (receiver)
-  esp_now_peer_info_t peerInfo;
-  memset(&peerInfo, 0, sizeof(peerInfo));
-  memcpy(peerInfo.peer_addr, serverAddress, 6);
-  peerInfo.channel = WIFI_CHANNEL;  // Must match the channel set above
-  peerInfo.encrypt = false;
-  peerInfo.ifidx = WIFI_IF_STA;
+  if (queued) {
+    // Failed deliveries were already counted by processSendStatus()
+    if (!waitForSendWindow(ACK_TIMEOUT_MS)) {
+      LOG_WARN("⚠️  No delivery callback before timeout\n");
+    }
+  }
   
-  // Check if peer already exists
-  if (esp_now_is_peer_exist(serverAddress)) {
-    Serial.println("⚠️  Peer already exists, removing...");
-    esp_now_del_peer(serverAddress);
-    delay(100);
+#if STORE_FORWARD
+  // Each stored batch waits for its ack
+  for (int i = 1; i < STORE_DRAIN_FRAMES && drainStoredBacklog() > 0; i++) {
+    waitForSendWindow(ACK_TIMEOUT_MS);
   }
+#endif
   
-  // Add peer
-  esp_err_t addPeerResult = esp_now_add_peer(&peerInfo);
-  if (addPeerResult != ESP_OK) {
-    Serial.printf("❌ Failed to Add Peer! Error: 0x%X\n", addPeerResult);
-    espNowConnected = false;
-    return false;
+  if (firstPacketUs > 0) {
+    LOG_INFO("⚡ Time to first packet: %.1f ms\n", firstPacketUs / 1000.0);
   }
   
-  espNowConnected = true;
-  Serial.println("✅ Peer Added Successfully");
+#if REMOTE_CONTROL
+  listenForControl();
+#endif
   
-  // Print server MAC
-  char serverMAC[18];
-  snprintf(serverMAC, sizeof(serverMAC), "%02X:%02X:%02X:%02X:%02X:%02X",
-           serverAddress[0], serverAddress[1], serverAddress[2],
-           serverAddress[3], serverAddress[4], serverAddress[5]);
-  Serial.printf("   Server MAC: %s\n", serverMAC);
+#if STORE_FORWARD
+  // Whatever is unacknowledged at sleep stays in (or, for this wake's reading, goes to) flash
+  sendWindow.dropAll();
+  processSendStatus();
+  settleStoredBatch();
+#endif
   
-  return true;
+#if BENCHMARK_MODE
+  // Counters accumulate in RTC memory across wakes
+  bench.onAcksLost();
+  if (bootCount % BENCH_REPORT_CYCLES == 0) {
+    printBenchmark();
+  }
+#endif
+  
+  adaptReportInterval(reading);
+  enterDeepSleep();
 }
 
 /**
- * @brief Send sensor data via ESP-NOW to receiver
+ * @brief Warm-boot path after a timer wake: no banner, no settle delays
+ *
+ * The DHT22 stays powered through deep sleep, so it needs no stabilization
+ * wait. Falls back to the full initESPNow() if the fast bring-up fails.
  */
-void sendData() {
-  if (!espNowConnected) {
-    Serial.println("⚠️  ESP-NOW not connected! Skipping transmission...");
-    return;
-  }
+void warmBoot() {
+  cacheDeviceMac();
+  initCrypto();
+  
+  dht.begin();
+  initMqSensor();
+#if STORE_FORWARD
+  initStoreForward();
+#endif
   
-  Serial.println("\n📤 Sending data to receiver...");
+#if DEADBAND_MODE
+  // Read first: a reading inside the deadband needs no radio at all
+  dht.waitForSample(DHT_WAKE_TIMEOUT_MS);
+  sensor_data reading = readSensors();
+  bool report = reportDue(reading);
+  bool backlog = false;
+#if STORE_FORWARD
+  backlog = flashLog.count() > 0;
+#endif
+  if (!report && !backlog) {
+    adaptReportInterval(reading);
+    enterDeepSleep();  // Does not return
+  }
   
-  esp_err_t result = esp_now_send(serverAddress, (uint8_t *)&sensorData, sizeof(sensorData));
+  if (!initESPNowFast()) {
+    LOG_WARN("⚠️  Fast ESP-NOW start failed, doing full init\n");
+    initESPNow();
+  }
+  runDutyCycle(reading, report);  // Does not return
+#else
+  // The DHT22 conversion runs in the background during the radio bring-up
+  dht.poll();
   
-  if (result == ESP_OK) {
-    Serial.println("✅ Data queued for transmission");
-  } else {
-    Serial.printf("❌ Error sending data (Error code: 0x%X)\n", result);
-    failureCount++;
+  if (!initESPNowFast()) {
+    LOG_WARN("⚠️  Fast ESP-NOW start failed, doing full init\n");
+    initESPNow();
   }
+  
+  dht.waitForSample(DHT_WAKE_TIMEOUT_MS);
+  sensor_data reading = readSensors();
+  runDutyCycle(reading, reportDue(reading));  // Does not return
+#endif
 }
 
 // ==================== SETUP ====================
 
 void setup() {
   Serial.begin(115200);
+  bootCount++;
+  restoreCounters();
+  initPeers();
+  
+#if DEEP_SLEEP_MODE
+  // Reuse the channel/peer from before the last sleep and skip the cold-boot path
+  if (esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER && restoreLinkState()) {
+    LOG_INFO("\n⏰ Wake #%lu (sent %lu ok / %lu failed)\n", (unsigned long)bootCount,
+             (unsigned long)successCount.load(), (unsigned long)failureCount.load());
+    warmBoot();  // Does not return
+  }
+#endif
+  
   delay(1000);
   
-  Serial.println("\n========================================");
-  Serial.println("   ESP32 SENDER - DATA LOGGER");
-  Serial.println("========================================\n");
+  LOG_INFO("\n========================================\n");
+  LOG_INFO("   ESP32 SENDER - DATA LOGGER\n");
+  LOG_INFO("========================================\n\n");
+  
+  // Cache the device MAC for the sampling/send paths
+  cacheDeviceMac();
+  initCrypto();
+#if REMOTE_CONTROL
+  loadRemoteConfig();
+#endif
   
   // Initialize random seed for simulated sensor data
   randomSeed(analogRead(0));
   
   // Initialize DHT22 sensor
   dht.begin();
-  Serial.println("✅ DHT22 Sensor Initialized");
+  LOG_INFO("✅ DHT22 Sensor Initialized\n");
   
   // Wait for DHT22 to stabilize
-  Serial.println("⏳ Waiting for DHT22 to stabilize (2 seconds)...");
+  LOG_INFO("⏳ Waiting for DHT22 to stabilize (2 seconds)...\n");
   delay(2000);
   
-  // Configure MQ sensor pin
-  pinMode(MQ_PIN, INPUT);
+  // Configure MQ sensor pin and ADC
+  initMqSensor();
   
-  // Configure ADC resolution (12-bit by default)
-  analogReadResolution(12);
-  analogSetAttenuation(ADC_11db);  // Full range: 0-3.3V
+  LOG_INFO("✅ MQ Sensor Pin Configured (ADC1_CH6)\n");
+  LOG_INFO("   Note: Using GPIO34 (ADC1) - Safe with WiFi\n");
+  if (mqAdc.running()) {
+    LOG_INFO("   Continuous DMA sampling at %d Hz\n", MQ_ADC_SAMPLE_FREQ_HZ);
+  }
+  
+  // Clock scaling and light sleep between loop passes (no-op unless POWER_SAVE_MODE)
+  initPowerSave();
   
-  Serial.println("✅ MQ Sensor Pin Configured (ADC1_CH6)");
-  Serial.println("   Note: Using GPIO34 (ADC1) - Safe with WiFi");
+#if !DEEP_SLEEP_MODE
+  // A pulse reading needs seconds of continuous sampling: not started when
+  // the node sleeps between readings, so the sensor stays in its idle state
+  initPulseOximeter();
+#endif
+  
+#if STORE_FORWARD
+  // Readings stored before a reboot are drained once ESP-NOW is up
+  initStoreForward();
+#endif
+  
+#if AUTO_PAIRING
+  // Gateway/channel cached by an earlier scan, or scan now on first boot
+  if (!loadPairing()) {
+    scanForGateway();
+  }
+#endif
   
   // Print device MAC address
-  Serial.println("\n📱 Device Information:");
-  Serial.printf("   MAC Address: %s\n", getMacAddress().c_str());
-  Serial.printf("   WiFi Channel: %d\n", WIFI_CHANNEL);
+  LOG_INFO("\n📱 Device Information:\n");
+  LOG_INFO("   MAC Address: %s\n", deviceMacStr);
+  LOG_INFO("   WiFi Channel: %d\n", wifiChannel);
   
   // Initialize ESP-NOW with retry logic
   bool initSuccess = false;
   for (int attempt = 1; attempt <= MAX_INIT_RETRIES; attempt++) {
-    Serial.printf("\n🔄 ESP-NOW Init Attempt %d/%d\n", attempt, MAX_INIT_RETRIES);
+    LOG_INFO("\n🔄 ESP-NOW Init Attempt %d/%d\n", attempt, MAX_INIT_RETRIES);
     
     if (initESPNow()) {
       initSuccess = true;
@@ -290,62 +2859,173 @@ void setup() {
     }
     
     if (attempt < MAX_INIT_RETRIES) {
-      Serial.println("⏳ Retrying in 2 seconds...");
+      LOG_INFO("⏳ Retrying in 2 seconds...\n");
       delay(2000);
     }
   }
   
+#if REMOTE_CONTROL
+  if (initSuccess) {
+    // An updated image got as far as the radio: keep it (with rollback enabled)
+    esp_ota_mark_app_valid_cancel_rollback();
+  }
+#endif
+  
   if (!initSuccess) {
-    Serial.println("\n❌❌❌ ESP-NOW INITIALIZATION FAILED AFTER ALL RETRIES ❌❌❌");
-    Serial.println("Please check:");
-    Serial.println("  1. Server MAC address is correct");
-    Serial.println("  2. Receiver is powered on and initialized");
-    Serial.println("  3. Both devices use the same WiFi channel");
-    Serial.println("\n⚠️  Device will continue but data transmission will fail!");
-  }
-  
-  Serial.println("\n========================================");
-  Serial.println(initSuccess ? "   SENDER READY!" : "   SENDER RUNNING (ESP-NOW FAILED)");
-  Serial.println("========================================");
-  Serial.printf("\n⏱️  Sending data every %lu seconds\n\n", SEND_INTERVAL / 1000);
-  
-  // Initialize sensor data structure with defaults
-  sensorData.temperature = 0.0;
-  sensorData.humidity = 0.0;
-  sensorData.mq_value = 0;
-  sensorData.heartRate = 0.0;
-  sensorData.spo2 = 0.0;
+    LOG_ERROR("\n❌❌❌ ESP-NOW INITIALIZATION FAILED AFTER ALL RETRIES ❌❌❌\n");
+    LOG_INFO("Please check:\n");
+    LOG_INFO("  1. Server MAC address is correct\n");
+    LOG_INFO("  2. Receiver is powered on and initialized\n");
+    LOG_INFO("  3. Both devices use the same WiFi channel\n");
+    LOG_WARN("\n⚠️  Device will continue but data transmission will fail!\n");
+  }
+  
+  LOG_INFO("\n========================================\n");
+  LOG_INFO("%s\n", initSuccess ? "   SENDER READY!" : "   SENDER RUNNING (ESP-NOW FAILED)");
+  LOG_INFO("========================================\n");
+  LOG_INFO("\n⏱️  Sending data every %lu seconds\n\n", reportInterval() / 1000);
   
   // Perform initial sensor reading
-  Serial.println("📊 Performing initial sensor reading...");
-  readSensors();
+  LOG_INFO("📊 Performing initial sensor reading...\n");
+  dht.waitForSample(DHT_WAKE_TIMEOUT_MS);
+#if DEEP_SLEEP_MODE
+  sensor_data reading = readSensors();
+  runDutyCycle(reading, reportDue(reading));  // Does not return
+#else
+  readSensors();  // Primes latestSample
+#endif
+
+  initReportSchedule();
+#if AGGREGATE_MODE
+  aggregator.reset(millis());
+#endif
+  
+#if PIPELINE_MODE
+  startPipeline();
+#endif
+  cpuIdle();
 }
 
 // ==================== LOOP ====================
 
 void loop() {
+#if PIPELINE_MODE
+  // All work happens in the pipeline tasks
+  vTaskDelete(NULL);
+#endif
+  
+  uint32_t passStart = micros();
+  cpuBusy();
+  
+  // Keep the background DHT22 conversions going and drain the MAX30102 FIFO
+  dht.poll();
+  holdAwakeForSensors();
+  oximeter.poll();
+  
+  // Account for delivery reports and restart the link if it died
+  processSendStatus();
+  serviceLinkRecovery();
+  serviceBenchmark();
+  
+  // Config and firmware updates from the gateway
+  serviceControl();
+  
+#if STORE_FORWARD
+  // Link is back: drain readings stored during the outage
+  drainStoredBacklog();
+#endif
+  
   unsigned long currentTime = millis();
   
-  // Handle millis() overflow (occurs after ~49 days)
-  if (currentTime < lastSendTime) {
-    lastSendTime = currentTime;
+#if BATCH_MODE && !PIPELINE_MODE
+  if (currentTime < lastSampleTime) {
+    lastSampleTime = currentTime;
+  }
+  
+  // Sample at the fast rate into the ring buffer
+  if (currentTime - lastSampleTime >= SAMPLE_INTERVAL) {
+    lastSampleTime = currentTime;
+    
+    sensor_data reading = readSensors();
+    checkAnomaly(reading);
+    
+    // Deadband mode: readings inside the deadband are not buffered at all
+    bool handled = !reportDue(reading);
+#if STORE_FORWARD
+    // Outage or backlog still draining: the RAM buffer joins the flash log
+    if (!handled && storeForwardActive()) {
+      spillSampleRing();
+      handled = storeForLater(reading);
+    }
+#endif
+    
+    if (!handled) {
+      // Keep the newest readings if the link has been down for a while
+      if (sampleRing.full()) {
+        sampleRing.drop(1);
+      }
+      sampleRing.push(reading);
+    }
+    
+    // A full frame goes out right away
+    if (sampleRing.size() >= BATCH_MAX_SAMPLES) {
+      flushBatch(reading);
+    }
+  }
+  
+  // Partial batches go out in this node's report slot
+  if (reportSlotDue(currentTime) && !sampleRing.empty()) {
+    flushBatch(latestSample.load());
+  }
+#elif AGGREGATE_MODE
+  // Every fast-rate reading goes into the window statistics
+  if (currentTime - lastAggregateSample >= AGGREGATE_SAMPLE_MS) {
+    lastAggregateSample = currentTime;
+    sensor_data reading = readSensors();
+    checkAnomaly(reading);
+    aggregator.add(reading);
   }
   
-  // Check if it's time to send data
-  if (currentTime - lastSendTime >= SEND_INTERVAL) {
-    lastSendTime = currentTime;
+  // One summary per report slot
+  if (reportSlotDue(currentTime)) {
+    adaptReportInterval(latestSample.load());
+    sendSummary(currentTime);
     
+    LOG_DEBUG("\n📊 Connection Status: %s\n", 
+                  espNowConnected.load(std::memory_order_relaxed) ? "✅ Connected" : "❌ Disconnected");
+  }
+#else
+#if ANOMALY_WATCH
+  // Between reports, readings only feed the anomaly check
+  if (currentTime - lastWatchTime >= ANOMALY_WATCH_MS) {
+    lastWatchTime = currentTime;
+    checkAnomaly(readSensors(true));
+  }
+#endif
+  
+  // Check if it's time to send data (this node's slot, plus jitter)
+  if (reportSlotDue(currentTime)) {
     // Read all sensors
-    readSensors();
+    sensor_data reading = readSensors();
+    checkAnomaly(reading);
+    adaptReportInterval(reading);
     
-    // Send data via ESP-NOW
-    sendData();
+    // Send data via ESP-NOW (unless the deadband suppresses it)
+    if (reportDue(reading)) {
+      sendData(reading);
+    }
     
     // Print connection status
-    Serial.printf("\n📊 Connection Status: %s\n", 
-                  espNowConnected ? "✅ Connected" : "❌ Disconnected");
+    LOG_DEBUG("\n📊 Connection Status: %s\n", 
+                  espNowConnected.load(std::memory_order_relaxed) ? "✅ Connected" : "❌ Disconnected");
   }
+#endif
+  
+  health.onLoopPass(micros() - passStart);
   
-  // Small delay for stability and to prevent watchdog reset
-  delay(50);
+  // Small delay for stability and to prevent watchdog reset; with
+  // POWER_SAVE_MODE the chip light-sleeps through it. Broadcast update
+  // chunks arrive faster than that, so they are drained more often.
+  cpuIdle();
+  delay(remoteBusy() ? CONTROL_POLL_MS : 50);
 }
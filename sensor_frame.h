@@ -0,0 +1,1031 @@
+#ifndef SENSOR_FRAME_H
+#define SENSOR_FRAME_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include "sensor_registry.h"
+
+// ==================== WIRE FORMAT ====================
+//
+// Every ESP-NOW payload starts with a fixed 13-byte header, all fields
+// little-endian:
+//
+//   [0]      version (high nibble) | frame type (low nibble)
+//   [1..6]   sender MAC address (binary)
+//   [7..8]   frame sequence number
+//   [9..12]  base timestamp (sender millis() of the first sample)
+//
+// A FRAME_SAMPLE body is a single 10-byte sample record:
+//
+//   [0..1]   timestamp delta from the frame base (ms)
+//   [2..9]   64-bit packed readings, LSB first:
+//              bits  0-15  temperature  int16   0.01 °C
+//              bits 16-31  humidity     uint16  0.01 %
+//              bits 32-43  mq_value     uint12  raw ADC
+//              bits 44-55  heartRate    uint12  0.1 bpm
+//              bits 56-63  spo2         uint8   0.5 %
+//
+// The packed readings are generated from the channel list (SampleLayout,
+// below): the table above is the current list. Channels added to it extend
+// the record, and FRAME_SAMPLE_SIZE with it.
+//
+// A FRAME_BATCH body is a 1-byte sample count followed by that many sample
+// records, all relative to the same base timestamp.
+//
+// A FRAME_DELTA body is a 1-byte sample count, one full sample record (the
+// keyframe, delta 0) and then one delta record per further sample:
+//
+//   [0]      change mask: bit 0 timing, bits 1-5 temperature .. spo2
+//   [1..]    one zigzag varint per set bit, in bit order
+//
+// Readings are predicted to equal the previous sample (in fixed point), the
+// timestamp to advance by the previous interval; only the prediction errors
+// are sent. Every delta frame starts from its own keyframe, so a lost frame
+// never corrupts the next one.
+//
+// Pairing uses two control frames. A sender looking for a gateway
+// broadcasts a header-only FRAME_DISCOVER on each channel in turn, with a
+// random nonce in place of the timestamp. Every gateway that hears it
+// answers with a FRAME_BEACON:
+//
+//   [0]      Wi-Fi channel the gateway listens on
+//   [1..16]  tag over the beacon, the discovering sender's MAC and its nonce
+//            (signBeaconFrame() in frame_crypto.h)
+//
+// A gateway may also hand out TDMA slots with a FRAME_SLOT:
+//
+//   [0]      slot index
+//   [1]      slot count per reporting interval
+//   [2..3]   phase: ms since the gateway's current interval started
+//
+// A FRAME_SUMMARY replaces the samples of one reporting window with their
+// statistics. Its base timestamp is the start of the window:
+//
+//   [0..3]   window length (ms)
+//   then for each channel (temperature, humidity, mq_value, heartRate, spo2):
+//   [0..1]   sample count (0: no valid reading, the other fields are 0)
+//   [2..9]   mean, min, max, standard deviation; int16 each, scaled by the
+//            channel's summary scale (100, 100, 1, 10 and 100 respectively)
+//
+// A FRAME_ALARM reports an anomaly as soon as the sender detects it, outside
+// the reporting schedule. Its base timestamp is that of the reading:
+//
+//   [0]      channels in alarm, bit i = sample_fixed field i
+//   [1..10]  sample record of the reading that raised it
+//
+// Alarms are numbered in their own sequence, so a gateway's loss accounting
+// for the regular frames is unaffected.
+//
+// The gateway controls its senders with five more frames. A FRAME_CONFIG,
+// unicast to one sender, carries settings for it to store in NVS:
+//
+//   [0..3]   config version (per gateway, increasing; older ones are not applied)
+//   [4..]    items: key, value length, value (little-endian), see frame_config_key
+//
+// The sender answers with a FRAME_CONFIG_ACK:
+//
+//   [0..3]   config version
+//   [4]      result (frame_config_result)
+//
+// A firmware update is offered with a FRAME_OTA_OFFER and sent as
+// FRAME_OTA_CHUNKs broadcast to every sender at once (see ota_image.h):
+//
+//   offer    [0..3]  image id   [4..7]  image size (bytes)
+//            [8..39] SHA-256 of image id, size and image (ota_image.h)
+//            [40]    signature length
+//            [41..]  ECDSA P-256 signature of that hash, DER (up to
+//                    FRAME_OTA_SIG_MAX bytes)
+//   chunk    [0..3]  image id   [4..5]  chunk index
+//            [6..]   FRAME_OTA_CHUNK_SIZE bytes of image (less in the last chunk)
+//
+// Senders report their progress with a FRAME_OTA_STATUS:
+//
+//   [0..3]   image id
+//   [4]      state (frame_ota_state)
+//   [5..6]   chunks stored
+//   [7..]    incomplete sectors, one bit per 4 KB of image (bit 0 of byte 0
+//            is the first sector)
+//
+// Each of these five ends with a FRAME_CONTROL_TAG_SIZE tag: HMAC-SHA256
+// over everything before it, truncated (frame_crypto.h). The key is the
+// sender's control key, except for chunks, which every sender receives and
+// which carry a tag under the fleet chunk key. The encoders leave room for
+// the tag and return the length before it.
+//
+// Control frames carry no readings and use the gateway's (or, for replies,
+// the sender's) own sequence numbers.
+//
+// FRAME_SEALED wraps any of the above in AES-GCM (see frame_crypto.h).
+//
+// Any frame that carries samples or a summary may end with a health trailer, so a gateway
+// can chart each node's link without a serial cable. It follows the last
+// sample record, where decoders that do not know it stop reading:
+//
+//   [0]      trailer type (FRAME_TRAILER_HEALTH)
+//   [1..4]   frames delivered, total
+//   [5..8]   frames failed, total
+//   [9..10]  send window retransmissions, total (saturating)
+//   [11..12] frames dropped after the last retry, total (saturating)
+//   [13]     ack rate since the previous trailer, % (255: nothing sent)
+//   [14]     frames queued or in flight
+//   [15]     RSSI heard from the receiver, dBm (0: not heard)
+//   [16..17] free heap, 16-byte units (saturating)
+//   [18..19] longest main loop pass since the previous trailer, 0.1 ms
+//   [20..21] boot or wake to first transmission, ms
+//
+// Shared by the sender and the receiver so both sides stay in lockstep.
+
+#define FRAME_VERSION 1
+
+#define FRAME_HEADER_SIZE 13
+#define FRAME_SAMPLE_SIZE ((int)(2 + SampleLayout::packedBytes))  // 10
+#define FRAME_BATCH_COUNT_SIZE 1
+
+// ESP-NOW payload limit (ESP_NOW_MAX_DATA_LEN)
+#define FRAME_MAX_SIZE 250
+
+// Most sample records that fit in one FRAME_BATCH (23)
+#define FRAME_BATCH_MAX_SAMPLES \
+  ((FRAME_MAX_SIZE - FRAME_HEADER_SIZE - FRAME_BATCH_COUNT_SIZE) / FRAME_SAMPLE_SIZE)
+
+// Most samples the decoder accepts in one FRAME_DELTA
+#define FRAME_DELTA_MAX_SAMPLES 128
+
+// Largest delta record: mask + five-byte timing varint + readings (18)
+#define FRAME_DELTA_RECORD_MAX (1 + 5 + SampleLayout::deltaBytes)
+
+enum frame_type : uint8_t {
+  FRAME_SAMPLE = 1,
+  FRAME_BATCH = 2,
+  FRAME_DELTA = 3,
+  FRAME_DISCOVER = 4,
+  FRAME_BEACON = 5,
+  FRAME_SLOT = 6,
+  FRAME_SEALED = 7,
+  FRAME_SUMMARY = 8,
+  FRAME_ALARM = 9,
+  FRAME_CONFIG = 10,
+  FRAME_CONFIG_ACK = 11,
+  FRAME_OTA_OFFER = 12,
+  FRAME_OTA_CHUNK = 13,
+  FRAME_OTA_STATUS = 14,
+};
+
+enum frame_config_key : uint8_t {
+  CONFIG_REPORT_INTERVAL = 1,  // uint32, ms
+  CONFIG_WIFI_CHANNEL = 2,     // uint8, 1-13
+  CONFIG_GATEWAY = 3,          // 6-byte MAC of the gateway to report to
+};
+
+enum frame_config_result : uint8_t {
+  CONFIG_APPLIED = 0,
+  CONFIG_STALE = 1,     // Version already applied (a repeat): nothing changed
+  CONFIG_REJECTED = 2,  // Unknown key or value out of range: nothing changed
+};
+
+enum frame_ota_state : uint8_t {
+  OTA_IDLE = 0,       // Not taking part (stalled, or between offers)
+  OTA_RECEIVING = 1,
+  OTA_DONE = 2,       // Image verified and set to boot, or already running
+  OTA_FAILED = 3,     // Doesn't fit, failed verification or older than the running image
+};
+
+#define FRAME_BEACON_TAG_SIZE 16
+#define FRAME_BEACON_SIZE (FRAME_HEADER_SIZE + 1 + FRAME_BEACON_TAG_SIZE)
+#define FRAME_SLOT_SIZE (FRAME_HEADER_SIZE + 4)
+
+#define FRAME_ALARM_SIZE (FRAME_HEADER_SIZE + 1 + FRAME_SAMPLE_SIZE)
+
+#define FRAME_SUMMARY_CHANNEL_SIZE 10
+#define FRAME_SUMMARY_SIZE (FRAME_HEADER_SIZE + 4 + FRAME_FIELD_COUNT * FRAME_SUMMARY_CHANNEL_SIZE)
+
+#define FRAME_CONTROL_TAG_SIZE 16
+#define FRAME_CONFIG_ITEMS_MAX 32  // Item bytes per FRAME_CONFIG
+#define FRAME_CONFIG_ACK_SIZE (FRAME_HEADER_SIZE + 5 + FRAME_CONTROL_TAG_SIZE)
+
+#define FRAME_OTA_CHUNK_SIZE 128  // Image bytes per chunk: 32 chunks per flash sector
+#define FRAME_OTA_SIG_MAX 72  // DER ECDSA P-256 signature
+#define FRAME_OTA_OFFER_SIZE(sigBytes) (FRAME_HEADER_SIZE + 41 + (sigBytes) + FRAME_CONTROL_TAG_SIZE)
+#define FRAME_OTA_CHUNK_HEADER_SIZE (FRAME_HEADER_SIZE + 6)
+#define FRAME_OTA_CHUNK_MAX_SIZE (FRAME_OTA_CHUNK_HEADER_SIZE + FRAME_OTA_CHUNK_SIZE + FRAME_CONTROL_TAG_SIZE)
+#define FRAME_OTA_STATUS_SIZE(mapBytes) (FRAME_HEADER_SIZE + 7 + (mapBytes) + FRAME_CONTROL_TAG_SIZE)
+
+#define FRAME_TRAILER_HEALTH 1
+#define FRAME_HEALTH_SIZE 22
+#define FRAME_HEALTH_NO_RATE 255
+
+// ==================== DATA STRUCTURES ====================
+
+typedef struct sensor_data {
+  float temperature;
+  float humidity;
+  int mq_value;
+  float heartRate;
+  float spo2;
+  unsigned long timestamp;
+} sensor_data;
+
+// ==================== SAMPLE LAYOUT ====================
+//
+// The channels of a sample record, in wire order (see sensor_registry.h).
+// Each one gives its sensor_data member, wire width, fixed-point range,
+// scale and summary scale. The packed record, the delta codec, summaries,
+// alarm masks, the sender's Serial print and the gateway's CSV columns all
+// follow this list.
+
+struct temperature_channel
+    : SensorChannel<sensor_data, float, &sensor_data::temperature, 16, INT16_MIN, INT16_MAX, 100, 100> {
+  static constexpr const char *name = "temperature";
+  static constexpr const char *label = "🌡️  Temperature ";
+  static constexpr const char *unit = "°C";
+  static constexpr int precision = 2;
+};
+
+struct humidity_channel
+    : SensorChannel<sensor_data, float, &sensor_data::humidity, 16, 0, 10000, 100, 100> {
+  static constexpr const char *name = "humidity";
+  static constexpr const char *label = "💧 Humidity    ";
+  static constexpr const char *unit = "%";
+  static constexpr int precision = 2;
+};
+
+struct mq_channel
+    : SensorChannel<sensor_data, int, &sensor_data::mq_value, 12, 0, 0xFFF, 1, 1> {
+  static constexpr const char *name = "mq_value";
+  static constexpr const char *label = "🌫️  Gas Level   ";
+  static constexpr const char *unit = "(Raw ADC)";
+  static constexpr int precision = 0;
+};
+
+// Heart rate and SpO2 read 0 while no finger is on the oximeter
+struct heart_rate_channel
+    : SensorChannel<sensor_data, float, &sensor_data::heartRate, 12, 0, 0xFFF, 10, 10, true> {
+  static constexpr const char *name = "heartRate";
+  static constexpr const char *label = "❤️  Heart Rate  ";
+  static constexpr const char *unit = "bpm";
+  static constexpr int precision = 1;
+};
+
+struct spo2_channel
+    : SensorChannel<sensor_data, float, &sensor_data::spo2, 8, 0, 0xFF, 2, 100, true> {
+  static constexpr const char *name = "spo2";
+  static constexpr const char *label = "🩺 SpO2        ";
+  static constexpr const char *unit = "%";
+  static constexpr int precision = 1;
+};
+
+using SampleLayout = SensorRegistry<temperature_channel, humidity_channel, mq_channel,
+                                    heart_rate_channel, spo2_channel>;
+
+// FRAME_DELTA change masks have a bit per channel after the timing bit
+static_assert(SampleLayout::count <= 7, "FRAME_DELTA masks hold at most 7 channels");
+
+// Readings in wire fixed point, in SampleLayout order
+#define FRAME_FIELD_COUNT ((int)SampleLayout::count)
+
+typedef struct sample_fixed {
+  uint32_t timestamp;
+  int32_t field[FRAME_FIELD_COUNT];
+} sample_fixed;
+
+typedef struct health_record {
+  uint32_t acked;
+  uint32_t failed;
+  uint32_t retransmits;
+  uint32_t dropped;
+  uint8_t ackRate;     // %, FRAME_HEALTH_NO_RATE if nothing was sent
+  uint8_t queueDepth;
+  int8_t rssi;         // dBm, 0 if not heard
+  uint32_t freeHeap;   // Bytes
+  uint32_t loopMaxUs;
+  uint32_t wakeMs;
+} health_record;
+
+typedef struct channel_summary {
+  uint16_t count;
+  float mean;
+  float min;
+  float max;
+  float stddev;
+} channel_summary;
+
+// Statistics of one reporting window, channels in sample_fixed field order
+typedef struct sensor_summary {
+  uint32_t startMs;
+  uint32_t windowMs;
+  channel_summary channel[FRAME_FIELD_COUNT];
+} sensor_summary;
+
+typedef struct frame_header {
+  uint8_t version;
+  uint8_t type;
+  uint8_t mac[6];
+  uint16_t seq;
+  uint32_t baseTimestamp;
+} frame_header;
+
+// ==================== BYTE HELPERS ====================
+
+inline void framePut16(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+inline void framePut32(uint8_t *p, uint32_t v) {
+  framePut16(p, (uint16_t)v);
+  framePut16(p + 2, (uint16_t)(v >> 16));
+}
+
+inline uint16_t frameGet16(const uint8_t *p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+inline uint32_t frameGet32(const uint8_t *p) {
+  return (uint32_t)frameGet16(p) | ((uint32_t)frameGet16(p + 2) << 16);
+}
+
+inline uint16_t frameSat16(uint32_t v) {
+  return v > 0xFFFF ? 0xFFFF : (uint16_t)v;
+}
+
+/**
+ * @brief Scales a reading to fixed point, rounding and clamping to [lo, hi]
+ */
+inline int32_t frameQuantize(float value, float scale, int32_t lo, int32_t hi) {
+  if (isnan(value)) return lo;
+  float scaled = roundf(value * scale);
+  if (scaled < (float)lo) return lo;
+  if (scaled > (float)hi) return hi;
+  return (int32_t)scaled;
+}
+
+/**
+ * @brief Maps signed values onto unsigned ones, small magnitudes first
+ */
+inline uint32_t frameZigzag(int32_t v) {
+  return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+inline int32_t frameUnzigzag(uint32_t v) {
+  return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+/**
+ * @brief Writes v as a LEB128 varint (7 bits per byte), returns its length
+ */
+inline size_t framePutVarint(uint8_t *p, uint32_t v) {
+  size_t n = 0;
+  while (v >= 0x80) {
+    p[n++] = (uint8_t)(v | 0x80);
+    v >>= 7;
+  }
+  p[n++] = (uint8_t)v;
+  return n;
+}
+
+/**
+ * @brief Reads a varint written by framePutVarint()
+ * @return Bytes read, or 0 if it runs past end or is over-long
+ */
+inline size_t frameGetVarint(const uint8_t *p, const uint8_t *end, uint32_t &v) {
+  v = 0;
+  for (size_t n = 0; n < 5 && p + n < end; n++) {
+    v |= (uint32_t)(p[n] & 0x7F) << (7 * n);
+    if ((p[n] & 0x80) == 0) return n + 1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Converts a reading to wire fixed point (same rounding and clamping as the records)
+ */
+inline void frameToFixed(const sensor_data &s, sample_fixed &f) {
+  f.timestamp = (uint32_t)s.timestamp;
+  SampleLayout::toFixed(s, f.field);
+}
+
+inline void frameFromFixed(const sample_fixed &f, sensor_data &s) {
+  s.timestamp = f.timestamp;
+  SampleLayout::fromFixed(f.field, s);
+}
+
+// ==================== ENCODE / DECODE ====================
+
+/**
+ * @brief Writes the common frame header, returns FRAME_HEADER_SIZE
+ */
+inline size_t encodeFrameHeader(uint8_t *buf, uint8_t type, const uint8_t mac[6],
+                                uint16_t seq, uint32_t baseTimestamp) {
+  buf[0] = (uint8_t)((FRAME_VERSION << 4) | (type & 0x0F));
+  memcpy(buf + 1, mac, 6);
+  framePut16(buf + 7, seq);
+  framePut32(buf + 9, baseTimestamp);
+  return FRAME_HEADER_SIZE;
+}
+
+/**
+ * @brief Parses the common frame header
+ * @return false if the buffer is too short or the version is unknown
+ */
+inline bool decodeFrameHeader(const uint8_t *buf, size_t len, frame_header &hdr) {
+  if (len < FRAME_HEADER_SIZE) return false;
+  hdr.version = buf[0] >> 4;
+  hdr.type = buf[0] & 0x0F;
+  if (hdr.version != FRAME_VERSION) return false;
+  memcpy(hdr.mac, buf + 1, 6);
+  hdr.seq = frameGet16(buf + 7);
+  hdr.baseTimestamp = frameGet32(buf + 9);
+  return true;
+}
+
+/**
+ * @brief Encodes a gateway's answer to FRAME_DISCOVER, less its tag
+ * @return Frame length before the tag (see signBeaconFrame()), or 0 if the buffer is too small
+ */
+inline size_t encodeBeaconFrame(uint8_t *buf, size_t len, const uint8_t mac[6],
+                                uint16_t seq, uint8_t channel) {
+  if (len < FRAME_BEACON_SIZE) return 0;
+  size_t n = encodeFrameHeader(buf, FRAME_BEACON, mac, seq, 0);
+  buf[n++] = channel;
+  return n;
+}
+
+/**
+ * @brief Decodes a FRAME_BEACON
+ * @return false if the frame is malformed or of another type
+ */
+inline bool decodeBeaconFrame(const uint8_t *buf, size_t len, frame_header &hdr, uint8_t &channel) {
+  if (!decodeFrameHeader(buf, len, hdr)) return false;
+  if (hdr.type != FRAME_BEACON || len < FRAME_BEACON_SIZE) return false;
+  channel = buf[FRAME_HEADER_SIZE];
+  return true;
+}
+
+/**
+ * @brief Encodes a gateway's slot assignment for one sender
+ * @return Frame length in bytes, or 0 if the buffer is too small
+ */
+inline size_t encodeSlotFrame(uint8_t *buf, size_t len, const uint8_t mac[6], uint16_t seq,
+                              uint8_t slot, uint8_t slots, uint16_t phaseMs) {
+  if (len < FRAME_SLOT_SIZE) return 0;
+  size_t n = encodeFrameHeader(buf, FRAME_SLOT, mac, seq, 0);
+  buf[n++] = slot;
+  buf[n++] = slots;
+  framePut16(buf + n, phaseMs);
+  return n + 2;
+}
+
+/**
+ * @brief Decodes a FRAME_SLOT
+ * @return false if the frame is malformed, of another type or the slot is out of range
+ */
+inline bool decodeSlotFrame(const uint8_t *buf, size_t len, frame_header &hdr,
+                            uint8_t &slot, uint8_t &slots, uint16_t &phaseMs) {
+  if (!decodeFrameHeader(buf, len, hdr)) return false;
+  if (hdr.type != FRAME_SLOT || len < FRAME_SLOT_SIZE) return false;
+  slot = buf[FRAME_HEADER_SIZE];
+  slots = buf[FRAME_HEADER_SIZE + 1];
+  phaseMs = frameGet16(buf + FRAME_HEADER_SIZE + 2);
+  return slots > 0 && slot < slots;
+}
+
+/**
+ * @brief Packs one sample record relative to the frame base timestamp
+ */
+inline void encodeSampleRecord(uint8_t *buf, const sensor_data &s, uint32_t baseTimestamp) {
+  sample_fixed f;
+  frameToFixed(s, f);
+
+  uint32_t delta = f.timestamp - baseTimestamp;
+  framePut16(buf, delta > 0xFFFF ? 0xFFFF : (uint16_t)delta);
+
+  uint64_t bits = SampleLayout::pack(f.field);
+  for (size_t i = 0; i < SampleLayout::packedBytes; i++) {
+    buf[2 + i] = (uint8_t)(bits >> (8 * i));
+  }
+}
+
+/**
+ * @brief Unpacks one sample record into wire fixed point
+ */
+inline void decodeSampleFixed(const uint8_t *buf, uint32_t baseTimestamp, sample_fixed &f) {
+  uint64_t bits = 0;
+  for (size_t i = 0; i < SampleLayout::packedBytes; i++) {
+    bits |= (uint64_t)buf[2 + i] << (8 * i);
+  }
+
+  f.timestamp = baseTimestamp + frameGet16(buf);
+  SampleLayout::unpack(bits, f.field);
+}
+
+/**
+ * @brief Unpacks one sample record back into engineering units
+ */
+inline void decodeSampleRecord(const uint8_t *buf, uint32_t baseTimestamp, sensor_data &s) {
+  sample_fixed f;
+  decodeSampleFixed(buf, baseTimestamp, f);
+  frameFromFixed(f, s);
+}
+
+/**
+ * @brief Encodes a single-sample frame
+ * @return Frame length in bytes, or 0 if the buffer is too small
+ */
+inline size_t encodeSampleFrame(uint8_t *buf, size_t len, const uint8_t mac[6],
+                                uint16_t seq, const sensor_data &s) {
+  if (len < FRAME_HEADER_SIZE + FRAME_SAMPLE_SIZE) return 0;
+  size_t n = encodeFrameHeader(buf, FRAME_SAMPLE, mac, seq, (uint32_t)s.timestamp);
+  encodeSampleRecord(buf + n, s, (uint32_t)s.timestamp);
+  return n + FRAME_SAMPLE_SIZE;
+}
+
+/**
+ * @brief Decodes a single-sample frame
+ * @return false if the frame is malformed or not a FRAME_SAMPLE
+ */
+inline bool decodeSampleFrame(const uint8_t *buf, size_t len, frame_header &hdr, sensor_data &s) {
+  if (!decodeFrameHeader(buf, len, hdr)) return false;
+  if (hdr.type != FRAME_SAMPLE || len < FRAME_HEADER_SIZE + FRAME_SAMPLE_SIZE) return false;
+  decodeSampleRecord(buf + FRAME_HEADER_SIZE, hdr.baseTimestamp, s);
+  return true;
+}
+
+/**
+ * @brief Encodes up to FRAME_BATCH_MAX_SAMPLES samples into one frame
+ *
+ * Samples must be in time order. The batch stops early at the first sample
+ * whose delta from the first one no longer fits in 16 bits.
+ *
+ * @param consumed Set to the number of samples actually packed
+ * @return Frame length in bytes, or 0 if nothing could be encoded
+ */
+inline size_t encodeBatchFrame(uint8_t *buf, size_t len, const uint8_t mac[6], uint16_t seq,
+                               const sensor_data *samples, size_t count, size_t &consumed) {
+  consumed = 0;
+  if (count == 0 || len < FRAME_HEADER_SIZE + FRAME_BATCH_COUNT_SIZE + FRAME_SAMPLE_SIZE) return 0;
+
+  uint32_t base = (uint32_t)samples[0].timestamp;
+  size_t fit = (len - FRAME_HEADER_SIZE - FRAME_BATCH_COUNT_SIZE) / FRAME_SAMPLE_SIZE;
+  if (fit > FRAME_BATCH_MAX_SAMPLES) fit = FRAME_BATCH_MAX_SAMPLES;
+
+  size_t n = encodeFrameHeader(buf, FRAME_BATCH, mac, seq, base);
+  uint8_t *countByte = buf + n;
+  n += FRAME_BATCH_COUNT_SIZE;
+
+  while (consumed < count && consumed < fit) {
+    if ((uint32_t)samples[consumed].timestamp - base > 0xFFFF) break;
+    encodeSampleRecord(buf + n, samples[consumed], base);
+    n += FRAME_SAMPLE_SIZE;
+    consumed++;
+  }
+
+  *countByte = (uint8_t)consumed;
+  return n;
+}
+
+/**
+ * @brief Encodes time-ordered samples into one delta-compressed frame
+ *
+ * Packs as many samples as fit in len (up to FRAME_DELTA_MAX_SAMPLES).
+ * Timestamps may wrap or step backwards (e.g. across a sender reboot):
+ * deltas are taken modulo 2^32, so they decode exactly.
+ *
+ * @param consumed Set to the number of samples actually packed
+ * @return Frame length in bytes, or 0 if nothing could be encoded
+ */
+inline size_t encodeDeltaFrame(uint8_t *buf, size_t len, const uint8_t mac[6], uint16_t seq,
+                               const sensor_data *samples, size_t count, size_t &consumed) {
+  consumed = 0;
+  if (count == 0 || len < FRAME_HEADER_SIZE + FRAME_BATCH_COUNT_SIZE + FRAME_SAMPLE_SIZE) return 0;
+
+  uint32_t base = (uint32_t)samples[0].timestamp;
+  size_t n = encodeFrameHeader(buf, FRAME_DELTA, mac, seq, base);
+  uint8_t *countByte = buf + n;
+  n += FRAME_BATCH_COUNT_SIZE;
+
+  // Keyframe
+  encodeSampleRecord(buf + n, samples[0], base);
+  n += FRAME_SAMPLE_SIZE;
+  sample_fixed prev;
+  frameToFixed(samples[0], prev);
+  uint32_t prevInterval = 0;
+  consumed = 1;
+
+  while (consumed < count && consumed < FRAME_DELTA_MAX_SAMPLES) {
+    sample_fixed cur;
+    frameToFixed(samples[consumed], cur);
+
+    uint8_t rec[FRAME_DELTA_RECORD_MAX];
+    uint8_t mask = 0;
+    size_t r = 1;
+    uint32_t interval = cur.timestamp - prev.timestamp;
+    if (interval != prevInterval) {
+      mask |= 1;
+      r += framePutVarint(rec + r, frameZigzag((int32_t)(interval - prevInterval)));
+    }
+    for (int i = 0; i < FRAME_FIELD_COUNT; i++) {
+      if (cur.field[i] == prev.field[i]) continue;
+      mask |= (uint8_t)(2 << i);
+      r += framePutVarint(rec + r, frameZigzag((int32_t)((uint32_t)cur.field[i] - (uint32_t)prev.field[i])));
+    }
+    rec[0] = mask;
+
+    if (n + r > len) break;
+    memcpy(buf + n, rec, r);
+    n += r;
+    prev = cur;
+    prevInterval = interval;
+    consumed++;
+  }
+
+  *countByte = (uint8_t)consumed;
+  return n;
+}
+
+/**
+ * @brief Decodes the samples of a FRAME_DELTA body (p points past the header)
+ * @return Number of samples written to out, or 0 if the body is malformed
+ */
+inline size_t decodeDeltaSamples(const uint8_t *p, const uint8_t *end, uint32_t baseTimestamp,
+                                 sensor_data *out, size_t maxOut, const uint8_t **stop = nullptr) {
+  if (end - p < FRAME_BATCH_COUNT_SIZE + FRAME_SAMPLE_SIZE) return 0;
+  size_t count = *p++;
+  if (count == 0 || count > maxOut) return 0;
+
+  sample_fixed cur;
+  decodeSampleFixed(p, baseTimestamp, cur);
+  p += FRAME_SAMPLE_SIZE;
+  frameFromFixed(cur, out[0]);
+  uint32_t interval = 0;
+
+  // Accumulate unsigned: a malformed frame's deltas wrap instead of overflowing
+  for (size_t i = 1; i < count; i++) {
+    if (p >= end) return 0;
+    uint8_t mask = *p++;
+    uint32_t v;
+    if (mask & 1) {
+      size_t r = frameGetVarint(p, end, v);
+      if (r == 0) return 0;
+      p += r;
+      interval += (uint32_t)frameUnzigzag(v);
+    }
+    cur.timestamp += interval;
+    for (int f = 0; f < FRAME_FIELD_COUNT; f++) {
+      if ((mask & (2 << f)) == 0) continue;
+      size_t r = frameGetVarint(p, end, v);
+      if (r == 0) return 0;
+      p += r;
+      cur.field[f] = (int32_t)((uint32_t)cur.field[f] + (uint32_t)frameUnzigzag(v));
+    }
+    frameFromFixed(cur, out[i]);
+  }
+  if (stop != nullptr) *stop = p;
+  return count;
+}
+
+/**
+ * @brief Decodes the samples carried by a FRAME_SAMPLE, FRAME_BATCH or FRAME_DELTA
+ * @param samplesEnd If set, receives the offset just past the last sample record
+ * @return Number of samples written to out, or 0 if the frame is malformed
+ */
+inline size_t decodeFrameSamples(const uint8_t *buf, size_t len, frame_header &hdr,
+                                 sensor_data *out, size_t maxOut, size_t *samplesEnd = nullptr) {
+  if (!decodeFrameHeader(buf, len, hdr) || maxOut == 0) return 0;
+
+  if (hdr.type == FRAME_SAMPLE) {
+    if (samplesEnd != nullptr) *samplesEnd = FRAME_HEADER_SIZE + FRAME_SAMPLE_SIZE;
+    return decodeSampleFrame(buf, len, hdr, out[0]) ? 1 : 0;
+  }
+  if (hdr.type == FRAME_DELTA) {
+    const uint8_t *stop = buf + len;
+    size_t count = decodeDeltaSamples(buf + FRAME_HEADER_SIZE, buf + len, hdr.baseTimestamp,
+                                      out, maxOut, &stop);
+    if (samplesEnd != nullptr) *samplesEnd = (size_t)(stop - buf);
+    return count;
+  }
+  if (hdr.type != FRAME_BATCH || len < FRAME_HEADER_SIZE + FRAME_BATCH_COUNT_SIZE) return 0;
+
+  size_t count = buf[FRAME_HEADER_SIZE];
+  const uint8_t *p = buf + FRAME_HEADER_SIZE + FRAME_BATCH_COUNT_SIZE;
+  if (count > maxOut || (size_t)(buf + len - p) < count * FRAME_SAMPLE_SIZE) return 0;
+
+  for (size_t i = 0; i < count; i++, p += FRAME_SAMPLE_SIZE) {
+    decodeSampleRecord(p, hdr.baseTimestamp, out[i]);
+  }
+  if (samplesEnd != nullptr) *samplesEnd = (size_t)(p - buf);
+  return count;
+}
+
+inline float frameSummaryScale(int field) {
+  return (float)SampleLayout::summaryScale(field);
+}
+
+/**
+ * @brief Encodes the statistics of one reporting window
+ * @return Frame length in bytes, or 0 if len is too small
+ */
+inline size_t encodeSummaryFrame(uint8_t *buf, size_t len, const uint8_t mac[6], uint16_t seq,
+                                 const sensor_summary &s) {
+  if (len < FRAME_SUMMARY_SIZE) return 0;
+  size_t n = encodeFrameHeader(buf, FRAME_SUMMARY, mac, seq, s.startMs);
+  framePut32(buf + n, s.windowMs);
+  n += 4;
+
+  for (int i = 0; i < FRAME_FIELD_COUNT; i++) {
+    const channel_summary &c = s.channel[i];
+    float scale = frameSummaryScale(i);
+    framePut16(buf + n, c.count);
+    framePut16(buf + n + 2, (uint16_t)frameQuantize(c.count ? c.mean : 0, scale, INT16_MIN, INT16_MAX));
+    framePut16(buf + n + 4, (uint16_t)frameQuantize(c.count ? c.min : 0, scale, INT16_MIN, INT16_MAX));
+    framePut16(buf + n + 6, (uint16_t)frameQuantize(c.count ? c.max : 0, scale, INT16_MIN, INT16_MAX));
+    framePut16(buf + n + 8, (uint16_t)frameQuantize(c.count ? c.stddev : 0, scale, 0, INT16_MAX));
+    n += FRAME_SUMMARY_CHANNEL_SIZE;
+  }
+  return n;
+}
+
+/**
+ * @brief Decodes a FRAME_SUMMARY
+ * @param summaryEnd If set, receives the offset just past the summary (for the health trailer)
+ * @return false if the frame is malformed or not a FRAME_SUMMARY
+ */
+inline bool decodeSummaryFrame(const uint8_t *buf, size_t len, frame_header &hdr,
+                               sensor_summary &s, size_t *summaryEnd = nullptr) {
+  if (!decodeFrameHeader(buf, len, hdr)) return false;
+  if (hdr.type != FRAME_SUMMARY || len < FRAME_SUMMARY_SIZE) return false;
+
+  const uint8_t *p = buf + FRAME_HEADER_SIZE;
+  s.startMs = hdr.baseTimestamp;
+  s.windowMs = frameGet32(p);
+  p += 4;
+  for (int i = 0; i < FRAME_FIELD_COUNT; i++, p += FRAME_SUMMARY_CHANNEL_SIZE) {
+    channel_summary &c = s.channel[i];
+    float scale = frameSummaryScale(i);
+    c.count = frameGet16(p);
+    c.mean = (int16_t)frameGet16(p + 2) / scale;
+    c.min = (int16_t)frameGet16(p + 4) / scale;
+    c.max = (int16_t)frameGet16(p + 6) / scale;
+    c.stddev = (int16_t)frameGet16(p + 8) / scale;
+  }
+  if (summaryEnd != nullptr) *summaryEnd = FRAME_SUMMARY_SIZE;
+  return true;
+}
+
+/**
+ * @brief Encodes an anomaly alarm for one reading
+ * @param mask Channels in alarm (bit i = sample_fixed field i)
+ * @return Frame length in bytes, or 0 if len is too small
+ */
+inline size_t encodeAlarmFrame(uint8_t *buf, size_t len, const uint8_t mac[6], uint16_t seq,
+                               uint8_t mask, const sensor_data &s) {
+  if (len < FRAME_ALARM_SIZE) return 0;
+  size_t n = encodeFrameHeader(buf, FRAME_ALARM, mac, seq, (uint32_t)s.timestamp);
+  buf[n++] = mask;
+  encodeSampleRecord(buf + n, s, (uint32_t)s.timestamp);
+  return n + FRAME_SAMPLE_SIZE;
+}
+
+/**
+ * @brief Decodes a FRAME_ALARM
+ * @return false if the frame is malformed or not a FRAME_ALARM
+ */
+inline bool decodeAlarmFrame(const uint8_t *buf, size_t len, frame_header &hdr,
+                             uint8_t &mask, sensor_data &s) {
+  if (!decodeFrameHeader(buf, len, hdr)) return false;
+  if (hdr.type != FRAME_ALARM || len < FRAME_ALARM_SIZE) return false;
+  mask = buf[FRAME_HEADER_SIZE];
+  decodeSampleRecord(buf + FRAME_HEADER_SIZE + 1, hdr.baseTimestamp, s);
+  return true;
+}
+
+/**
+ * @brief Appends one key/length/value item to a FRAME_CONFIG item list
+ * @param room Bytes left in the item list
+ * @return Bytes written, or 0 if the item does not fit
+ */
+inline size_t framePutConfigItem(uint8_t *p, size_t room, uint8_t key, const void *value, uint8_t len) {
+  if ((size_t)len + 2 > room) return 0;
+  p[0] = key;
+  p[1] = len;
+  memcpy(p + 2, value, len);
+  return (size_t)len + 2;
+}
+
+/**
+ * @brief Steps through a FRAME_CONFIG item list
+ * @param p Next item, advanced past it
+ * @return false at the end of the list or on a truncated item
+ */
+inline bool frameNextConfigItem(const uint8_t *&p, const uint8_t *end, uint8_t &key,
+                                const uint8_t *&value, uint8_t &len) {
+  if (end - p < 2 || end - p - 2 < p[1]) return false;
+  key = p[0];
+  len = p[1];
+  value = p + 2;
+  p += 2 + len;
+  return true;
+}
+
+/**
+ * @brief Encodes a FRAME_CONFIG without its tag (add it with signControlFrame())
+ * @param len Buffer capacity, including room for the tag
+ * @return Frame length before the tag, or 0 if the items do not fit
+ */
+inline size_t encodeConfigFrame(uint8_t *buf, size_t len, const uint8_t mac[6], uint16_t seq,
+                                uint32_t version, const uint8_t *items, size_t itemsLen) {
+  size_t n = FRAME_HEADER_SIZE + 4 + itemsLen;
+  if (itemsLen > FRAME_CONFIG_ITEMS_MAX || n + FRAME_CONTROL_TAG_SIZE > len) return 0;
+  encodeFrameHeader(buf, FRAME_CONFIG, mac, seq, 0);
+  framePut32(buf + FRAME_HEADER_SIZE, version);
+  memcpy(buf + FRAME_HEADER_SIZE + 4, items, itemsLen);
+  return n;
+}
+
+/**
+ * @brief Decodes a FRAME_CONFIG (check its tag with verifyControlFrame() first)
+ * @param items Set to the item list inside buf
+ * @return false if the frame is malformed or of another type
+ */
+inline bool decodeConfigFrame(const uint8_t *buf, size_t len, frame_header &hdr, uint32_t &version,
+                              const uint8_t *&items, size_t &itemsLen) {
+  if (!decodeFrameHeader(buf, len, hdr)) return false;
+  if (hdr.type != FRAME_CONFIG || len < FRAME_HEADER_SIZE + 4 + FRAME_CONTROL_TAG_SIZE) return false;
+  version = frameGet32(buf + FRAME_HEADER_SIZE);
+  items = buf + FRAME_HEADER_SIZE + 4;
+  itemsLen = len - FRAME_HEADER_SIZE - 4 - FRAME_CONTROL_TAG_SIZE;
+  return true;
+}
+
+/**
+ * @brief Encodes a FRAME_CONFIG_ACK without its tag
+ * @return Frame length before the tag, or 0 if the buffer is too small
+ */
+inline size_t encodeConfigAckFrame(uint8_t *buf, size_t len, const uint8_t mac[6], uint16_t seq,
+                                   uint32_t version, uint8_t result) {
+  if (len < FRAME_CONFIG_ACK_SIZE) return 0;
+  size_t n = encodeFrameHeader(buf, FRAME_CONFIG_ACK, mac, seq, 0);
+  framePut32(buf + n, version);
+  buf[n + 4] = result;
+  return FRAME_CONFIG_ACK_SIZE - FRAME_CONTROL_TAG_SIZE;
+}
+
+inline bool decodeConfigAckFrame(const uint8_t *buf, size_t len, frame_header &hdr,
+                                 uint32_t &version, uint8_t &result) {
+  if (!decodeFrameHeader(buf, len, hdr)) return false;
+  if (hdr.type != FRAME_CONFIG_ACK || len < FRAME_CONFIG_ACK_SIZE) return false;
+  version = frameGet32(buf + FRAME_HEADER_SIZE);
+  result = buf[FRAME_HEADER_SIZE + 4];
+  return true;
+}
+
+/**
+ * @brief Encodes a FRAME_OTA_OFFER without its tag
+ * @param hash SHA-256 from OtaImage::hash()
+ * @param sig Release signature of hash, sigLen bytes
+ * @return Frame length before the tag, or 0 if the signature is too long or the buffer too small
+ */
+inline size_t encodeOtaOfferFrame(uint8_t *buf, size_t len, const uint8_t mac[6], uint16_t seq,
+                                  uint32_t imageId, uint32_t size, const uint8_t hash[32],
+                                  const uint8_t *sig, size_t sigLen) {
+  if (sigLen > FRAME_OTA_SIG_MAX || len < FRAME_OTA_OFFER_SIZE(sigLen)) return 0;
+  size_t n = encodeFrameHeader(buf, FRAME_OTA_OFFER, mac, seq, 0);
+  framePut32(buf + n, imageId);
+  framePut32(buf + n + 4, size);
+  memcpy(buf + n + 8, hash, 32);
+  buf[n + 40] = (uint8_t)sigLen;
+  memcpy(buf + n + 41, sig, sigLen);
+  return FRAME_OTA_OFFER_SIZE(sigLen) - FRAME_CONTROL_TAG_SIZE;
+}
+
+/**
+ * @brief Decodes a FRAME_OTA_OFFER
+ * @param sig Set to the signature inside buf, sigLen bytes
+ * @return false if the frame is malformed or of another type
+ */
+inline bool decodeOtaOfferFrame(const uint8_t *buf, size_t len, frame_header &hdr, uint32_t &imageId,
+                                uint32_t &size, uint8_t hash[32], const uint8_t *&sig, size_t &sigLen) {
+  if (!decodeFrameHeader(buf, len, hdr)) return false;
+  if (hdr.type != FRAME_OTA_OFFER || len < FRAME_OTA_OFFER_SIZE(0)) return false;
+  imageId = frameGet32(buf + FRAME_HEADER_SIZE);
+  size = frameGet32(buf + FRAME_HEADER_SIZE + 4);
+  memcpy(hash, buf + FRAME_HEADER_SIZE + 8, 32);
+  sigLen = buf[FRAME_HEADER_SIZE + 40];
+  sig = buf + FRAME_HEADER_SIZE + 41;
+  return sigLen <= FRAME_OTA_SIG_MAX && len == FRAME_OTA_OFFER_SIZE(sigLen);
+}
+
+/**
+ * @brief Encodes one FRAME_OTA_CHUNK without its tag
+ * @return Frame length before the tag, or 0 if the data is too long or the buffer too small
+ */
+inline size_t encodeOtaChunkFrame(uint8_t *buf, size_t len, const uint8_t mac[6], uint16_t seq,
+                                  uint32_t imageId, uint16_t chunk, const uint8_t *data, size_t dataLen) {
+  if (dataLen > FRAME_OTA_CHUNK_SIZE || FRAME_OTA_CHUNK_HEADER_SIZE + dataLen + FRAME_CONTROL_TAG_SIZE > len) {
+    return 0;
+  }
+  size_t n = encodeFrameHeader(buf, FRAME_OTA_CHUNK, mac, seq, 0);
+  framePut32(buf + n, imageId);
+  framePut16(buf + n + 4, chunk);
+  memcpy(buf + FRAME_OTA_CHUNK_HEADER_SIZE, data, dataLen);
+  return FRAME_OTA_CHUNK_HEADER_SIZE + dataLen;
+}
+
+/**
+ * @brief Decodes a FRAME_OTA_CHUNK
+ * @param data Set to the image bytes inside buf
+ * @return false if the frame is malformed or of another type
+ */
+inline bool decodeOtaChunkFrame(const uint8_t *buf, size_t len, frame_header &hdr, uint32_t &imageId,
+                                uint16_t &chunk, const uint8_t *&data, size_t &dataLen) {
+  if (!decodeFrameHeader(buf, len, hdr)) return false;
+  if (hdr.type != FRAME_OTA_CHUNK || len <= FRAME_OTA_CHUNK_HEADER_SIZE + FRAME_CONTROL_TAG_SIZE) return false;
+  imageId = frameGet32(buf + FRAME_HEADER_SIZE);
+  chunk = frameGet16(buf + FRAME_HEADER_SIZE + 4);
+  data = buf + FRAME_OTA_CHUNK_HEADER_SIZE;
+  dataLen = len - FRAME_OTA_CHUNK_HEADER_SIZE - FRAME_CONTROL_TAG_SIZE;
+  return dataLen <= FRAME_OTA_CHUNK_SIZE;
+}
+
+/**
+ * @brief Encodes a FRAME_OTA_STATUS without its tag
+ * @param sectors Incomplete-sector bitmap, mapLen bytes
+ * @return Frame length before the tag, or 0 if the buffer is too small
+ */
+inline size_t encodeOtaStatusFrame(uint8_t *buf, size_t len, const uint8_t mac[6], uint16_t seq,
+                                   uint32_t imageId, uint8_t state, uint16_t stored,
+                                   const uint8_t *sectors, size_t mapLen) {
+  if (len < FRAME_OTA_STATUS_SIZE(mapLen)) return 0;
+  size_t n = encodeFrameHeader(buf, FRAME_OTA_STATUS, mac, seq, 0);
+  framePut32(buf + n, imageId);
+  buf[n + 4] = state;
+  framePut16(buf + n + 5, stored);
+  memcpy(buf + n + 7, sectors, mapLen);
+  return FRAME_OTA_STATUS_SIZE(mapLen) - FRAME_CONTROL_TAG_SIZE;
+}
+
+/**
+ * @brief Decodes a FRAME_OTA_STATUS
+ * @param sectors Set to the incomplete-sector bitmap inside buf, mapLen bytes
+ * @return false if the frame is malformed or of another type
+ */
+inline bool decodeOtaStatusFrame(const uint8_t *buf, size_t len, frame_header &hdr, uint32_t &imageId,
+                                 uint8_t &state, uint16_t &stored, const uint8_t *&sectors,
+                                 size_t &mapLen) {
+  if (!decodeFrameHeader(buf, len, hdr)) return false;
+  if (hdr.type != FRAME_OTA_STATUS || len < FRAME_OTA_STATUS_SIZE(0)) return false;
+  imageId = frameGet32(buf + FRAME_HEADER_SIZE);
+  state = buf[FRAME_HEADER_SIZE + 4];
+  stored = frameGet16(buf + FRAME_HEADER_SIZE + 5);
+  sectors = buf + FRAME_HEADER_SIZE + 7;
+  mapLen = len - FRAME_OTA_STATUS_SIZE(0);
+  return true;
+}
+
+/**
+ * @brief Appends a health trailer to an encoded sample-carrying frame
+ * @param frameLen Current frame length (end of the last sample record)
+ * @param len Buffer capacity
+ * @return New frame length, or frameLen unchanged if the trailer does not fit
+ */
+inline size_t appendHealthTrailer(uint8_t *buf, size_t frameLen, size_t len, const health_record &h) {
+  if (frameLen == 0 || frameLen + FRAME_HEALTH_SIZE > len) return frameLen;
+  uint8_t *p = buf + frameLen;
+  p[0] = FRAME_TRAILER_HEALTH;
+  framePut32(p + 1, h.acked);
+  framePut32(p + 5, h.failed);
+  framePut16(p + 9, frameSat16(h.retransmits));
+  framePut16(p + 11, frameSat16(h.dropped));
+  p[13] = h.ackRate;
+  p[14] = h.queueDepth;
+  p[15] = (uint8_t)h.rssi;
+  framePut16(p + 16, frameSat16(h.freeHeap / 16));
+  framePut16(p + 18, frameSat16(h.loopMaxUs / 100));
+  framePut16(p + 20, frameSat16(h.wakeMs));
+  return frameLen + FRAME_HEALTH_SIZE;
+}
+
+/**
+ * @brief Decodes the health trailer after the samples, if the frame has one
+ * @param samplesEnd Offset past the last sample record (from decodeFrameSamples)
+ * @return false if the frame carries no health trailer
+ */
+inline bool decodeHealthTrailer(const uint8_t *buf, size_t len, size_t samplesEnd, health_record &h) {
+  if (samplesEnd + FRAME_HEALTH_SIZE > len) return false;
+  const uint8_t *p = buf + samplesEnd;
+  if (p[0] != FRAME_TRAILER_HEALTH) return false;
+  h.acked = frameGet32(p + 1);
+  h.failed = frameGet32(p + 5);
+  h.retransmits = frameGet16(p + 9);
+  h.dropped = frameGet16(p + 11);
+  h.ackRate = p[13];
+  h.queueDepth = p[14];
+  h.rssi = (int8_t)p[15];
+  h.freeHeap = (uint32_t)frameGet16(p + 16) * 16;
+  h.loopMaxUs = (uint32_t)frameGet16(p + 18) * 100;
+  h.wakeMs = frameGet16(p + 20);
+  return true;
+}
+
+#endif  // SENSOR_FRAME_H
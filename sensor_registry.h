@@ -0,0 +1,197 @@
+#ifndef SENSOR_REGISTRY_H
+#define SENSOR_REGISTRY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+#include <type_traits>
+#include <utility>
+
+// ==================== SENSOR REGISTRY ====================
+//
+// Compile-time description of the channels in a sample record. A channel
+// descriptor names its member of the record, its wire width, fixed-point
+// range and scale, and how it is printed. SensorRegistry<...> packs the
+// channels back to back, LSB first, into one bit field, and generates the
+// fixed-point conversions and the packing for that layout.
+//
+// Every per-channel step is a fold over the parameter pack, with the bit
+// offsets as template constants. The compiler unrolls it into the same
+// shifts and masks a hand-written codec would use: there are no function
+// pointers, virtual calls or layout tables at run time. Only the printing
+// metadata (name, label, unit) is looked up by channel index.
+//
+// Adding a sensor:
+//   1. Add its member to the record.
+//   2. Add a descriptor to the registry list (SampleLayout in sensor_frame.h).
+//   3. Read it in the sender.
+// The wire layout, codecs, summaries, Serial print block and gateway CSV
+// columns all follow from the list. The layout changes with the list, so
+// rebuild senders and gateways together.
+
+/**
+ * @brief One channel: the Member of Record, sent as a Bits-wide fixed-point value
+ * @tparam Lo Lowest fixed-point value; below 0 makes the field two's complement
+ * @tparam Hi Highest fixed-point value; readings are clamped to [Lo, Hi]
+ * @tparam Scale Fixed-point steps per unit (stored value = reading * Scale)
+ * @tparam SummaryScale Scale of this channel's int16 statistics in a FRAME_SUMMARY
+ * @tparam ZeroMissing A reading of 0 or less means "no reading" (left out of
+ *                     statistics and anomaly checks)
+ */
+template <typename Record, typename T, T Record::*Member, unsigned Bits, int32_t Lo, int32_t Hi,
+          int32_t Scale, int32_t SummaryScale, bool ZeroMissing = false>
+struct SensorChannel {
+  static_assert(Bits >= 1 && Bits <= 32, "Channel width must be 1..32 bits");
+  static_assert(Lo < Hi, "Empty channel range");
+  static_assert(Lo >= 0 || Bits >= 2, "A signed channel needs a sign bit");
+
+  typedef Record record_type;
+  static constexpr unsigned bits = Bits;
+  static constexpr int32_t summaryScale = SummaryScale;
+  static constexpr bool zeroMissing = ZeroMissing;
+  static constexpr uint32_t mask = (uint32_t)((1ull << Bits) - 1);
+
+  /**
+   * @brief Reading to fixed point, rounded and clamped to [Lo, Hi] (NaN becomes Lo)
+   */
+  static int32_t toFixed(const Record &r) {
+    if constexpr (std::is_floating_point<T>::value) {
+      float scaled = roundf((float)(r.*Member) * Scale);
+      if (!(scaled >= (float)Lo)) return Lo;
+      if (scaled > (float)Hi) return Hi;
+      return (int32_t)scaled;
+    } else {
+      int64_t v = (int64_t)(r.*Member) * Scale;
+      return v < Lo ? Lo : (v > Hi ? Hi : (int32_t)v);
+    }
+  }
+
+  static void fromFixed(int32_t v, Record &r) {
+    if constexpr (std::is_floating_point<T>::value) {
+      r.*Member = (T)(v / (float)Scale);
+    } else {
+      r.*Member = (T)(v / Scale);
+    }
+  }
+
+  static float value(const Record &r) { return (float)(r.*Member); }
+
+  static uint32_t pack(int32_t v) { return (uint32_t)v & mask; }
+
+  static int32_t unpack(uint32_t raw) {
+    raw &= mask;
+    if (Lo < 0 && Bits < 32 && (raw >> (Bits - 1)) != 0) raw |= ~mask;  // Sign-extend
+    return (int32_t)raw;
+  }
+};
+
+template <typename First, typename... Rest>
+struct registry_first {
+  typedef First type;
+};
+
+/**
+ * @brief The channels of one record, in wire order
+ *
+ * Descriptors derive from SensorChannel and add the printing metadata:
+ * name (CSV column), label (Serial), unit, and precision (decimals printed).
+ */
+template <typename... Channels>
+class SensorRegistry {
+public:
+  typedef typename registry_first<Channels...>::type::record_type Record;
+
+  static constexpr size_t count = sizeof...(Channels);
+  static constexpr unsigned bits = (Channels::bits + ...);
+  static constexpr size_t packedBytes = (bits + 7) / 8;
+  // Longest zigzag varint of one channel's change, all channels (FRAME_DELTA)
+  static constexpr size_t deltaBytes = (((Channels::bits + 1 + 6) / 7) + ...);
+
+  static_assert(bits <= 64, "Sample records are packed into at most 64 bits");
+
+  /**
+   * @brief Bit offset of channel i in the packed record
+   */
+  static constexpr unsigned offset(size_t i) {
+    constexpr unsigned widths[] = {Channels::bits...};
+    unsigned off = 0;
+    for (size_t k = 0; k < i; k++) off += widths[k];
+    return off;
+  }
+
+  static void toFixed(const Record &r, int32_t *fixed) { toFixed(r, fixed, Index()); }
+  static void fromFixed(const int32_t *fixed, Record &r) { fromFixed(fixed, r, Index()); }
+  static uint64_t pack(const int32_t *fixed) { return pack(fixed, Index()); }
+  static void unpack(uint64_t packed, int32_t *fixed) { unpack(packed, fixed, Index()); }
+
+  /**
+   * @brief Every channel's reading as a float, in wire order
+   */
+  static void values(const Record &r, float *out) { values(r, out, Index()); }
+
+  /**
+   * @brief Whether v is channel i's "no reading" value
+   */
+  static bool missing(size_t i, float v) {
+    static constexpr bool zeroMissing[] = {Channels::zeroMissing...};
+    return zeroMissing[i] && v <= 0.0f;
+  }
+
+  static int32_t summaryScale(size_t i) {
+    static constexpr int32_t scales[] = {Channels::summaryScale...};
+    return scales[i];
+  }
+
+  static const char *name(size_t i) {
+    static constexpr const char *names[] = {Channels::name...};
+    return names[i];
+  }
+
+  static const char *label(size_t i) {
+    static constexpr const char *labels[] = {Channels::label...};
+    return labels[i];
+  }
+
+  static const char *unit(size_t i) {
+    static constexpr const char *units[] = {Channels::unit...};
+    return units[i];
+  }
+
+  static int precision(size_t i) {
+    static constexpr int precisions[] = {Channels::precision...};
+    return precisions[i];
+  }
+
+private:
+  typedef std::index_sequence_for<Channels...> Index;
+
+  template <size_t I>
+  using offset_of = std::integral_constant<unsigned, offset(I)>;
+
+  template <size_t... I>
+  static void toFixed(const Record &r, int32_t *fixed, std::index_sequence<I...>) {
+    ((fixed[I] = Channels::toFixed(r)), ...);
+  }
+
+  template <size_t... I>
+  static void fromFixed(const int32_t *fixed, Record &r, std::index_sequence<I...>) {
+    (Channels::fromFixed(fixed[I], r), ...);
+  }
+
+  template <size_t... I>
+  static uint64_t pack(const int32_t *fixed, std::index_sequence<I...>) {
+    return (((uint64_t)Channels::pack(fixed[I]) << offset_of<I>::value) | ...);
+  }
+
+  template <size_t... I>
+  static void unpack(uint64_t packed, int32_t *fixed, std::index_sequence<I...>) {
+    ((fixed[I] = Channels::unpack((uint32_t)(packed >> offset_of<I>::value))), ...);
+  }
+
+  template <size_t... I>
+  static void values(const Record &r, float *out, std::index_sequence<I...>) {
+    ((out[I] = Channels::value(r)), ...);
+  }
+};
+
+#endif  // SENSOR_REGISTRY_H
@@ -0,0 +1,57 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <stdint.h>
+#include <atomic>
+
+// ==================== SEQLOCK SNAPSHOT ====================
+//
+// Latest-value snapshot of a small trivially copyable struct, shared between
+// one writer and any number of readers without a mutex. The writer bumps the
+// sequence to odd, copies the value in, and bumps it back to even; a reader
+// copies the value out and retries if the sequence was odd or changed while
+// it copied, so it never returns a torn record.
+//
+// Writes never wait. Readers only retry while a write overlaps their copy,
+// which for a sensor_data is a few dozen cycles per reading.
+
+template <typename T>
+class Seqlock {
+public:
+  /**
+   * @brief Publish a new value (single writer)
+   */
+  void store(const T &value) {
+    uint32_t seq = seq_.load(std::memory_order_relaxed);
+    seq_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    value_ = value;
+    seq_.store(seq + 2, std::memory_order_release);
+  }
+
+  /**
+   * @brief Copy out the latest complete value (any context)
+   */
+  T load() const {
+    T copy;
+    uint32_t before, after;
+    do {
+      before = seq_.load(std::memory_order_acquire);
+      copy = value_;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      after = seq_.load(std::memory_order_relaxed);
+    } while ((before & 1) != 0 || before != after);
+    return copy;
+  }
+
+  /**
+   * @brief Number of values published so far
+   */
+  uint32_t version() const { return seq_.load(std::memory_order_acquire) / 2; }
+
+private:
+  T value_{};
+  std::atomic<uint32_t> seq_{0};
+};
+
+#endif  // SEQLOCK_H
@@ -0,0 +1,146 @@
+#include "channel.h"
+
+static const uint8_t gatewayMac[6] = {0x02, 0x47, 0x57, 0x00, 0x00, 0x01};
+
+Channel::Channel(const channel_config &config, size_t workers, std::vector<HostHal *> &nodes, uint32_t seed)
+    : config_(config), nodes_(nodes), outboxes_(workers), rng_(seed ? seed : 1) {}
+
+/**
+ * @brief Decode a delivered frame and account for it per node
+ */
+void Channel::gatewayReceive(const tx_attempt &tx, uint64_t nowUs) {
+  static sensor_data samples[FRAME_DELTA_MAX_SAMPLES];
+
+  frame_header hdr;
+  size_t count = decodeFrameSamples(tx.data, tx.len, hdr, samples, FRAME_DELTA_MAX_SAMPLES);
+  if (count == 0) {
+    stats_.malformed++;
+    return;
+  }
+
+  bool first = gateway_.find(tx.node) == gateway_.end();
+  gateway_node &node = gateway_[tx.node];
+  if (!first && hdr.seq == node.lastSeq) {
+    node.duplicates++;  // Ack lost: the sender retransmitted
+    return;
+  }
+  if (!first) {
+    uint16_t gap = (uint16_t)(hdr.seq - node.lastSeq);
+    if (gap > 1 && gap < 0x8000) node.gaps += gap - 1;
+  }
+  node.lastSeq = hdr.seq;
+  node.frames++;
+
+  // Sample timestamps are node-local: shift them onto the global clock
+  uint32_t bootMs = nodes_[tx.node]->bootMs();
+  uint32_t nowMs = (uint32_t)(nowUs / 1000);
+  for (size_t i = 0; i < count; i++) {
+    if (!node.timestamps.insert((uint32_t)samples[i].timestamp).second) {
+      node.repeats++;
+      continue;
+    }
+    node.samples++;
+    uint32_t latencyMs = nowMs - (bootMs + (uint32_t)samples[i].timestamp);
+    node.latencySumMs += latencyMs;
+    if (latencyMs > node.latencyMaxMs) node.latencyMaxMs = latencyMs;
+  }
+
+  if (first && config_.assignSlots) {
+    HostHal *sender = nodes_[tx.node];
+    uint8_t frame[FRAME_SLOT_SIZE];
+    uint16_t phase = (uint16_t)(nowMs % config_.intervalMs);  // Gateway intervals start at t = 0
+    size_t len = encodeSlotFrame(frame, sizeof(frame), gatewayMac, controlSeq_++,
+                                 nextSlot_, config_.slots, phase);
+    sender->receive(frame, len);
+    nextSlot_ = (uint8_t)((nextSlot_ + 1) % config_.slots);
+  }
+}
+
+void Channel::resolve(uint32_t tickMs) {
+  for (auto &box : outboxes_) {
+    for (tx_attempt &tx : box) {
+      tx.cw = SIM_CW_MIN;
+      drawBackoff(tx);
+      contending_.push_back(tx);
+    }
+    box.clear();
+  }
+
+  const bool gatewayDown = tickMs - config_.outageStartMs < config_.outageMs;
+  const uint64_t tickEndUs = (uint64_t)(tickMs + 1) * 1000;
+  uint64_t t = (uint64_t)tickMs * 1000;
+  if (busyUntilUs_ > t) t = busyUntilUs_;
+
+  std::vector<size_t> winners;
+  while (t < tickEndUs && !contending_.empty()) {
+    // Lowest remaining backoff wins the medium; everyone else freezes
+    uint16_t lowest = 0xFFFF;
+    for (const tx_attempt &tx : contending_) {
+      if (tx.backoff < lowest) lowest = tx.backoff;
+    }
+    winners.clear();
+    for (size_t i = 0; i < contending_.size(); i++) {
+      contending_[i].backoff -= lowest;
+      if (contending_[i].backoff == 0) winners.push_back(i);
+    }
+    t += SIM_DIFS_US + (uint64_t)lowest * SIM_SLOT_US;
+
+    uint8_t longest = 0;
+    for (size_t i : winners) {
+      if (contending_[i].len > longest) longest = contending_[i].len;
+    }
+    uint64_t airUs = SIM_PREAMBLE_US + (uint64_t)(longest + SIM_MAC_OVERHEAD_BYTES) * 8;
+    uint64_t endUs = t + airUs + SIM_SIFS_US + SIM_ACK_US;
+    stats_.attempts += winners.size();
+    stats_.busyUs += endUs - t;
+
+    bool collided = winners.size() > 1;
+    if (collided) stats_.collisions += winners.size();
+
+    std::vector<tx_attempt> next;
+    next.reserve(contending_.size());
+    for (size_t i = 0, w = 0; i < contending_.size(); i++) {
+      tx_attempt &tx = contending_[i];
+      if (w >= winners.size() || winners[w] != i) {
+        next.push_back(tx);
+        continue;
+      }
+      w++;
+
+      bool success = !collided;
+      if (success && gatewayDown) {
+        success = false;
+        stats_.unheard++;
+      }
+      if (success && chance(config_.lossRate)) {
+        success = false;  // Data frame lost
+        stats_.lost++;
+      }
+      if (success) {
+        if (!tx.received) gatewayReceive(tx, t + airUs);
+        tx.received = true;
+        if (chance(config_.lossRate)) {
+          success = false;  // Received, but the ack was lost
+          stats_.lost++;
+        }
+      }
+
+      if (success) {
+        stats_.delivered++;
+        nodes_[tx.node]->deliver(true, endUs);
+      } else if (tx.retries < SIM_MAC_RETRIES) {
+        tx.retries++;
+        stats_.macRetries++;
+        tx.cw = tx.cw * 2 > SIM_CW_MAX ? SIM_CW_MAX : tx.cw * 2;
+        drawBackoff(tx);
+        next.push_back(tx);
+      } else {
+        stats_.failed++;
+        nodes_[tx.node]->deliver(false, endUs);
+      }
+    }
+    contending_.swap(next);
+    t = endUs;
+  }
+  if (t > busyUntilUs_) busyUntilUs_ = t;
+}
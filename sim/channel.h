@@ -0,0 +1,114 @@
+#ifndef SIM_CHANNEL_H
+#define SIM_CHANNEL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include "hal.h"
+
+// ==================== SIMULATED CHANNEL ====================
+//
+// One shared 802.11 channel at the ESP-NOW default rate (1 Mbps), modelled
+// with the parts of CSMA/CA that decide who gets through:
+//
+//   - a sender that finds the medium busy waits for it to go idle (DIFS)
+//   - contenders count down random backoffs (slots of 9 us) drawn from
+//     their contention window; the lowest count transmits
+//   - equal lowest counts collide; a loser freezes its remaining count
+//   - a failed unicast (collision, lost data or lost ack) is retried by the
+//     MAC with a doubled window, up to SIM_MAC_RETRIES, before OnDataSent
+//     reports failure
+//
+// Frames that get through reach the gateway model, which decodes them with
+// sensor_frame.h exactly as receiver/receiver.cpp does. Gateway-to-node
+// control frames (FRAME_SLOT) are delivered directly; their airtime is
+// ignored. During an outage the gateway hears nothing, so every attempt
+// fails while the senders' radios stay up.
+//
+// resolve() runs single-threaded while every worker waits at the barrier.
+
+#define SIM_SLOT_US 9
+#define SIM_DIFS_US 34
+#define SIM_SIFS_US 10
+#define SIM_PREAMBLE_US 192
+#define SIM_MAC_OVERHEAD_BYTES 43  // MAC header, vendor action frame, FCS
+#define SIM_ACK_US 304
+#define SIM_CW_MIN 16
+#define SIM_CW_MAX 1024
+#define SIM_MAC_RETRIES 4
+
+typedef struct channel_config {
+  float lossRate;       // Probability that a data frame or its ack is lost
+  bool assignSlots;     // Gateway hands out TDMA slots in order of first contact
+  uint8_t slots;
+  uint32_t intervalMs;  // Reporting interval the slots divide
+  uint32_t outageStartMs;
+  uint32_t outageMs;    // Gateway down for this long (0: never)
+} channel_config;
+
+typedef struct gateway_node {
+  uint32_t frames;
+  uint32_t samples;      // Distinct readings
+  uint32_t repeats;      // Readings received again in a later frame (ack lost, sent again)
+  uint32_t duplicates;
+  uint32_t gaps;         // Frames missing from the sequence
+  uint16_t lastSeq;
+  double latencySumMs;   // Sample taken -> frame received
+  uint32_t latencyMaxMs;
+  std::unordered_set<uint32_t> timestamps;  // Node-local times of the readings received
+} gateway_node;
+
+typedef struct channel_stats {
+  uint64_t attempts;     // Transmissions put on air (incl. MAC retries)
+  uint64_t delivered;    // Frames acked at MAC level
+  uint64_t failed;       // Reported to the sender as failed
+  uint64_t collisions;   // Transmissions lost to a collision
+  uint64_t lost;         // Data or ack lost to the loss rate
+  uint64_t unheard;      // Sent while the gateway was down
+  uint64_t macRetries;
+  uint64_t busyUs;
+  uint64_t malformed;
+} channel_stats;
+
+class Channel {
+public:
+  Channel(const channel_config &config, size_t workers, std::vector<HostHal *> &nodes, uint32_t seed);
+
+  std::vector<tx_attempt> *outbox(size_t worker) { return &outboxes_[worker]; }
+
+  /**
+   * @brief Move the medium through one millisecond of virtual time
+   */
+  void resolve(uint32_t tickMs);
+
+  const channel_stats &stats() const { return stats_; }
+  const std::unordered_map<uint32_t, gateway_node> &gatewayNodes() const { return gateway_; }
+  size_t contending() const { return contending_.size(); }
+
+private:
+  uint32_t random() {
+    rng_ ^= rng_ << 13;
+    rng_ ^= rng_ >> 17;
+    rng_ ^= rng_ << 5;
+    return rng_;
+  }
+  bool chance(float p) { return (random() >> 8) < (uint32_t)(p * (1u << 24)); }
+  void drawBackoff(tx_attempt &tx) { tx.backoff = (uint16_t)(random() % tx.cw); }
+  void gatewayReceive(const tx_attempt &tx, uint64_t nowUs);
+
+  channel_config config_;
+  std::vector<HostHal *> &nodes_;
+  std::vector<std::vector<tx_attempt>> outboxes_;
+  std::vector<tx_attempt> contending_;
+  uint64_t busyUntilUs_ = 0;
+  uint32_t rng_;
+  channel_stats stats_ = {};
+
+  std::unordered_map<uint32_t, gateway_node> gateway_;
+  uint8_t nextSlot_ = 0;
+  uint16_t controlSeq_ = 0;
+};
+
+#endif  // SIM_CHANNEL_H
@@ -0,0 +1,61 @@
+#include "checks.h"
+
+#include <stdio.h>
+#include "../report_schedule.h"
+#include "../sensor_frame.h"
+
+static int failures = 0;
+
+static void expect(bool ok, const char *what) {
+  if (ok) return;
+  printf("FAIL %s\n", what);
+  failures++;
+}
+
+/**
+ * @brief Slotted next() against slot starts worked out by hand
+ */
+static void checkReportSchedule() {
+  // 16 slots of 750 ms, slot 5 starts 3750 ms into each interval
+  ReportSchedule schedule(true, 16, 0);
+  schedule.assign(5, 16, 1000);
+
+  uint32_t ahead = schedule.next(2000, 12000, 0);
+  expect(ahead == 4750, "ReportSchedule: slot still ahead of now in the first interval");
+  uint32_t passed = schedule.next(6000, 12000, 0);
+  expect(passed == 16750, "ReportSchedule: slot already passed this interval");
+  uint32_t onSlot = schedule.next(4750, 12000, 0);
+  expect(onSlot == 16750, "ReportSchedule: report sent on the slot start");
+
+  // Epoch taken before millis() reached the phase, so it wrapped
+  schedule.assign(5, 16, 500u - 2000u);
+  uint32_t wrapped = schedule.next(500, 12000, 0);
+  expect(wrapped == 2250, "ReportSchedule: epoch before millis() zero");
+}
+
+/**
+ * @brief Delta bodies whose deltas overflow int32 still decode (wrapping)
+ */
+static void checkDeltaOverflow() {
+  uint8_t body[64] = {};
+  size_t n = 0;
+  body[n++] = 4;                 // Sample count
+  n += FRAME_SAMPLE_SIZE;        // All-zero keyframe
+  for (int i = 0; i < 3; i++) {
+    body[n++] = 1 | 2;           // Interval and first field change
+    n += framePutVarint(body + n, frameZigzag(INT32_MAX));
+    n += framePutVarint(body + n, frameZigzag(INT32_MAX));
+  }
+
+  sensor_data out[4];
+  size_t count = decodeDeltaSamples(body, body + n, 0, out, 4);
+  expect(count == 4, "decodeDeltaSamples: int32 overflow in field and interval deltas");
+}
+
+int runChecks() {
+  failures = 0;
+  checkReportSchedule();
+  checkDeltaOverflow();
+  printf("%s: %d check(s) failed\n", failures ? "FAILED" : "PASSED", failures);
+  return failures;
+}
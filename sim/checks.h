@@ -0,0 +1,16 @@
+#ifndef SIM_CHECKS_H
+#define SIM_CHECKS_H
+
+// ==================== HEADER CHECKS ====================
+//
+// Edge cases of the shared headers that a fleet run rarely or never reaches,
+// checked directly against known answers. Run with --check; the process exits
+// non-zero if any of them fails.
+
+/**
+ * @brief Run every check, printing one line per failure
+ * @return Number of failed checks
+ */
+int runChecks();
+
+#endif  // SIM_CHECKS_H
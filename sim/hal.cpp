@@ -0,0 +1,55 @@
+#include "hal.h"
+
+bool HostHal::send(const uint8_t *frame, size_t len) {
+  if (outbox_ == nullptr || len == 0 || len > FRAME_MAX_SIZE) return false;
+  outbox_->emplace_back();
+  tx_attempt &tx = outbox_->back();
+  tx.node = id_;
+  tx.retries = 0;
+  tx.received = false;
+  tx.cw = 0;  // Drawn by the channel
+  tx.backoff = 0;
+  tx.len = (uint8_t)len;
+  memcpy(tx.data, frame, len);
+  return true;
+}
+
+bool HostHal::pollDelivery(delivery_report &report) {
+  if (deliveries_.empty()) return false;
+  report = deliveries_.front();
+  deliveries_.pop_front();
+  return true;
+}
+
+void HostHal::receive(const uint8_t *frame, size_t len) {
+  if (len > FRAME_MAX_SIZE) return;
+  received_.emplace_back();
+  received_.back().len = (uint8_t)len;
+  memcpy(received_.back().data, frame, len);
+}
+
+bool HostHal::pollReceive(rx_message &msg) {
+  if (received_.empty()) return false;
+  msg = received_.front();
+  received_.pop_front();
+  return true;
+}
+
+bool HostHal::readDht(float &temperature, float &humidity) {
+  if (random() % 100 == 0) return false;  // Occasional checksum failure
+  temperature_ += ((int32_t)(random() % 21) - 10) / 100.0f;
+  humidity_ += ((int32_t)(random() % 41) - 20) / 100.0f;
+  if (humidity_ < 0.0f) humidity_ = 0.0f;
+  if (humidity_ > 100.0f) humidity_ = 100.0f;
+  temperature = temperature_;
+  humidity = humidity_;
+  return true;
+}
+
+int HostHal::analogRead(uint8_t pin) {
+  (void)pin;
+  gas_ += (int)(random() % 31) - 15;
+  if (gas_ < 0) gas_ = 0;
+  if (gas_ > 4095) gas_ = 4095;
+  return gas_;
+}
@@ -0,0 +1,101 @@
+#ifndef SIM_HAL_H
+#define SIM_HAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <deque>
+#include <vector>
+#include "../sensor_frame.h"
+
+// ==================== HOST HARDWARE ABSTRACTION ====================
+//
+// The hardware a sender touches, as one simulated node sees it:
+//
+//   millis()        ->  HostHal::millis()        node-local virtual clock
+//   esp_now_send()  ->  HostHal::send()          onto the simulated channel
+//   OnDataSent      ->  HostHal::pollDelivery()  delivery reports, in send order
+//   OnDataRecv      ->  HostHal::pollReceive()   frames from the gateway
+//   dht.read()      ->  HostHal::readDht()       synthetic random walk
+//   analogRead()    ->  HostHal::analogRead()    synthetic random walk
+//   esp_random()    ->  HostHal::random()        per-node xorshift32
+//
+// The clock only moves between simulation ticks. Each node is stepped by one
+// worker thread, which also owns the outbox send() appends to; the inboxes
+// are filled by the channel while all workers wait at the tick barrier, so no
+// locking is needed anywhere.
+
+typedef struct tx_attempt {
+  uint32_t node;
+  uint8_t retries;  // MAC-level retries so far
+  bool received;    // Gateway has it (802.11 drops the retried copies)
+  uint16_t cw;      // Contention window (slots)
+  uint16_t backoff; // Slots left before this node may transmit
+  uint8_t len;
+  uint8_t data[FRAME_MAX_SIZE];
+} tx_attempt;
+
+typedef struct delivery_report {
+  bool success;
+  uint64_t timeUs;  // Global virtual time of the callback
+} delivery_report;
+
+typedef struct rx_message {
+  uint8_t len;
+  uint8_t data[FRAME_MAX_SIZE];
+} rx_message;
+
+class HostHal {
+public:
+  HostHal(uint32_t id, uint32_t bootMs, const uint32_t *globalMs)
+      : id_(id), bootMs_(bootMs), globalMs_(globalMs), rng_(id * 2654435761u + 1) {
+    mac_[0] = 0x02;  // Locally administered
+    mac_[1] = 0x53;
+    mac_[2] = (uint8_t)(id >> 24);
+    mac_[3] = (uint8_t)(id >> 16);
+    mac_[4] = (uint8_t)(id >> 8);
+    mac_[5] = (uint8_t)id;
+    temperature_ = 22.0f + (random() % 600) / 100.0f;
+    humidity_ = 40.0f + (random() % 2000) / 100.0f;
+  }
+
+  uint32_t millis() const { return *globalMs_ - bootMs_; }
+  bool booted() const { return *globalMs_ >= bootMs_; }
+
+  bool send(const uint8_t *frame, size_t len);
+  bool pollDelivery(delivery_report &report);
+  bool pollReceive(rx_message &msg);
+
+  bool readDht(float &temperature, float &humidity);
+  int analogRead(uint8_t pin);
+
+  uint32_t random() {
+    rng_ ^= rng_ << 13;
+    rng_ ^= rng_ >> 17;
+    rng_ ^= rng_ << 5;
+    return rng_;
+  }
+
+  // Channel side
+  void setOutbox(std::vector<tx_attempt> *outbox) { outbox_ = outbox; }
+  void deliver(bool success, uint64_t timeUs) { deliveries_.push_back({success, timeUs}); }
+  void receive(const uint8_t *frame, size_t len);
+
+  uint32_t id() const { return id_; }
+  uint32_t bootMs() const { return bootMs_; }
+  const uint8_t *mac() const { return mac_; }
+
+private:
+  uint32_t id_;
+  uint32_t bootMs_;
+  const uint32_t *globalMs_;
+  uint32_t rng_;
+  uint8_t mac_[6];
+  float temperature_;
+  float humidity_;
+  int gas_ = 1200;
+  std::vector<tx_attempt> *outbox_ = nullptr;
+  std::deque<delivery_report> deliveries_;
+  std::deque<rx_message> received_;
+};
+
+#endif  // SIM_HAL_H
@@ -0,0 +1,260 @@
+// ==================== FLEET SIMULATION ====================
+//
+// Runs thousands of simulated senders against one simulated channel and
+// gateway, in lockstep 1 ms ticks of virtual time. Worker threads step their
+// share of the nodes, then the barrier's completion step resolves the
+// channel and advances the clock. Build and run from the repository root:
+//
+//   g++ -std=c++20 -O2 -pthread sim/*.cpp -o sender_sim
+//   ./sender_sim --nodes 2000 --seconds 600 --loss 0.02 --tdma --assign-slots
+//   ./sender_sim --nodes 300 --store-forward --outage-at 60 --outage 120
+//
+// With --store-forward the run exits non-zero if any reading was lost.
+//
+// Run with --help for all options, or with --check for the header checks.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <barrier>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include "hal.h"
+#include "channel.h"
+#include "sim_sender.h"
+#include "checks.h"
+
+typedef struct sim_options {
+  uint32_t nodes = 1000;
+  uint32_t threads = 0;  // 0 = one per CPU
+  uint32_t seconds = 600;
+  uint32_t bootSpreadMs = 0;  // 0: every node powered up at the same instant
+  uint32_t seed = 1;
+  bool check = false;  // Run the header checks instead of a fleet
+  sender_config sender = {12000, 1000, false, 16, false, 1200, FRAME_BATCH_MAX_SAMPLES, false, false};
+  channel_config channel = {0.02f, false, 16, 12000, 60000, 0};
+} sim_options;
+
+static void usage() {
+  printf("Usage: sender_sim [options]\n"
+         "  --nodes N            simulated senders (1000)\n"
+         "  --threads N          worker threads (one per CPU)\n"
+         "  --seconds N          virtual time to simulate (600)\n"
+         "  --interval MS        reporting interval (12000)\n"
+         "  --jitter MS          report jitter (1000)\n"
+         "  --tdma               slotted reporting\n"
+         "  --slots N            slots per interval (16)\n"
+         "  --assign-slots       gateway assigns slots in order of first contact\n"
+         "  --batch              sample every --sample-interval and send batches\n"
+         "  --sample-interval MS (1200)\n"
+         "  --delta              delta codec for batches (64 samples per frame)\n"
+         "  --loss P             data/ack loss probability (0.02)\n"
+         "  --outage S           gateway hears nothing for S seconds (0)\n"
+         "  --outage-at S        start of the outage (60)\n"
+         "  --store-forward      keep undelivered readings and send them later\n"
+         "  --boot-spread MS     spread power-up times over this window (0)\n"
+         "  --seed N             channel random seed (1)\n"
+         "  --check              run the header checks (checks.h) and exit\n");
+}
+
+static bool parseOptions(int argc, char **argv, sim_options &opt) {
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+    auto number = [&]() -> uint32_t {
+      if (value == nullptr) return 0;
+      i++;
+      return (uint32_t)strtoul(value, nullptr, 10);
+    };
+
+    if (!strcmp(arg, "--nodes")) opt.nodes = number();
+    else if (!strcmp(arg, "--threads")) opt.threads = number();
+    else if (!strcmp(arg, "--seconds")) opt.seconds = number();
+    else if (!strcmp(arg, "--interval")) opt.sender.intervalMs = number();
+    else if (!strcmp(arg, "--jitter")) opt.sender.jitterMs = number();
+    else if (!strcmp(arg, "--tdma")) opt.sender.slotted = true;
+    else if (!strcmp(arg, "--slots")) opt.sender.slots = (uint8_t)number();
+    else if (!strcmp(arg, "--assign-slots")) opt.channel.assignSlots = true;
+    else if (!strcmp(arg, "--batch")) opt.sender.batch = true;
+    else if (!strcmp(arg, "--sample-interval")) opt.sender.sampleIntervalMs = number();
+    else if (!strcmp(arg, "--delta")) opt.sender.delta = true;
+    else if (!strcmp(arg, "--outage")) opt.channel.outageMs = number() * 1000;
+    else if (!strcmp(arg, "--outage-at")) opt.channel.outageStartMs = number() * 1000;
+    else if (!strcmp(arg, "--store-forward")) opt.sender.storeForward = true;
+    else if (!strcmp(arg, "--boot-spread")) opt.bootSpreadMs = number();
+    else if (!strcmp(arg, "--seed")) opt.seed = number();
+    else if (!strcmp(arg, "--check")) opt.check = true;
+    else if (!strcmp(arg, "--loss") && value != nullptr) opt.channel.lossRate = strtof(argv[++i], nullptr);
+    else {
+      usage();
+      return false;
+    }
+  }
+
+  if (opt.nodes == 0 || opt.seconds == 0 || opt.sender.intervalMs == 0 ||
+      opt.sender.slots == 0 || opt.sender.sampleIntervalMs == 0) {
+    usage();
+    return false;
+  }
+  if (opt.sender.delta) opt.sender.batchMax = 64;
+  if (opt.threads == 0) opt.threads = std::thread::hardware_concurrency();
+  if (opt.threads == 0) opt.threads = 1;
+  if (opt.threads > opt.nodes) opt.threads = opt.nodes;
+  opt.channel.slots = opt.sender.slots;
+  opt.channel.intervalMs = opt.sender.intervalMs;
+  return true;
+}
+
+/**
+ * @return Readings lost: taken, but neither received by the gateway nor still on their node
+ */
+static uint64_t printReport(const sim_options &opt, const Channel &channel,
+                            const std::vector<std::unique_ptr<SimSender>> &senders, double wallSeconds) {
+  sender_stats total = {};
+  uint64_t retransmits = 0, dropped = 0;
+  for (const auto &sender : senders) {
+    const sender_stats &s = sender->stats();
+    total.samples += s.samples;
+    total.framesQueued += s.framesQueued;
+    total.framesSent += s.framesSent;
+    total.bytesSent += s.bytesSent;
+    total.acked += s.acked;
+    total.failed += s.failed;
+    total.samplesDropped += s.samplesDropped;
+    total.samplesStored += s.samplesStored;
+    total.lateReports += s.lateReports;
+    total.ackLatencyUs += s.ackLatencyUs;
+    if (s.ackLatencyMaxUs > total.ackLatencyMaxUs) total.ackLatencyMaxUs = s.ackLatencyMaxUs;
+    retransmits += sender->retransmits();
+    dropped += sender->dropped();
+  }
+
+  uint64_t received = 0, repeats = 0, duplicates = 0, gaps = 0, held = 0, lost = 0;
+  double latencySum = 0;
+  uint32_t latencyMax = 0;
+  double worstRatio = 1.0, bestRatio = 0.0;
+  std::unordered_set<uint32_t> onNode;
+  for (size_t i = 0; i < senders.size(); i++) {
+    auto it = channel.gatewayNodes().find((uint32_t)i);
+    onNode.clear();
+    senders[i]->held(onNode);
+    held += onNode.size();
+    for (uint32_t t : senders[i]->taken()) {
+      bool atGateway = it != channel.gatewayNodes().end() && it->second.timestamps.count(t) > 0;
+      if (!atGateway && onNode.count(t) == 0) lost++;
+    }
+
+    uint32_t got = it == channel.gatewayNodes().end() ? 0 : it->second.samples;
+    uint32_t taken = senders[i]->stats().samples;
+    double ratio = taken > 0 ? (double)got / taken : 1.0;
+    if (ratio < worstRatio) worstRatio = ratio;
+    if (ratio > bestRatio) bestRatio = ratio;
+    if (it == channel.gatewayNodes().end()) continue;
+    received += it->second.samples;
+    repeats += it->second.repeats;
+    duplicates += it->second.duplicates;
+    gaps += it->second.gaps;
+    latencySum += it->second.latencySumMs;
+    if (it->second.latencyMaxMs > latencyMax) latencyMax = it->second.latencyMaxMs;
+  }
+
+  const channel_stats &ch = channel.stats();
+  double simSeconds = opt.seconds;
+  printf("\n========== SIMULATION ==========\n");
+  printf("Nodes %u, %u s virtual in %.1f s wall (%u threads)\n",
+         opt.nodes, opt.seconds, wallSeconds, opt.threads);
+  printf("Mode: %s%s, interval %u ms, jitter %u ms%s\n",
+         opt.sender.batch ? (opt.sender.delta ? "delta batches" : "batches") : "single samples",
+         opt.sender.slotted ? ", TDMA" : "", opt.sender.intervalMs, opt.sender.jitterMs,
+         opt.channel.assignSlots ? ", gateway-assigned slots" : "");
+  printf("\nSenders\n");
+  printf("  Samples taken      %llu (%.1f /s)\n", (unsigned long long)total.samples, total.samples / simSeconds);
+  printf("  Frames queued      %llu, sent %llu (%.1f /s, %.0f bytes/s)\n",
+         (unsigned long long)total.framesQueued, (unsigned long long)total.framesSent,
+         total.framesSent / simSeconds, total.bytesSent / simSeconds);
+  printf("  Delivered          %llu, failed %llu, window retransmits %llu, dropped %llu\n",
+         (unsigned long long)total.acked, (unsigned long long)total.failed,
+         (unsigned long long)retransmits, (unsigned long long)dropped);
+  printf("  Samples not queued %llu (send window full)\n", (unsigned long long)total.samplesDropped);
+  if (opt.sender.storeForward) {
+    printf("  Samples stored     %llu, still held at the end %llu\n",
+           (unsigned long long)total.samplesStored, (unsigned long long)held);
+  }
+  printf("  Callback latency   avg %.2f ms, max %.2f ms, %llu late reports ignored\n",
+         total.acked ? total.ackLatencyUs / 1000.0 / total.acked : 0.0, total.ackLatencyMaxUs / 1000.0,
+         (unsigned long long)total.lateReports);
+  printf("\nChannel\n");
+  printf("  Utilization        %.1f %%\n", ch.busyUs / (simSeconds * 1e6) * 100.0);
+  printf("  On-air attempts    %llu, collisions %llu, losses %llu, MAC retries %llu\n",
+         (unsigned long long)ch.attempts, (unsigned long long)ch.collisions,
+         (unsigned long long)ch.lost, (unsigned long long)ch.macRetries);
+  if (opt.channel.outageMs > 0) {
+    printf("  Gateway outage     %u s from %u s, %llu attempts unheard\n", opt.channel.outageMs / 1000,
+           opt.channel.outageStartMs / 1000, (unsigned long long)ch.unheard);
+  }
+  printf("  Still contending   %zu\n", channel.contending());
+  printf("\nGateway\n");
+  printf("  Samples received   %llu of %llu (%.2f %%)\n", (unsigned long long)received,
+         (unsigned long long)total.samples, total.samples ? 100.0 * received / total.samples : 0.0);
+  printf("  Duplicates %llu, repeated readings %llu, sequence gaps %llu, malformed %llu\n",
+         (unsigned long long)duplicates, (unsigned long long)repeats, (unsigned long long)gaps,
+         (unsigned long long)ch.malformed);
+  printf("  Sample latency     avg %.0f ms, max %u ms\n", received ? latencySum / received : 0.0, latencyMax);
+  printf("  Per-node delivery  worst %.2f %%, best %.2f %%\n", worstRatio * 100.0, bestRatio * 100.0);
+  printf("  Samples lost       %llu (neither received nor still on the node)\n", (unsigned long long)lost);
+  return lost;
+}
+
+int main(int argc, char **argv) {
+  sim_options opt;
+  if (!parseOptions(argc, argv, opt)) return 1;
+  if (opt.check) return runChecks() > 0 ? 1 : 0;
+
+  uint32_t nowMs = 0;
+  uint32_t bootRng = opt.seed * 747796405u + 1;
+  std::vector<std::unique_ptr<HostHal>> hals;
+  std::vector<HostHal *> halPtrs;
+  std::vector<std::unique_ptr<SimSender>> senders;
+  for (uint32_t i = 0; i < opt.nodes; i++) {
+    bootRng = bootRng * 1664525u + 1013904223u;
+    uint32_t bootMs = opt.bootSpreadMs ? (bootRng >> 8) % opt.bootSpreadMs : 0;
+    hals.push_back(std::make_unique<HostHal>(i, bootMs, &nowMs));
+    halPtrs.push_back(hals.back().get());
+  }
+
+  Channel channel(opt.channel, opt.threads, halPtrs, opt.seed);
+  for (uint32_t i = 0; i < opt.nodes; i++) {
+    senders.push_back(std::make_unique<SimSender>(*hals[i], opt.sender));
+  }
+
+  // Contiguous share of the nodes per worker; each worker owns one outbox
+  const uint32_t ticks = opt.seconds * 1000;
+  auto tick = [&]() noexcept {
+    channel.resolve(nowMs);
+    nowMs++;
+  };
+  std::barrier<decltype(tick)> sync((ptrdiff_t)opt.threads, tick);
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for (uint32_t w = 0; w < opt.threads; w++) {
+    uint32_t first = (uint64_t)opt.nodes * w / opt.threads;
+    uint32_t last = (uint64_t)opt.nodes * (w + 1) / opt.threads;
+    for (uint32_t i = first; i < last; i++) hals[i]->setOutbox(channel.outbox(w));
+
+    workers.emplace_back([&, first, last]() {
+      for (uint32_t t = 0; t < ticks; t++) {
+        for (uint32_t i = first; i < last; i++) senders[i]->step();
+        sync.arrive_and_wait();
+      }
+    });
+  }
+  for (auto &worker : workers) worker.join();
+  double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  uint64_t lost = printReport(opt, channel, senders, wallSeconds);
+  return opt.sender.storeForward && lost > 0 ? 1 : 0;
+}
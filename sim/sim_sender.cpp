@@ -0,0 +1,225 @@
+#include "sim_sender.h"
+
+void SimSender::start() {
+  started_ = true;
+  schedule_.assign(ReportSchedule::macSlot(hal_.mac(), config_.slots), config_.slots, 0);
+  nextReport_ = schedule_.next(hal_.millis(), config_.intervalMs, hal_.random());
+  lastSample_ = hal_.millis();
+  batch_.reserve(config_.batchMax);
+}
+
+sensor_data SimSender::readSensors() {
+  sensor_data reading = last_;
+  float temperature, humidity;
+  if (hal_.readDht(temperature, humidity)) {
+    reading.temperature = temperature;
+    reading.humidity = humidity;
+  }
+  reading.mq_value = hal_.analogRead(34);
+  reading.heartRate = 72.0f + (int32_t)(hal_.random() % 11 - 5) / 2.0f;
+  reading.spo2 = 97.5f + (int32_t)(hal_.random() % 6 - 3) / 2.0f;
+  reading.timestamp = hal_.millis();
+  last_ = reading;
+  stats_.samples++;
+  taken_.push_back((uint32_t)reading.timestamp);
+  return reading;
+}
+
+void SimSender::held(std::unordered_set<uint32_t> &timestamps) const {
+  for (const sensor_data &s : store_) timestamps.insert((uint32_t)s.timestamp);
+  for (const sensor_data &s : batch_) timestamps.insert((uint32_t)s.timestamp);
+  for (const auto &frame : liveFrames_) timestamps.insert(frame.second.begin(), frame.second.end());
+}
+
+/**
+ * @brief Pack samples into one frame with the configured batch codec
+ */
+static size_t encodeSamples(const sender_config &config, uint8_t *frame, const uint8_t *mac, uint16_t seq,
+                            const sensor_data *samples, size_t count, size_t &consumed) {
+  return config.delta ? encodeDeltaFrame(frame, FRAME_MAX_SIZE, mac, seq, samples, count, consumed)
+                      : encodeBatchFrame(frame, FRAME_MAX_SIZE, mac, seq, samples, count, consumed);
+}
+
+void SimSender::flushBatch() {
+  size_t offset = 0;
+  while (offset < batch_.size()) {
+    uint8_t frame[FRAME_MAX_SIZE];
+    size_t consumed = 0;
+    size_t len = encodeSamples(config_, frame, hal_.mac(), seq_, batch_.data() + offset,
+                               batch_.size() - offset, consumed);
+    if (len == 0 || consumed == 0) break;
+    if (!enqueueLive(frame, len, batch_.data() + offset, consumed)) break;
+    seq_++;
+    offset += consumed;
+  }
+  if (offset < batch_.size()) {
+    if (config_.storeForward) {
+      store_.insert(store_.end(), batch_.begin() + offset, batch_.end());
+      stats_.samplesStored += batch_.size() - offset;
+    } else {
+      stats_.samplesDropped += batch_.size() - offset;
+    }
+  }
+  batch_.clear();
+}
+
+/**
+ * @brief Queue a frame of live readings (frame seq_), tagged for rescue with storeForward
+ */
+bool SimSender::enqueueLive(const uint8_t *frame, size_t len, const sensor_data *samples, size_t count) {
+  if (!window_.enqueue(frame, len, false, config_.storeForward ? SIM_LIVE_TAG : 0)) return false;
+  if (config_.storeForward) {
+    std::vector<uint32_t> &timestamps = liveFrames_[seq_];
+    timestamps.clear();
+    for (size_t i = 0; i < count; i++) timestamps.push_back((uint32_t)samples[i].timestamp);
+  }
+  stats_.framesQueued++;
+  return true;
+}
+
+/**
+ * @brief Outcomes of tagged frames: release acked stored records, rescue dropped live ones
+ */
+void SimSender::settleTagged() {
+  static thread_local sensor_data samples[FRAME_DELTA_MAX_SAMPLES];
+  uint8_t tag;
+  bool acked;
+  const uint8_t *frame;
+  size_t len;
+  while (window_.popSettled(tag, acked, &frame, &len)) {
+    if (tag != SIM_LIVE_TAG) {
+      storedInFlight_ = 0;
+      if (acked) {
+        store_.erase(store_.begin(), store_.begin() + tag);
+        storeBackoffMs_ = SIM_STORE_BACKOFF_MIN_MS;
+      } else {
+        storeRetryMs_ = hal_.millis() + storeBackoffMs_;
+        storeBackoffMs_ = storeBackoffMs_ * 2 > SIM_STORE_BACKOFF_MAX_MS ? SIM_STORE_BACKOFF_MAX_MS
+                                                                        : storeBackoffMs_ * 2;
+      }
+      continue;
+    }
+    frame_header hdr;
+    size_t count = decodeFrameSamples(frame, len, hdr, samples, FRAME_DELTA_MAX_SAMPLES);
+    liveFrames_.erase(hdr.seq);
+    if (acked) continue;
+    store_.insert(store_.end(), samples, samples + count);
+    stats_.samplesStored += count;
+  }
+}
+
+/**
+ * @brief Send the oldest stored readings once the previous stored batch is settled
+ */
+void SimSender::drainStore() {
+  if (store_.empty() || storedInFlight_ > 0 || window_.freeSlots() == 0) return;
+  if ((int32_t)(hal_.millis() - storeRetryMs_) < 0) return;
+  sensor_data batch[FRAME_DELTA_MAX_SAMPLES];
+  size_t count = config_.batchMax < store_.size() ? config_.batchMax : store_.size();
+  if (count > FRAME_DELTA_MAX_SAMPLES) count = FRAME_DELTA_MAX_SAMPLES;
+  std::copy(store_.begin(), store_.begin() + count, batch);
+
+  uint8_t frame[FRAME_MAX_SIZE];
+  size_t consumed = 0;
+  size_t len = encodeSamples(config_, frame, hal_.mac(), seq_, batch, count, consumed);
+  if (len == 0 || consumed == 0 || !window_.enqueue(frame, len, false, (uint8_t)consumed)) return;
+  storedInFlight_ = consumed;
+  stats_.framesQueued++;
+  seq_++;
+}
+
+void SimSender::pump() {
+  while (window_.canSend()) {
+    size_t len;
+    const uint8_t *frame = window_.peekPending(len);
+    hal_.send(frame, len);
+    window_.markSent(hal_.millis());
+    sentUs_.push_back((uint64_t)(hal_.millis() + hal_.bootMs()) * 1000);
+    stats_.framesSent++;
+    stats_.bytesSent += len;
+  }
+}
+
+void SimSender::step() {
+  if (!hal_.booted() || hal_.millis() < SIM_SETUP_MS) return;
+  if (!started_) start();
+  uint32_t now = hal_.millis();
+
+  // OnDataRecv: slot assignments from the gateway
+  rx_message msg;
+  while (hal_.pollReceive(msg)) {
+    frame_header hdr;
+    uint8_t slot, slots;
+    uint16_t phaseMs;
+    if (config_.slotted && decodeSlotFrame(msg.data, msg.len, hdr, slot, slots, phaseMs)) {
+      schedule_.assign(slot, slots, now - phaseMs);
+      nextReport_ = schedule_.next(now, config_.intervalMs, hal_.random());
+    }
+  }
+
+  // OnDataSent: settle the oldest in-flight frame
+  delivery_report report;
+  while (hal_.pollDelivery(report)) {
+    if (window_.onAck(report.success) == SEND_UNKNOWN) {
+      stats_.lateReports++;  // For a frame already expired and resent
+      continue;
+    }
+    if (report.success) {
+      stats_.acked++;
+      if (!sentUs_.empty()) {
+        uint64_t latency = report.timeUs - sentUs_.front();
+        stats_.ackLatencyUs += latency;
+        if (latency > stats_.ackLatencyMaxUs) stats_.ackLatencyMaxUs = (uint32_t)latency;
+      }
+    } else {
+      stats_.failed++;
+    }
+    if (!sentUs_.empty()) sentUs_.erase(sentUs_.begin());
+  }
+  if (window_.expire(now, SIM_SEND_ACK_TIMEOUT_MS) > 0) {
+    sentUs_.clear();
+  }
+  settleTagged();
+  bool storing = config_.storeForward && !store_.empty();
+
+  bool due = (int32_t)(now - nextReport_) >= 0;
+  if (due) {
+    nextReport_ = schedule_.next(now, config_.intervalMs, hal_.random());
+  }
+
+  if (config_.batch) {
+    if (now - lastSample_ >= config_.sampleIntervalMs) {
+      lastSample_ = now;
+      sensor_data reading = readSensors();
+      if (storing) {
+        // Backlog still draining: the RAM batch joins it, to keep the series in order
+        store_.insert(store_.end(), batch_.begin(), batch_.end());
+        store_.push_back(reading);
+        stats_.samplesStored += batch_.size() + 1;
+        batch_.clear();
+      } else {
+        batch_.push_back(reading);
+        if (batch_.size() >= config_.batchMax) flushBatch();
+      }
+    }
+    if (due && !batch_.empty()) flushBatch();
+  } else if (due) {
+    sensor_data reading = readSensors();
+    bool queued = false;
+    if (!storing) {
+      uint8_t frame[FRAME_MAX_SIZE];
+      size_t len = encodeSampleFrame(frame, sizeof(frame), hal_.mac(), seq_, reading);
+      queued = enqueueLive(frame, len, &reading, 1);
+      seq_++;
+    }
+    if (!queued && config_.storeForward) {
+      store_.push_back(reading);
+      stats_.samplesStored++;
+    } else if (!queued) {
+      stats_.samplesDropped++;
+    }
+  }
+
+  drainStore();
+  pump();
+}
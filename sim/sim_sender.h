@@ -0,0 +1,116 @@
+#ifndef SIM_SENDER_H
+#define SIM_SENDER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "hal.h"
+#include "../send_window.h"
+#include "../report_schedule.h"
+
+// ==================== SIMULATED SENDER ====================
+//
+// The sender's reporting and transmit path on top of HostHal, built from the
+// same pieces as sender.cpp: ReportSchedule decides when to report,
+// sensor_frame.h packs the frames (single samples, or batches with either
+// codec) and SendWindow does the flow control and retransmissions, with the
+// window sizes and timeouts of the sender's defaults. With storeForward, a
+// deque stands in for the flash log: live frames that run out of retries
+// are decoded back into it, new readings join it while it holds a backlog,
+// and it drains one acknowledged batch at a time, as in sender.cpp. A
+// dropped stored batch is retried after a backoff that stands in for the
+// sender's link restarts (RECOVERY_BACKOFF_MIN_MS to RECOVERY_BACKOFF_MAX_MS).
+
+#define SIM_SEND_WINDOW_SIZE 4
+#define SIM_SEND_QUEUE_SLOTS 8
+#define SIM_SEND_MAX_RETRIES 3
+#define SIM_SEND_ACK_TIMEOUT_MS 1000
+#define SIM_SETUP_MS 4000  // Boot banner, DHT settle and ESP-NOW bring-up
+#define SIM_LIVE_TAG 0xFF  // Live frames; stored batches are tagged with their sample count
+#define SIM_STORE_BACKOFF_MIN_MS 1000
+#define SIM_STORE_BACKOFF_MAX_MS 60000
+
+typedef struct sender_config {
+  uint32_t intervalMs;
+  uint32_t jitterMs;
+  bool slotted;
+  uint8_t slots;
+  bool batch;
+  uint32_t sampleIntervalMs;
+  size_t batchMax;
+  bool delta;
+  bool storeForward;
+} sender_config;
+
+typedef struct sender_stats {
+  uint32_t samples;       // Readings taken and queued for sending
+  uint32_t framesQueued;
+  uint32_t framesSent;    // Handed to esp_now_send(), incl. retransmissions
+  uint32_t bytesSent;
+  uint32_t acked;
+  uint32_t failed;
+  uint32_t samplesDropped;  // Send window full
+  uint32_t samplesStored;   // Written to the store-and-forward log
+  uint32_t lateReports;     // Delivery reports ignored as late (frame expired meanwhile)
+  uint64_t ackLatencyUs;    // Sum over acked frames
+  uint32_t ackLatencyMaxUs;
+} sender_stats;
+
+class SimSender {
+public:
+  SimSender(HostHal &hal, const sender_config &config)
+      : hal_(hal), config_(config), schedule_(config.slotted, config.slots, config.jitterMs) {}
+
+  /**
+   * @brief Run one millisecond of the node: callbacks, sampling, reporting, sending
+   */
+  void step();
+
+  const sender_stats &stats() const { return stats_; }
+  uint32_t retransmits() const { return window_.retransmits(); }
+  uint32_t dropped() const { return window_.dropped(); }
+
+  /**
+   * @brief Timestamps of every reading taken, oldest first
+   */
+  const std::vector<uint32_t> &taken() const { return taken_; }
+
+  /**
+   * @brief Timestamps of readings still on the node: backlog, open batch and live frames in the window
+   */
+  void held(std::unordered_set<uint32_t> &timestamps) const;
+
+private:
+  void start();
+  sensor_data readSensors();
+  void flushBatch();
+  bool enqueueLive(const uint8_t *frame, size_t len, const sensor_data *samples, size_t count);
+  void settleTagged();
+  void drainStore();
+  void pump();
+
+  HostHal &hal_;
+  sender_config config_;
+  ReportSchedule schedule_;
+  SendWindow<SIM_SEND_QUEUE_SLOTS, SIM_SEND_WINDOW_SIZE, FRAME_MAX_SIZE, SIM_SEND_MAX_RETRIES> window_;
+
+  bool started_ = false;
+  uint32_t nextReport_ = 0;
+  uint32_t lastSample_ = 0;
+  uint16_t seq_ = 0;
+  sensor_data last_ = {};
+  std::vector<sensor_data> batch_;
+  std::vector<uint64_t> sentUs_;  // Send times of in-flight frames, oldest first
+  std::vector<uint32_t> taken_;
+  std::deque<sensor_data> store_;  // Stands in for the flash log
+  size_t storedInFlight_ = 0;      // Records of the stored batch in the window
+  uint32_t storeRetryMs_ = 0;      // No stored batch before this time
+  uint32_t storeBackoffMs_ = SIM_STORE_BACKOFF_MIN_MS;
+  std::unordered_map<uint16_t, std::vector<uint32_t>> liveFrames_;  // Sample timestamps by seq
+  sender_stats stats_ = {};
+};
+
+#endif  // SIM_SENDER_H
@@ -0,0 +1,92 @@
+#ifndef WINDOW_STATS_H
+#define WINDOW_STATS_H
+
+#include <stdint.h>
+#include <math.h>
+#include "sensor_frame.h"
+
+// ==================== WINDOWED STATISTICS ====================
+//
+// Running count, min, max, mean and variance per sensor channel over one
+// reporting window, in constant memory: no sample is kept. Mean and variance
+// use Welford's update, which stays accurate in single precision (the
+// ESP32's FPU is single precision only) where summing x and x^2 would cancel.
+//
+// Channels whose 0 means "no reading" (heart rate and SpO2 without a finger,
+// see SampleLayout) leave those readings out, so their counts can be lower.
+
+class RunningStats {
+public:
+  void add(float x) {
+    count_++;
+    if (count_ == 1) {
+      min_ = max_ = x;
+    } else {
+      if (x < min_) min_ = x;
+      if (x > max_) max_ = x;
+    }
+    float delta = x - mean_;
+    mean_ += delta / count_;
+    m2_ += delta * (x - mean_);
+  }
+
+  void reset() { *this = RunningStats(); }
+
+  uint32_t count() const { return count_; }
+  float mean() const { return mean_; }
+  float minValue() const { return min_; }
+  float maxValue() const { return max_; }
+  float variance() const { return count_ > 1 ? m2_ / (count_ - 1) : 0.0f; }  // Sample variance
+  float stddev() const { return sqrtf(variance()); }
+
+private:
+  uint32_t count_ = 0;
+  float mean_ = 0.0f;
+  float m2_ = 0.0f;  // Sum of squared deviations from the running mean
+  float min_ = 0.0f;
+  float max_ = 0.0f;
+};
+
+class WindowAggregator {
+public:
+  void add(const sensor_data &s) {
+    float value[FRAME_FIELD_COUNT];
+    SampleLayout::values(s, value);
+    for (int i = 0; i < FRAME_FIELD_COUNT; i++) {
+      if (!SampleLayout::missing(i, value[i])) channel_[i].add(value[i]);
+    }
+  }
+
+  bool empty() const { return channel_[0].count() == 0; }
+  uint32_t count() const { return channel_[0].count(); }
+
+  /**
+   * @brief Statistics of the window so far (counts saturate at 65535)
+   */
+  void summarize(sensor_summary &out, uint32_t nowMs) const {
+    out.startMs = startMs_;
+    out.windowMs = nowMs - startMs_;
+    for (int i = 0; i < FRAME_FIELD_COUNT; i++) {
+      const RunningStats &c = channel_[i];
+      out.channel[i].count = c.count() > 0xFFFF ? 0xFFFF : (uint16_t)c.count();
+      out.channel[i].mean = c.mean();
+      out.channel[i].min = c.minValue();
+      out.channel[i].max = c.maxValue();
+      out.channel[i].stddev = c.stddev();
+    }
+  }
+
+  /**
+   * @brief Start the next window at nowMs
+   */
+  void reset(uint32_t nowMs) {
+    for (RunningStats &c : channel_) c.reset();
+    startMs_ = nowMs;
+  }
+
+private:
+  RunningStats channel_[FRAME_FIELD_COUNT];
+  uint32_t startMs_ = 0;
+};
+
+#endif  // WINDOW_STATS_H